@@ -0,0 +1,38 @@
+#include "AirGradient.h"
+
+#define PMS_READ_MS 950
+#define CO2_READ_MS 60
+#define SHT_READ_MS 20
+
+static float drift(float value, float step, float low, float high)
+{
+  value += step * ((rand() % 2001) - 1000) / 1000.0f;
+  return value < low ? low : value > high ? high : value;
+}
+
+int AirGradient::getPM2_Raw()
+{
+  delay(PMS_READ_MS);
+  if (failing)
+    return -1;
+  pm = drift(pm, 1.5f, 0, 150);
+  return (int)pm;
+}
+
+int AirGradient::getCO2_Raw()
+{
+  delay(CO2_READ_MS);
+  if (failing)
+    return -1;
+  co2 = drift(co2, 15, 400, 2500);
+  return (int)co2;
+}
+
+TMP_RH AirGradient::periodicFetchData()
+{
+  delay(SHT_READ_MS);
+  temp = drift(temp, 0.1f, 15, 30);
+  rh = drift(rh, 0.5f, 20, 80);
+  TMP_RH result = {temp, (int)rh};
+  return result;
+}
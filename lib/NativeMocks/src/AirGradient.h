@@ -0,0 +1,37 @@
+#ifndef __NATIVE_AIRGRADIENT_H__
+#define __NATIVE_AIRGRADIENT_H__
+
+#include <Arduino.h>
+
+struct TMP_RH
+{
+  float t;
+  int rh;
+};
+
+//
+// Simulated PMS5003, SenseAir S8 and SHT3x. Readings drift slowly around indoor values and each
+// read advances the virtual clock by roughly what the blocking call costs on the device
+//
+class AirGradient
+{
+public:
+  void PMS_Init() {}
+  void CO2_Init() {}
+  void TMP_RH_Init(uint8_t address) { (void)address; }
+
+  int getPM2_Raw();
+  int getCO2_Raw();
+  TMP_RH periodicFetchData();
+
+  void setFailing(bool failing) { this->failing = failing; }
+
+private:
+  bool failing = false;
+  float pm = 8;
+  float co2 = 600;
+  float temp = 22;
+  float rh = 45;
+};
+
+#endif //__NATIVE_AIRGRADIENT_H__
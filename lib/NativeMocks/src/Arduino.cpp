@@ -0,0 +1,192 @@
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "MockHeap.h"
+
+static uint64_t clockUs = 0;
+// Virtual time of the last reset, millis() and micros() count from there like on the device
+static uint64_t resetUs = 0;
+
+uint32_t millis() { return (uint32_t)((clockUs - resetUs) / 1000); }
+uint32_t micros() { return (uint32_t)(clockUs - resetUs); }
+void delay(uint32_t ms) { clockUs += (uint64_t)ms * 1000; }
+void delayMicroseconds(uint32_t us) { clockUs += us; }
+void yield() {}
+
+void mockClockAdvance(uint32_t ms) { clockUs += (uint64_t)ms * 1000; }
+uint64_t mockClockMicros() { return clockUs; }
+
+extern "C" time_t __real_time(time_t *t);
+
+static bool clockSynced = false;
+// Wall clock minus the virtual clock once synced, in microseconds
+static int64_t wallOffsetUs = 0;
+static bool ntpPending = false;
+static uint64_t ntpSyncUs = 0;
+
+extern "C" time_t __wrap_time(time_t *t)
+{
+  if (ntpPending && clockUs >= ntpSyncUs)
+    mockClockSync();
+
+  // Before a sync the SDK clock counts from the last reset
+  time_t now = (time_t)((clockSynced ? wallOffsetUs + (int64_t)clockUs : (int64_t)(clockUs - resetUs)) / 1000000);
+  if (t)
+    *t = now;
+  return now;
+}
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+  size_t len = strlen(src);
+  if (size > 0)
+  {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
+
+void mockClockSync()
+{
+  // NTP brings the host's time as of the start of the run, plus the virtual clock
+  static time_t bootTime = __real_time(nullptr);
+  wallOffsetUs = (int64_t)bootTime * 1000000;
+  clockSynced = true;
+  ntpPending = false;
+}
+
+void mockClockUnsync()
+{
+  clockSynced = false;
+  ntpPending = false;
+}
+
+extern "C" int __wrap_settimeofday(const struct timeval *tv, const struct timezone *tz)
+{
+  (void)tz;
+  if (tv == nullptr)
+    return 0;
+  wallOffsetUs = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec - (int64_t)clockUs;
+  clockSynced = true;
+  return 0;
+}
+
+extern "C" int __wrap_gettimeofday(struct timeval *tv, void *tz)
+{
+  (void)tz;
+  if (ntpPending && clockUs >= ntpSyncUs)
+    mockClockSync();
+
+  int64_t now = clockSynced ? wallOffsetUs + (int64_t)clockUs : (int64_t)(clockUs - resetUs);
+  tv->tv_sec = (time_t)(now / 1000000);
+  tv->tv_usec = (suseconds_t)(now % 1000000);
+  return 0;
+}
+
+void configTime(const char *tz, const char *server1, const char *server2, const char *server3)
+{
+  (void)server1;
+  (void)server2;
+  (void)server3;
+  setenv("TZ", tz, 1);
+  tzset();
+  ntpPending = true;
+  ntpSyncUs = clockUs + (uint64_t)MOCK_NTP_MS * 1000;
+}
+
+HardwareSerial Serial;
+EspClass ESP;
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  if (!quiet)
+    fwrite(buffer, 1, size, stdout);
+
+  // Returns once the last byte is in the FIFO, i.e. when all but a FIFO's worth have been sent
+  uint64_t nowNs = clockUs * 1000;
+  emptyAtNs = max(emptyAtNs, nowNs) + size * byteNs();
+  uint64_t fifoNs = MOCK_UART_FIFO * byteNs();
+  if (emptyAtNs > nowNs + fifoNs)
+  {
+    uint64_t stallUs = (emptyAtNs - fifoNs - nowNs + 999) / 1000;
+    clockUs += stallUs;
+    uartStats.stalls++;
+    uartStats.stallUs += stallUs;
+    uartStats.maxStallUs = max(uartStats.maxStallUs, (uint32_t)stallUs);
+  }
+  uartStats.bytes += size;
+  return size;
+}
+
+int HardwareSerial::availableForWrite()
+{
+  uint64_t nowNs = clockUs * 1000;
+  uint64_t queued = emptyAtNs > nowNs ? (emptyAtNs - nowNs + byteNs() - 1) / byteNs() : 0;
+  return queued < MOCK_UART_FIFO ? MOCK_UART_FIFO - queued : 0;
+}
+
+void HardwareSerial::flush()
+{
+  uint64_t nowNs = clockUs * 1000;
+  if (emptyAtNs > nowNs)
+    clockUs += (emptyAtNs - nowNs + 999) / 1000;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  return mockHeap.freeBytes();
+}
+
+void EspClass::getHeapStats(uint32_t *freeHeap, uint32_t *maxBlock, uint8_t *fragmentation)
+{
+  if (freeHeap != nullptr)
+    *freeHeap = mockHeap.freeBytes();
+  if (maxBlock != nullptr)
+    *maxBlock = mockHeap.maxFreeBlock();
+  if (fragmentation != nullptr)
+    *fragmentation = mockHeap.fragmentation();
+}
+
+static uint32_t rtcUserMemory[RTC_USER_MEMORY_BYTES / 4];
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+{
+  if (offset * 4 + size > sizeof(rtcUserMemory))
+    return false;
+  memcpy(data, (const uint8_t *)rtcUserMemory + offset * 4, size);
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+{
+  if (offset * 4 + size > sizeof(rtcUserMemory))
+    return false;
+  memcpy((uint8_t *)rtcUserMemory + offset * 4, data, size);
+  return true;
+}
+
+void EspClass::deepSleep(uint64_t timeUs, RFMode mode)
+{
+  WiFi.mode(WIFI_OFF);
+  clockUs += timeUs;
+  resetUs = clockUs;
+  mockClockUnsync();
+  resetInfo.reason = REASON_DEEP_SLEEP_AWAKE;
+  mockHeap.reboot();
+  throw MockDeepSleep{timeUs, mode};
+}
+
+void EspClass::restart()
+{
+  fflush(stdout);
+  fprintf(stderr, "ESP.restart() called, exiting\n");
+  exit(1);
+}
@@ -0,0 +1,169 @@
+#ifndef __NATIVE_ARDUINO_H__
+#define __NATIVE_ARDUINO_H__
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "WString.h"
+#include "Print.h"
+
+using std::max;
+using std::min;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// glibc only gained strlcpy in 2.38, the ESP8266 newlib has it
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define F(str) (str)
+
+#define SDA 4
+#define SCL 5
+
+// Wemos D1 mini pin names
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+
+//
+// Virtual clock: time only moves when delay() is called or the host runner advances it,
+// so simulated hours of sampling run in milliseconds of host time
+//
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void mockClockAdvance(uint32_t ms);
+uint64_t mockClockMicros();
+
+// time() is wrapped at link time (-Wl,--wrap=time) to follow the virtual clock. Like on the ESP it
+// counts seconds since boot until SNTP has set it, which configTime() does MOCK_NTP_MS later
+// (and timeSync() right away), from then on it is the host's boot time plus the virtual clock
+extern "C" time_t __wrap_time(time_t *t);
+
+#define MOCK_NTP_MS 1200
+
+// settimeofday() and gettimeofday() are wrapped too (-Wl,--wrap=settimeofday,--wrap=gettimeofday)
+// and set or read the virtual wall clock
+extern "C" int __wrap_settimeofday(const struct timeval *tv, const struct timezone *tz);
+extern "C" int __wrap_gettimeofday(struct timeval *tv, void *tz);
+void mockClockUnsync();
+
+void configTime(const char *tz, const char *server1, const char *server2 = nullptr, const char *server3 = nullptr);
+void mockClockSync();
+
+// The UART's TX FIFO; a write that finds it full waits, on the virtual clock, for the line to take
+// the bytes at 10 bits each
+#define MOCK_UART_FIFO 128
+
+typedef struct
+{
+  uint64_t bytes;
+  uint32_t stalls;
+  uint64_t stallUs;
+  uint32_t maxStallUs;
+} MockUartStats_t;
+
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long baud) { this->baud = baud; }
+  void setQuiet(bool quiet) { this->quiet = quiet; }
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  int availableForWrite();
+  // Waits until the FIFO is empty
+  void flush();
+
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+
+  const MockUartStats_t &stats() const { return uartStats; }
+
+private:
+  uint64_t byteNs() const { return 10000000000ull / baud; }
+
+  bool quiet = false;
+  unsigned long baud = 115200;
+  // When the last byte written leaves the FIFO, in virtual nanoseconds
+  uint64_t emptyAtNs = 0;
+  MockUartStats_t uartStats = {};
+};
+
+extern HardwareSerial Serial;
+
+enum RFMode
+{
+  RF_DEFAULT = 0,
+  RF_CAL = 1,
+  RF_NO_CAL = 2,
+  RF_DISABLED = 4
+};
+
+#define WAKE_RF_DEFAULT RF_DEFAULT
+#define WAKE_RF_DISABLED RF_DISABLED
+
+#define REASON_DEFAULT_RST 0
+#define REASON_DEEP_SLEEP_AWAKE 5
+
+struct rst_info
+{
+  uint32_t reason;
+};
+
+// Thrown by ESP.deepSleep() to hand control back to the host runner, which calls setup() again
+struct MockDeepSleep
+{
+  uint64_t sleepUs;
+  RFMode mode;
+};
+
+#define RTC_USER_MEMORY_BYTES 512
+
+class EspClass
+{
+public:
+  uint32_t getChipId() { return 0x00c0ffee; }
+  uint32_t getFreeHeap();
+  void getHeapStats(uint32_t *freeHeap = nullptr, uint32_t *maxBlock = nullptr, uint8_t *fragmentation = nullptr);
+  uint32_t getCycleCount() { return (uint32_t)(mockClockMicros() * 80); }
+  uint8_t getCpuFreqMHz() { return 80; }
+  void restart();
+
+  // Sleeping advances the virtual clock, drops WiFi and the wall clock and wakes with a reset
+  [[noreturn]] void deepSleep(uint64_t timeUs, RFMode mode = RF_DEFAULT);
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+  rst_info *getResetInfoPtr() { return &resetInfo; }
+
+private:
+  rst_info resetInfo = {REASON_DEFAULT_RST};
+};
+
+extern EspClass ESP;
+
+#endif //__NATIVE_ARDUINO_H__
@@ -0,0 +1,77 @@
+#ifndef __NATIVE_ESP8266HTTPCLIENT_H__
+#define __NATIVE_ESP8266HTTPCLIENT_H__
+
+#include "HttpSink.h"
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_FAILED (-1)
+
+//
+// HTTPClient that routes every request through the host HttpSink. Like the real one it opens the
+// connection on the first request and, with reuse on (the default), keeps it open across end()
+//
+class HTTPClient
+{
+public:
+  bool begin(WiFiClient &client, const String &url)
+  {
+    this->client = &client;
+    this->url = url;
+    headers.clear();
+    return true;
+  }
+
+  void setReuse(bool reuse) { this->reuse = reuse; }
+  void setTimeout(uint16_t timeout) { (void)timeout; }
+
+  void addHeader(const String &name, const String &value)
+  {
+    headers += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+  }
+
+  int GET() { return send("GET", nullptr, 0); }
+  int POST(const uint8_t *payload, size_t size) { return send("POST", payload, size); }
+  int POST(const String &payload) { return POST((const uint8_t *)payload.c_str(), payload.length()); }
+
+  String getString() { return String(); }
+  static String errorToString(int error) { return String("HTTP error ") + String(error); }
+  void end()
+  {
+    if (client != nullptr && !reuse)
+      client->stop();
+  }
+
+private:
+  int send(const char *method, const uint8_t *payload, size_t size)
+  {
+    if (client == nullptr)
+      return HTTPC_ERROR_CONNECTION_FAILED;
+
+    if (!client->connected())
+    {
+      // host[:port] after the scheme
+      std::string rest(url.c_str());
+      size_t start = rest.find("://");
+      start = start == std::string::npos ? 0 : start + 3;
+      std::string host = rest.substr(start, rest.find('/', start) - start);
+      size_t colon = host.find(':');
+      uint16_t port = colon != std::string::npos ? atoi(host.c_str() + colon + 1) : url.startsWith("https:") ? 443 : 80;
+      if (!client->connect(host.substr(0, colon).c_str(), port))
+        return HTTPC_ERROR_CONNECTION_FAILED;
+    }
+
+    int status = httpSink.request(method, url, headers, payload, size);
+    if (status < 0)
+      client->stop();
+    else
+      client->markUsed();
+    return status;
+  }
+
+  WiFiClient *client = nullptr;
+  bool reuse = true;
+  String url;
+  std::string headers;
+};
+
+#endif //__NATIVE_ESP8266HTTPCLIENT_H__
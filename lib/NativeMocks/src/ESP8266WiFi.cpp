@@ -0,0 +1,110 @@
+#include "ESP8266WiFi.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+
+ESP8266WiFiClass WiFi;
+
+bool ESP8266WiFiClass::mode(WiFiMode_t mode)
+{
+  wifiMode = mode;
+  if (mode == WIFI_OFF)
+    setConnected(false);
+  updateRadio();
+  return true;
+}
+
+bool ESP8266WiFiClass::forceSleepBegin()
+{
+  sleeping = true;
+  setConnected(false);
+  updateRadio();
+  return true;
+}
+
+bool ESP8266WiFiClass::forceSleepWake()
+{
+  sleeping = false;
+  updateRadio();
+  return true;
+}
+
+void ESP8266WiFiClass::updateRadio()
+{
+  // The virtual clock rather than millis(), which restarts after a deep sleep
+  uint64_t now = mockClockMicros() / 1000;
+  if (radioOn)
+    radioTotalMs += now - radioOnSinceMs;
+  radioOn = wifiMode != WIFI_OFF && !sleeping;
+  radioOnSinceMs = now;
+}
+
+uint64_t ESP8266WiFiClass::radioOnMs() const
+{
+  return radioTotalMs + (radioOn ? mockClockMicros() / 1000 - radioOnSinceMs : 0);
+}
+
+bool ESP8266WiFiClass::config(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns)
+{
+  (void)gateway;
+  (void)subnet;
+  (void)dns;
+  staticIp = ip.isSet();
+  return true;
+}
+
+wl_status_t ESP8266WiFiClass::begin()
+{
+  return begin(SSID().c_str(), psk().c_str(), configChannel, bssidSet ? configBssid : nullptr);
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char *ssid, const char *psk, int32_t channel, const uint8_t *bssid)
+{
+  (void)ssid;
+  (void)psk;
+  if (wifiMode == WIFI_OFF)
+    mode(WIFI_STA);
+  configChannel = channel;
+  bssidSet = bssid != nullptr;
+  if (bssidSet)
+    memcpy(configBssid, bssid, sizeof(configBssid));
+
+  // A stale BSSID or channel never associates, the firmware has to fall back to a scan
+  bool direct = channel != 0 && bssid != nullptr;
+  if (direct && (channel != this->channel() || memcmp(bssid, this->bssid, sizeof(this->bssid)) != 0))
+  {
+    associating = false;
+    connected = false;
+    return WL_DISCONNECTED;
+  }
+
+  associating = available && !sleeping;
+  associatedAtMs = millis() + (direct ? 0 : WIFI_SCAN_MS) + WIFI_JOIN_MS + (staticIp ? 0 : WIFI_DHCP_MS);
+  return WL_DISCONNECTED;
+}
+
+bool ESP8266WiFiClass::isConnected()
+{
+  if (associating && (int32_t)(millis() - associatedAtMs) >= 0)
+  {
+    associating = false;
+    connected = true;
+    links++;
+  }
+  return connected;
+}
+
+int ESP8266WiFiClass::hostByName(const char *host, IPAddress &result)
+{
+  if (!isConnected())
+    return 0;
+
+  struct addrinfo hints = {};
+  struct addrinfo *addr = nullptr;
+  hints.ai_family = AF_INET;
+  if (getaddrinfo(host, nullptr, &hints, &addr) != 0)
+    return 0;
+  result = IPAddress(((struct sockaddr_in *)addr->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(addr);
+  return 1;
+}
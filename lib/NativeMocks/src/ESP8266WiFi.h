@@ -0,0 +1,103 @@
+#ifndef __NATIVE_ESP8266WIFI_H__
+#define __NATIVE_ESP8266WIFI_H__
+
+#include <Arduino.h>
+#include "IPAddress.h"
+
+typedef enum
+{
+  WIFI_OFF = 0,
+  WIFI_STA = 1
+} WiFiMode_t;
+
+typedef enum
+{
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+//
+// Station interface whose link state is driven by the host runner to simulate outages. begin()
+// associates after the time a scan, the association and DHCP take; a known channel and BSSID skip
+// the scan and a static IP skips DHCP. Like the SDK's station config, the channel and BSSID stay
+// set for a later begin() without arguments. While the runner makes the network unavailable begin()
+// never associates. The time the radio is powered (station mode, not force-slept) is totalled on
+// the virtual clock
+//
+#define WIFI_SCAN_MS 2000
+#define WIFI_JOIN_MS 300
+#define WIFI_DHCP_MS 1200
+
+class ESP8266WiFiClass
+{
+public:
+  bool mode(WiFiMode_t mode);
+  bool forceSleepBegin();
+  bool forceSleepWake();
+  void persistent(bool persistent) { (void)persistent; }
+  bool config(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns = IPAddress());
+  wl_status_t begin();
+  wl_status_t begin(const char *ssid, const char *psk, int32_t channel = 0, const uint8_t *bssid = nullptr);
+
+  String SSID() const { return String("native"); }
+  String psk() const { return String("password"); }
+  const uint8_t *BSSID() const { return bssid; }
+  int32_t channel() const { return 6; }
+  IPAddress localIP() const { return connected ? IPAddress(192, 168, 1, 42) : IPAddress(); }
+  IPAddress gatewayIP() const { return connected ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+  IPAddress subnetMask() const { return connected ? IPAddress(255, 255, 255, 0) : IPAddress(); }
+  IPAddress dnsIP() const { return connected ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+
+  wl_status_t status() { return isConnected() ? WL_CONNECTED : WL_DISCONNECTED; }
+  bool isConnected();
+  int8_t RSSI() { return isConnected() ? rssi : 31; }
+  // Looked up on the host, IPv4 only
+  int hostByName(const char *host, IPAddress &result);
+  bool disconnect(bool wifiOff = false)
+  {
+    (void)wifiOff;
+    connected = false;
+    return true;
+  }
+
+  // A force-slept radio stays disconnected
+  void setConnected(bool connected)
+  {
+    if (connected && !sleeping && !this->connected)
+      links++;
+    this->connected = connected && !sleeping;
+    associating = false;
+  }
+  void setAvailable(bool available) { this->available = available; }
+  void setRSSI(int8_t rssi) { this->rssi = rssi; }
+  uint64_t radioOnMs() const;
+  // Counts associations, sockets opened on an earlier one are gone
+  uint32_t linkCount() { return isConnected() ? links : links + 1; }
+
+private:
+  void updateRadio();
+
+  bool connected = false;
+  uint32_t links = 0;
+  bool available = true;
+  WiFiMode_t wifiMode = WIFI_OFF;
+  bool sleeping = false;
+  bool radioOn = false;
+  uint64_t radioOnSinceMs = 0;
+  uint64_t radioTotalMs = 0;
+  bool associating = false;
+  bool staticIp = false;
+  int32_t configChannel = 0;
+  uint8_t configBssid[6] = {};
+  bool bssidSet = false;
+  uint32_t associatedAtMs = 0;
+  int8_t rssi = -62;
+  const uint8_t bssid[6] = {0x02, 0x00, 0x5e, 0x10, 0x00, 0x01};
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif //__NATIVE_ESP8266WIFI_H__
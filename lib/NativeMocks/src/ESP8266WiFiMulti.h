@@ -0,0 +1,19 @@
+#ifndef __NATIVE_ESP8266WIFIMULTI_H__
+#define __NATIVE_ESP8266WIFIMULTI_H__
+
+#include "ESP8266WiFi.h"
+
+class ESP8266WiFiMulti
+{
+public:
+  bool addAP(const char *ssid, const char *passphrase = nullptr)
+  {
+    (void)ssid;
+    (void)passphrase;
+    return true;
+  }
+
+  wl_status_t run() { return WiFi.status(); }
+};
+
+#endif //__NATIVE_ESP8266WIFIMULTI_H__
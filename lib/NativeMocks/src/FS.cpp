@@ -0,0 +1,156 @@
+#include "FS.h"
+#include "LittleFS.h"
+#include "MockHeap.h"
+
+FS LittleFS;
+
+File::File(std::shared_ptr<FileData_t> data, size_t position, bool writable, bool append, const char *name)
+    : data(data), pos(position), writable(writable), append(append), path(name)
+{
+}
+
+size_t File::write(const uint8_t *buffer, size_t size)
+{
+  MockHeapHostScope hostOnly;
+  if (!data || !writable)
+    return 0;
+
+  if (append)
+    pos = data->size();
+  if (pos + size > data->size())
+    data->resize(pos + size);
+  memcpy(data->data() + pos, buffer, size);
+  pos += size;
+
+  LittleFS.fsStats.writes++;
+  LittleFS.fsStats.bytesWritten += size;
+  return size;
+}
+
+int File::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek()
+{
+  return data && pos < data->size() ? (*data)[pos] : -1;
+}
+
+size_t File::read(uint8_t *buffer, size_t size)
+{
+  if (!data || pos >= data->size())
+    return 0;
+
+  size_t n = std::min(size, data->size() - pos);
+  memcpy(buffer, data->data() + pos, n);
+  pos += n;
+
+  LittleFS.fsStats.bytesRead += n;
+  return n;
+}
+
+bool File::seek(uint32_t offset, SeekMode mode)
+{
+  if (!data)
+    return false;
+
+  size_t base = mode == SeekSet ? 0 : mode == SeekCur ? pos : data->size();
+  if (base + offset > data->size())
+    return false;
+  pos = base + offset;
+  return true;
+}
+
+File FS::open(const char *path, const char *mode)
+{
+  MockHeapHostScope hostOnly;
+  if (!mounted || path == nullptr)
+    return File();
+
+  fsStats.opens++;
+  auto it = files.find(path);
+  bool plus = strchr(mode, '+') != nullptr;
+
+  switch (mode[0])
+  {
+  case 'r':
+    if (it == files.end())
+      return File();
+    return File(it->second, 0, plus, false, path);
+  case 'w':
+  {
+    auto data = std::make_shared<FileData_t>();
+    files[path] = data;
+    return File(data, 0, true, false, path);
+  }
+  case 'a':
+  {
+    if (it == files.end())
+      it = files.emplace(path, std::make_shared<FileData_t>()).first;
+    return File(it->second, it->second->size(), true, true, path);
+  }
+  default:
+    return File();
+  }
+}
+
+bool FS::exists(const char *path) const
+{
+  return files.count(path) > 0 || dirs.count(path) > 0;
+}
+
+bool FS::remove(const char *path)
+{
+  return files.erase(path) > 0;
+}
+
+bool FS::rename(const char *from, const char *to)
+{
+  auto it = files.find(from);
+  if (it == files.end())
+    return false;
+
+  files[to] = it->second;
+  files.erase(from);
+  return true;
+}
+
+bool FS::mkdir(const char *path)
+{
+  dirs.insert(path);
+  return true;
+}
+
+bool FS::loadFile(const char *path, const char *hostPath)
+{
+  FILE *in = fopen(hostPath, "rb");
+  if (in == nullptr)
+    return false;
+
+  auto data = std::make_shared<FileData_t>();
+  uint8_t buf[512];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    data->insert(data->end(), buf, buf + n);
+  fclose(in);
+
+  files[path] = data;
+  return true;
+}
+
+bool FS::saveFile(const char *path, const char *hostPath) const
+{
+  auto it = files.find(path);
+  if (it == files.end())
+    return false;
+
+  FILE *out = fopen(hostPath, "wb");
+  if (out == nullptr)
+    return false;
+
+  bool ok = fwrite(it->second->data(), 1, it->second->size(), out) == it->second->size();
+  fclose(out);
+  return ok;
+}
@@ -0,0 +1,92 @@
+#ifndef __NATIVE_FS_H__
+#define __NATIVE_FS_H__
+
+#include <Arduino.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+enum SeekMode
+{
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+typedef std::vector<uint8_t> FileData_t;
+
+class File : public Stream
+{
+public:
+  File() {}
+  File(std::shared_ptr<FileData_t> data, size_t position, bool writable, bool append, const char *name);
+
+  operator bool() const { return data != nullptr; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+
+  int available() override { return data ? data->size() - pos : 0; }
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t *buffer, size_t size);
+  using Stream::readBytes;
+
+  bool seek(uint32_t offset, SeekMode mode = SeekSet);
+  size_t position() const { return pos; }
+  size_t size() const { return data ? data->size() : 0; }
+  const char *name() const { return path.c_str(); }
+  void flush() {}
+  void close() { data.reset(); }
+
+private:
+  std::shared_ptr<FileData_t> data;
+  size_t pos = 0;
+  bool writable = false;
+  bool append = false;
+  std::string path;
+};
+
+typedef struct
+{
+  uint32_t opens;
+  uint32_t writes;
+  uint64_t bytesWritten;
+  uint64_t bytesRead;
+} FsStats_t;
+
+//
+// In-memory file system with the LittleFS API surface used by the firmware
+//
+class FS
+{
+public:
+  bool begin() { return mounted = true; }
+  void end() { mounted = false; }
+
+  File open(const char *path, const char *mode);
+  File open(const String &path, const char *mode) { return open(path.c_str(), mode); }
+  bool exists(const char *path) const;
+  bool exists(const String &path) const { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool remove(const String &path) { return remove(path.c_str()); }
+  bool rename(const char *from, const char *to);
+  bool mkdir(const char *path);
+  bool mkdir(const String &path) { return mkdir(path.c_str()); }
+
+  bool loadFile(const char *path, const char *hostPath);
+  bool saveFile(const char *path, const char *hostPath) const;
+  const FsStats_t &stats() const { return fsStats; }
+  FsStats_t fsStats = {};
+
+private:
+  bool mounted = false;
+  std::map<std::string, std::shared_ptr<FileData_t>> files;
+  std::set<std::string> dirs;
+};
+
+#endif //__NATIVE_FS_H__
@@ -0,0 +1,238 @@
+#include "HttpSink.h"
+#include "ESP8266WiFi.h"
+#include "MockHeap.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+HttpSink httpSink;
+
+typedef struct
+{
+  const uint8_t *in;
+  size_t length;
+  size_t pos;
+  uint8_t bit;
+} BitReader_t;
+
+static int readBits(BitReader_t &r, uint8_t count)
+{
+  int value = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (r.pos >= r.length)
+      return -1;
+    value |= ((r.in[r.pos] >> r.bit) & 1) << i;
+    if (++r.bit == 8)
+    {
+      r.bit = 0;
+      r.pos++;
+    }
+  }
+  return value;
+}
+
+// Fixed-code literal/length symbol, the code is read most significant bit first
+static int readFixedSymbol(BitReader_t &r)
+{
+  int code = 0;
+  for (uint8_t length = 1; length <= 9; length++)
+  {
+    int bit = readBits(r, 1);
+    if (bit < 0)
+      return -1;
+    code = (code << 1) | bit;
+    if (length == 7 && code <= 0x17)
+      return 256 + code;
+    if (length == 8 && code >= 0x30 && code <= 0xbf)
+      return code - 0x30;
+    if (length == 8 && code >= 0xc0 && code <= 0xc7)
+      return 280 + code - 0xc0;
+    if (length == 9 && code >= 0x190)
+      return 144 + code - 0x190;
+  }
+  return -1;
+}
+
+static uint32_t crc32(const uint8_t *data, size_t length)
+{
+  uint32_t crc = 0xffffffff;
+  while (length--)
+  {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+  }
+  return ~crc;
+}
+
+//
+// Inflates a gzip member made of stored and fixed-code blocks, which is all the firmware's
+// deflater produces. Returns false on anything else or a CRC mismatch
+//
+static bool gunzip(const uint8_t *body, size_t length, std::string &out)
+{
+  static const uint16_t lengthBase[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static const uint8_t lengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  static const uint16_t distanceBase[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                          193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+  static const uint8_t distanceExtra[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                          6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+  if (length < 18 || body[0] != 0x1f || body[1] != 0x8b || body[2] != 8 || body[3] != 0)
+    return false;
+
+  BitReader_t r = {body, length - 8, 10, 0};
+  int final;
+  do
+  {
+    final = readBits(r, 1);
+    int type = readBits(r, 2);
+    if (type == 0)
+    {
+      if (r.bit > 0)
+      {
+        r.bit = 0;
+        r.pos++;
+      }
+      if (r.pos + 4 > r.length)
+        return false;
+      size_t stored = body[r.pos] | (body[r.pos + 1] << 8);
+      r.pos += 4;
+      if (r.pos + stored > r.length)
+        return false;
+      out.append((const char *)body + r.pos, stored);
+      r.pos += stored;
+      continue;
+    }
+    if (type != 1)
+      return false;
+
+    for (;;)
+    {
+      int symbol = readFixedSymbol(r);
+      if (symbol < 0 || symbol > 285)
+        return false;
+      if (symbol < 256)
+      {
+        out += (char)symbol;
+        continue;
+      }
+      if (symbol == 256)
+        break;
+      int extra = readBits(r, lengthExtra[symbol - 257]);
+      int code = 0;
+      for (uint8_t i = 0; i < 5; i++)
+        code = (code << 1) | readBits(r, 1);
+      if (extra < 0 || code < 0 || code > 29)
+        return false;
+      int distanceBits = readBits(r, distanceExtra[code]);
+      size_t matchLength = lengthBase[symbol - 257] + extra;
+      size_t distance = distanceBase[code] + distanceBits;
+      if (distanceBits < 0 || distance > out.size())
+        return false;
+      for (size_t i = 0; i < matchLength; i++)
+        out += out[out.size() - distance];
+    }
+  } while (final == 0);
+
+  const uint8_t *trailer = body + length - 8;
+  uint32_t crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+  uint32_t size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((uint32_t)trailer[7] << 24);
+  return size == out.size() && crc == crc32((const uint8_t *)out.data(), out.size());
+}
+
+int HttpSink::request(const char *method, const String &url, const std::string &headers, const uint8_t *body, size_t length)
+{
+  MockHeapHostScope hostOnly;
+  sinkStats.requests++;
+  delay(latencyMs);
+
+  if (!WiFi.isConnected() || failing)
+  {
+    sinkStats.failed++;
+    return -1;
+  }
+
+  sinkStats.headerBytes += headers.size() + url.length() + strlen(method);
+  sinkStats.bodyBytes += length;
+
+  // Lines are counted in what the server would decode, a body that doesn't is rejected like InfluxDB does
+  std::string inflated;
+  if (headers.find("Content-Encoding: gzip\r\n") != std::string::npos)
+  {
+    if (!gunzip(body, length, inflated))
+    {
+      sinkStats.failed++;
+      return 400;
+    }
+    sinkStats.gzipBodies++;
+    sinkStats.inflatedBytes += inflated.size();
+  }
+  const uint8_t *text = inflated.empty() ? body : (const uint8_t *)inflated.data();
+  size_t textLength = inflated.empty() ? length : inflated.size();
+  for (size_t i = 0; i < textLength; i++)
+  {
+    if (text[i] == '\n')
+      sinkStats.lines++;
+  }
+  if (textLength > 0 && text[textLength - 1] != '\n')
+    sinkStats.lines++;
+
+  int status = forwarding ? forward(method, url, headers, body, length) : 204;
+  if (status < 200 || status >= 300)
+    sinkStats.failed++;
+  return status;
+}
+
+int HttpSink::forward(const char *method, const String &url, const std::string &headers, const uint8_t *body, size_t length)
+{
+  if (!url.startsWith("http://"))
+    return -1;
+
+  std::string rest(url.c_str() + 7);
+  size_t slash = rest.find('/');
+  std::string hostPort = rest.substr(0, slash);
+  std::string path = slash == std::string::npos ? "/" : rest.substr(slash);
+  size_t colon = hostPort.find(':');
+  std::string host = hostPort.substr(0, colon);
+  std::string port = colon == std::string::npos ? "80" : hostPort.substr(colon + 1);
+
+  struct addrinfo hints = {};
+  struct addrinfo *addr = nullptr;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addr) != 0)
+    return -1;
+
+  int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+  if (fd < 0 || connect(fd, addr->ai_addr, addr->ai_addrlen) != 0)
+  {
+    if (fd >= 0)
+      close(fd);
+    freeaddrinfo(addr);
+    return -1;
+  }
+  freeaddrinfo(addr);
+
+  std::string request = std::string(method) + " " + path + " HTTP/1.1\r\nHost: " + hostPort +
+                        "\r\nConnection: close\r\nContent-Length: " + std::to_string(length) + "\r\n" + headers + "\r\n";
+  request.append((const char *)body, length);
+
+  bool sent = send(fd, request.data(), request.size(), 0) == (ssize_t)request.size();
+
+  // Read until the server closes so it never sees a reset mid-response
+  char response[64] = {};
+  ssize_t received = sent ? recv(fd, response, sizeof(response) - 1, 0) : -1;
+  char discard[256];
+  while (received > 0 && recv(fd, discard, sizeof(discard), 0) > 0)
+    ;
+  close(fd);
+
+  int status;
+  if (received <= 0 || sscanf(response, "HTTP/1.%*d %d", &status) != 1)
+    return -1;
+  return status;
+}
@@ -0,0 +1,46 @@
+#ifndef __NATIVE_HTTPSINK_H__
+#define __NATIVE_HTTPSINK_H__
+
+#include <Arduino.h>
+
+#include <string>
+
+typedef struct
+{
+  uint32_t requests;
+  uint32_t failed;
+  uint64_t bodyBytes;
+  uint64_t headerBytes;
+  uint32_t lines;
+  uint32_t gzipBodies;
+  uint64_t inflatedBytes;
+} HttpSinkStats_t;
+
+//
+// Destination of every HTTP request made by the mocked clients. By default it answers 204 while WiFi
+// is up and just counts traffic; with forwarding enabled plain http:// requests are sent for real,
+// e.g. to tools/influx_standin.py, for end-to-end runs. gzip bodies are inflated to count their lines
+//
+class HttpSink
+{
+public:
+  void setForwarding(bool forwarding) { this->forwarding = forwarding; }
+  void setLatency(uint32_t ms) { latencyMs = ms; }
+  void setFailing(bool failing) { this->failing = failing; }
+
+  int request(const char *method, const String &url, const std::string &headers, const uint8_t *body, size_t length);
+
+  const HttpSinkStats_t &stats() const { return sinkStats; }
+
+private:
+  int forward(const char *method, const String &url, const std::string &headers, const uint8_t *body, size_t length);
+
+  bool forwarding = false;
+  bool failing = false;
+  uint32_t latencyMs = 150;
+  HttpSinkStats_t sinkStats = {};
+};
+
+extern HttpSink httpSink;
+
+#endif //__NATIVE_HTTPSINK_H__
@@ -0,0 +1,38 @@
+#ifndef __NATIVE_IPADDRESS_H__
+#define __NATIVE_IPADDRESS_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+class IPAddress
+{
+public:
+  IPAddress() : address(0) {}
+  IPAddress(uint32_t address) : address(address) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+
+  operator uint32_t() const { return address; }
+  bool isSet() const { return address != 0; }
+
+  // Dotted quad only, like the device
+  bool fromString(const char *text)
+  {
+    uint32_t parsed = 0;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+      char *end;
+      long part = strtol(text, &end, 10);
+      if (end == text || part < 0 || part > 255 || *end != (i < 3 ? '.' : '\0'))
+        return false;
+      parsed |= (uint32_t)part << (8 * i);
+      text = end + 1;
+    }
+    address = parsed;
+    return true;
+  }
+
+private:
+  uint32_t address;
+};
+
+#endif //__NATIVE_IPADDRESS_H__
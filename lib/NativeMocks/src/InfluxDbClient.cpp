@@ -0,0 +1,105 @@
+#include "InfluxDbClient.h"
+#include "InfluxDbCloud.h"
+#include "HttpSink.h"
+
+const char InfluxDbCloud2CACert[] = "";
+
+static const char *precisionParam(WritePrecision precision)
+{
+  switch (precision)
+  {
+  case WritePrecision::S:
+    return "&precision=s";
+  case WritePrecision::MS:
+    return "&precision=ms";
+  case WritePrecision::US:
+    return "&precision=us";
+  case WritePrecision::NS:
+    return "&precision=ns";
+  default:
+    return "";
+  }
+}
+
+void InfluxDBClient::setConnectionParams(const char *serverUrl, const char *org, const char *bucket,
+                                         const char *authToken, const char *certInfo)
+{
+  (void)certInfo;
+  this->serverUrl = serverUrl ? serverUrl : "";
+  writeUrl = this->serverUrl + "/api/v2/write?org=" + (org ? org : "") + "&bucket=" + (bucket ? bucket : "") +
+             precisionParam(writeOptions._writePrecision);
+  authHeader = std::string("Authorization: Token ") + (authToken ? authToken : "") + "\r\n";
+}
+
+void InfluxDBClient::setWriteOptions(const WriteOptions &options)
+{
+  writeOptions = options;
+  int end = writeUrl.indexOf("&precision=");
+  if (end >= 0)
+    writeUrl = writeUrl.substring(0, end);
+  writeUrl += precisionParam(writeOptions._writePrecision);
+}
+
+bool InfluxDBClient::validateConnection()
+{
+  lastStatusCode = httpSink.request("GET", serverUrl + "/health", authHeader, nullptr, 0);
+  if (lastStatusCode == 204 || lastStatusCode == 200)
+    return true;
+
+  lastError = String("health check failed with status ") + String(lastStatusCode);
+  return false;
+}
+
+bool InfluxDBClient::writeRecord(const char *record)
+{
+  if (buffer.size() >= writeOptions._bufferSize)
+    buffer.pop_front();
+  buffer.push_back(record);
+
+  if (buffer.size() >= writeOptions._batchSize)
+    return sendBatch(writeOptions._batchSize);
+  return true;
+}
+
+bool InfluxDBClient::flushBuffer()
+{
+  while (!buffer.empty())
+  {
+    if (!sendBatch(std::min<size_t>(buffer.size(), writeOptions._batchSize)))
+      return false;
+  }
+  return true;
+}
+
+bool InfluxDBClient::sendBatch(size_t count)
+{
+  std::string body;
+  for (size_t i = 0; i < count; i++)
+  {
+    if (i > 0)
+      body += '\n';
+    body += buffer[i];
+  }
+
+  lastStatusCode = httpSink.request("POST", writeUrl, authHeader, (const uint8_t *)body.data(), body.size());
+  if (lastStatusCode < 200 || lastStatusCode >= 300)
+  {
+    lastError = String("write failed with status ") + String(lastStatusCode);
+    return false;
+  }
+
+  buffer.erase(buffer.begin(), buffer.begin() + count);
+  return true;
+}
+
+void timeSync(const char *tzInfo, const char *ntpServer1, const char *ntpServer2, const char *ntpServer3)
+{
+  (void)ntpServer1;
+  (void)ntpServer2;
+  (void)ntpServer3;
+  setenv("TZ", tzInfo, 1);
+  tzset();
+  // Blocks until the clock is set
+  delay(MOCK_NTP_MS);
+  mockClockSync();
+}
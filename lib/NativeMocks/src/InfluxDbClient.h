@@ -0,0 +1,103 @@
+#ifndef __NATIVE_INFLUXDBCLIENT_H__
+#define __NATIVE_INFLUXDBCLIENT_H__
+
+#include <Arduino.h>
+#include "Point.h"
+
+#include <deque>
+#include <string>
+
+enum class WritePrecision : uint8_t
+{
+  NoTime = 0,
+  S,
+  MS,
+  US,
+  NS
+};
+
+class WriteOptions
+{
+public:
+  WriteOptions &writePrecision(WritePrecision precision)
+  {
+    _writePrecision = precision;
+    return *this;
+  }
+  WriteOptions &batchSize(uint16_t size)
+  {
+    _batchSize = size;
+    return *this;
+  }
+  WriteOptions &bufferSize(uint16_t size)
+  {
+    _bufferSize = size;
+    return *this;
+  }
+  WriteOptions &flushInterval(uint16_t seconds)
+  {
+    _flushInterval = seconds;
+    return *this;
+  }
+
+  WritePrecision _writePrecision = WritePrecision::NoTime;
+  uint16_t _batchSize = 1;
+  uint16_t _bufferSize = 5;
+  uint16_t _flushInterval = 60;
+};
+
+class HTTPOptions
+{
+public:
+  HTTPOptions &connectionReuse(bool reuse)
+  {
+    _connectionReuse = reuse;
+    return *this;
+  }
+
+  bool _connectionReuse = false;
+};
+
+//
+// Buffering and batching behave like the real client (records are queued, a full batch is sent
+// from writeRecord, the oldest record is dropped when the buffer overflows) but requests go to
+// the host HttpSink
+//
+class InfluxDBClient
+{
+public:
+  void setConnectionParams(const char *serverUrl, const char *org, const char *bucket, const char *authToken,
+                           const char *certInfo = nullptr);
+  void setInsecure(bool insecure) { (void)insecure; }
+  void setWriteOptions(const WriteOptions &options);
+  void setHTTPOptions(const HTTPOptions &options) { httpOptions = options; }
+
+  bool validateConnection();
+
+  bool writeRecord(const char *record);
+  bool writeRecord(String &record) { return writeRecord(record.c_str()); }
+  bool flushBuffer();
+
+  bool isBufferEmpty() const { return buffer.empty(); }
+  bool isBufferFull() const { return buffer.size() >= writeOptions._bufferSize; }
+
+  String getServerUrl() const { return serverUrl; }
+  String getLastErrorMessage() const { return lastError; }
+  int getLastStatusCode() const { return lastStatusCode; }
+
+private:
+  bool sendBatch(size_t count);
+
+  String serverUrl;
+  String writeUrl;
+  std::string authHeader;
+  WriteOptions writeOptions;
+  HTTPOptions httpOptions;
+  std::deque<std::string> buffer;
+  String lastError;
+  int lastStatusCode = 0;
+};
+
+void timeSync(const char *tzInfo, const char *ntpServer1, const char *ntpServer2 = nullptr, const char *ntpServer3 = nullptr);
+
+#endif //__NATIVE_INFLUXDBCLIENT_H__
@@ -0,0 +1,6 @@
+#ifndef __NATIVE_INFLUXDBCLOUD_H__
+#define __NATIVE_INFLUXDBCLOUD_H__
+
+extern const char InfluxDbCloud2CACert[];
+
+#endif //__NATIVE_INFLUXDBCLOUD_H__
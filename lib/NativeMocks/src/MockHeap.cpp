@@ -0,0 +1,183 @@
+#include "MockHeap.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+MockHeap mockHeap;
+
+#define MOCK_HEAP_UNPLACED UINT32_MAX
+
+// In front of every allocation, padded so what follows keeps malloc's alignment
+typedef struct alignas(16)
+{
+  uint32_t start;
+  uint32_t blocks;
+  uint32_t generation;
+} MockHeapHeader_t;
+
+MockHeap::MockHeap()
+{
+  setSize(MOCK_HEAP_BYTES);
+}
+
+void MockHeap::setSize(uint32_t bytes)
+{
+  heapBytes = bytes;
+  reboot();
+  memset(&heapStats, 0, sizeof(heapStats));
+  heapStats.lowestFree = freeBytes();
+  heapStats.lowestMaxBlock = maxFreeBlock();
+  clearWindow();
+}
+
+void MockHeap::reboot()
+{
+  generation++;
+  extents[0] = {0, heapBytes / MOCK_HEAP_BLOCK};
+  extentCount = 1;
+  freeBlocks = extents[0].blocks;
+}
+
+void MockHeap::clearWindow()
+{
+  memset(&windowHeapStats, 0, sizeof(windowHeapStats));
+  windowHeapStats.lowestFree = freeBytes();
+  windowHeapStats.lowestMaxBlock = maxFreeBlock();
+  windowHeapStats.maxFragmentation = fragmentation();
+}
+
+void *MockHeap::malloc(size_t size)
+{
+  MockHeapHeader_t *header = (MockHeapHeader_t *)::malloc(sizeof(MockHeapHeader_t) + (size ? size : 1));
+  if (header == nullptr)
+    return nullptr;
+
+  header->start = MOCK_HEAP_UNPLACED;
+  header->blocks = 0;
+  header->generation = generation;
+  if (tracking)
+  {
+    header->blocks = (size + MOCK_HEAP_OVERHEAD + MOCK_HEAP_BLOCK - 1) / MOCK_HEAP_BLOCK;
+    header->start = place(header->blocks);
+  }
+  return header + 1;
+}
+
+void MockHeap::free(void *ptr)
+{
+  if (ptr == nullptr)
+    return;
+
+  MockHeapHeader_t *header = (MockHeapHeader_t *)ptr - 1;
+  if (header->start != MOCK_HEAP_UNPLACED && header->generation == generation)
+    release(header->start, header->blocks);
+  ::free(header);
+}
+
+uint32_t MockHeap::place(uint32_t blocks)
+{
+  // Best fit, the block is carved from the front of the smallest free extent that takes it
+  uint32_t best = extentCount;
+  for (uint32_t i = 0; i < extentCount; i++)
+  {
+    if (extents[i].blocks >= blocks && (best == extentCount || extents[i].blocks < extents[best].blocks))
+      best = i;
+  }
+  if (best == extentCount)
+  {
+    record(heapStats, false);
+    record(windowHeapStats, false);
+    return MOCK_HEAP_UNPLACED;
+  }
+
+  uint32_t start = extents[best].start;
+  extents[best].start += blocks;
+  extents[best].blocks -= blocks;
+  if (extents[best].blocks == 0)
+  {
+    memmove(&extents[best], &extents[best + 1], (extentCount - best - 1) * sizeof(Extent_t));
+    extentCount--;
+  }
+  freeBlocks -= blocks;
+
+  record(heapStats, true);
+  record(windowHeapStats, true);
+  return start;
+}
+
+void MockHeap::record(MockHeapStats_t &stats, bool placed)
+{
+  stats.allocations++;
+  if (!placed)
+  {
+    stats.outOfMemory++;
+    return;
+  }
+  stats.lowestFree = std::min(stats.lowestFree, freeBytes());
+  stats.lowestMaxBlock = std::min(stats.lowestMaxBlock, maxFreeBlock());
+  stats.maxFragmentation = std::max(stats.maxFragmentation, fragmentation());
+}
+
+void MockHeap::release(uint32_t start, uint32_t blocks)
+{
+  freeBlocks += blocks;
+
+  // Extents are kept sorted by address, a freed block merges with its free neighbours
+  uint32_t next = 0;
+  while (next < extentCount && extents[next].start < start)
+    next++;
+  bool joinsPrevious = next > 0 && extents[next - 1].start + extents[next - 1].blocks == start;
+  bool joinsNext = next < extentCount && start + blocks == extents[next].start;
+
+  if (joinsPrevious && joinsNext)
+  {
+    extents[next - 1].blocks += blocks + extents[next].blocks;
+    memmove(&extents[next], &extents[next + 1], (extentCount - next - 1) * sizeof(Extent_t));
+    extentCount--;
+  }
+  else if (joinsPrevious)
+  {
+    extents[next - 1].blocks += blocks;
+  }
+  else if (joinsNext)
+  {
+    extents[next].start = start;
+    extents[next].blocks += blocks;
+  }
+  else if (extentCount < MOCK_HEAP_EXTENTS_MAX)
+  {
+    memmove(&extents[next + 1], &extents[next], (extentCount - next) * sizeof(Extent_t));
+    extents[next] = {start, blocks};
+    extentCount++;
+  }
+  else
+  {
+    // Too many holes to track, this one is lost to the model
+    freeBlocks -= blocks;
+  }
+}
+
+uint32_t MockHeap::maxFreeBlock() const
+{
+  uint32_t largest = 0;
+  for (uint32_t i = 0; i < extentCount; i++)
+  {
+    if (extents[i].blocks > largest)
+      largest = extents[i].blocks;
+  }
+  return largest > 0 ? largest * MOCK_HEAP_BLOCK - MOCK_HEAP_OVERHEAD : 0;
+}
+
+uint8_t MockHeap::fragmentation() const
+{
+  // umm_fragmentation_metric() of the core
+  if (freeBlocks == 0)
+    return 0;
+  double squares = 0;
+  for (uint32_t i = 0; i < extentCount; i++)
+    squares += (double)extents[i].blocks * extents[i].blocks;
+  return (uint8_t)(100 - sqrt(squares) * 100 / freeBlocks);
+}
@@ -0,0 +1,101 @@
+#ifndef __NATIVE_MOCKHEAP_H__
+#define __NATIVE_MOCKHEAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// umm_malloc, the ESP8266 core's allocator: 8-byte blocks, a 4-byte header per allocation and
+// best-fit placement
+//
+#define MOCK_HEAP_BLOCK 8
+#define MOCK_HEAP_OVERHEAD 4
+
+// What the D1 mini had left for the original sketch after the SDK and WiFi were up. Static RAM
+// the firmware adds comes out of the same DRAM, the runner sizes the heap with setSize()
+#define MOCK_HEAP_BYTES (40 * 1024)
+
+// Free extents the model keeps apart before it gives up on tracking the smallest ones
+#define MOCK_HEAP_EXTENTS_MAX 2048
+
+typedef struct
+{
+  uint64_t allocations;
+  // Allocations no free block of the modelled heap could take, on the device they'd have failed
+  uint32_t outOfMemory;
+  uint32_t lowestFree;
+  uint32_t lowestMaxBlock;
+  uint8_t maxFragmentation;
+} MockHeapStats_t;
+
+//
+// Replays the firmware's heap allocations onto a model of the ESP8266 heap, so getFreeHeap() and
+// getHeapStats() report the free space, largest free block and fragmentation the device would end up
+// with. Allocations still come from the host's malloc, carrying their place in the model in front.
+// Only allocations made while tracking (within setup() and loop()) are placed, everything the runner
+// and the mocks' host side allocate stays out of the model.
+//
+class MockHeap
+{
+public:
+  MockHeap();
+
+  void *malloc(size_t size);
+  void free(void *ptr);
+
+  void setTracking(bool tracking) { this->tracking = tracking; }
+  bool isTracking() const { return tracking; }
+  // A reset starts with an empty heap, blocks allocated before it are forgotten; the statistics carry on
+  void reboot();
+  // Before anything is allocated, starts the statistics over
+  void setSize(uint32_t bytes);
+  uint32_t size() const { return heapBytes; }
+
+  uint32_t freeBytes() const { return freeBlocks * MOCK_HEAP_BLOCK; }
+  uint32_t maxFreeBlock() const;
+  // 0 for a single free block, towards 100 as the free space splits into ever smaller ones
+  uint8_t fragmentation() const;
+
+  const MockHeapStats_t &stats() const { return heapStats; }
+  // The same since the last clearWindow(), e.g. per simulated day
+  const MockHeapStats_t &windowStats() const { return windowHeapStats; }
+  void clearWindow();
+
+private:
+  typedef struct
+  {
+    uint32_t start;
+    uint32_t blocks;
+  } Extent_t;
+
+  uint32_t place(uint32_t blocks);
+  void release(uint32_t start, uint32_t blocks);
+  void record(MockHeapStats_t &stats, bool placed);
+
+  bool tracking = false;
+  uint32_t heapBytes = MOCK_HEAP_BYTES;
+  uint32_t generation = 0;
+  Extent_t extents[MOCK_HEAP_EXTENTS_MAX];
+  uint32_t extentCount = 0;
+  uint32_t freeBlocks = 0;
+  MockHeapStats_t heapStats;
+  MockHeapStats_t windowHeapStats;
+};
+
+extern MockHeap mockHeap;
+
+//
+// Leaves what the mocks allocate for the host in its scope (file contents kept in RAM, recorded
+// traffic) out of the model
+//
+class MockHeapHostScope
+{
+public:
+  MockHeapHostScope() : tracking(mockHeap.isTracking()) { mockHeap.setTracking(false); }
+  ~MockHeapHostScope() { mockHeap.setTracking(tracking); }
+
+private:
+  bool tracking;
+};
+
+#endif //__NATIVE_MOCKHEAP_H__
@@ -0,0 +1,241 @@
+#include "MqttBrokerSim.h"
+#include "MockHeap.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+MqttBrokerSim mqttBroker;
+
+bool MqttFramer::feed(uint8_t byte)
+{
+  switch (stage)
+  {
+  case 0:
+    header = byte;
+    body.clear();
+    remaining = 0;
+    shift = 0;
+    stage = 1;
+    return false;
+  case 1:
+    remaining |= (uint32_t)(byte & 0x7f) << shift;
+    shift += 7;
+    if (byte & 0x80)
+      return false;
+    if (remaining > 0)
+    {
+      stage = 2;
+      return false;
+    }
+    stage = 0;
+    return true;
+  default:
+    body += (char)byte;
+    if (body.size() < remaining)
+      return false;
+    stage = 0;
+    return true;
+  }
+}
+
+static uint16_t readU16(const std::string &body, size_t pos)
+{
+  return pos + 1 < body.size() ? ((uint8_t)body[pos] << 8) | (uint8_t)body[pos + 1] : 0;
+}
+
+int MqttBrokerSim::open(const char *host, uint16_t port)
+{
+  MockHeapHostScope hostOnly;
+  int fd = -1;
+  if (forwarding)
+  {
+    struct addrinfo hints = {};
+    struct addrinfo *addr = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &addr) != 0)
+      return -1;
+    fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd < 0 || ::connect(fd, addr->ai_addr, addr->ai_addrlen) != 0)
+    {
+      if (fd >= 0)
+        ::close(fd);
+      freeaddrinfo(addr);
+      return -1;
+    }
+    freeaddrinfo(addr);
+  }
+
+  int stream = nextStream++;
+  Connection_t &connection = connections[stream];
+  connection.fd = fd;
+  connection.outstanding = 0;
+  return stream;
+}
+
+void MqttBrokerSim::close(int stream)
+{
+  MockHeapHostScope hostOnly;
+  auto it = connections.find(stream);
+  if (it == connections.end())
+    return;
+  if (it->second.fd >= 0)
+    ::close(it->second.fd);
+  connections.erase(it);
+}
+
+size_t MqttBrokerSim::write(int stream, const uint8_t *data, size_t size)
+{
+  MockHeapHostScope hostOnly;
+  auto it = connections.find(stream);
+  if (it == connections.end())
+    return 0;
+  Connection_t &connection = it->second;
+
+  // Requests are parsed in both modes, for the counts and to know when a reply is due
+  for (size_t i = 0; i < size; i++)
+  {
+    if (connection.requests.feed(data[i]))
+      handle(connection, connection.requests.header, connection.requests.body);
+  }
+  if (connection.fd >= 0 && send(connection.fd, data, size, 0) != (ssize_t)size)
+    return 0;
+  return size;
+}
+
+void MqttBrokerSim::handle(Connection_t &connection, uint8_t header, const std::string &body)
+{
+  uint8_t type = header >> 4;
+  if (type == 1)
+  {
+    // CONNECT: protocol name, level, flags, keep alive, then the client id
+    uint8_t flags = body.size() > 7 ? body[7] : 0;
+    connection.clientId = body.substr(12, readU16(body, 10));
+    bool clean = flags & 0x02;
+    bool present = !clean && sessions.count(connection.clientId) > 0;
+    if (clean)
+      sessions.erase(connection.clientId);
+    else
+      sessions[connection.clientId];
+    brokerStats.connects++;
+    if (present)
+      brokerStats.sessionsPresent++;
+    connection.outstanding++;
+    uint8_t connack[] = {0x20, 0x02, (uint8_t)(present ? 1 : 0), 0x00};
+    reply(connection, connack, sizeof(connack));
+  }
+  else if (type == 3)
+  {
+    uint8_t qos = (header >> 1) & 3;
+    uint16_t topicLength = readU16(body, 0);
+    size_t pos = 2 + topicLength;
+    uint16_t packetId = 0;
+    if (qos > 0)
+    {
+      packetId = readU16(body, pos);
+      pos += 2;
+    }
+    std::string payload = body.substr(std::min(pos, body.size()));
+
+    // A resent message the broker already has is delivered again: QoS 1 is at least once
+    std::set<uint16_t> &delivered = sessions[connection.clientId];
+    if ((header & 0x08) && delivered.count(packetId))
+      brokerStats.duplicates++;
+    delivered.insert(packetId);
+
+    brokerStats.messages++;
+    brokerStats.payloadBytes += payload.size();
+    if (payload.size() >= 4 && payload[0] == 'A' && payload[1] == 'G')
+    {
+      brokerStats.records += (uint8_t)payload[3];
+    }
+    else
+    {
+      for (char c : payload)
+        brokerStats.lines += c == '\n';
+      if (!payload.empty() && payload.back() != '\n')
+        brokerStats.lines++;
+    }
+
+    if (qos > 0)
+    {
+      connection.outstanding++;
+      uint8_t puback[] = {0x40, 0x02, (uint8_t)(packetId >> 8), (uint8_t)packetId};
+      reply(connection, puback, sizeof(puback));
+    }
+  }
+  else if (type == 12)
+  {
+    connection.outstanding++;
+    uint8_t pingresp[] = {0xd0, 0x00};
+    reply(connection, pingresp, sizeof(pingresp));
+  }
+}
+
+void MqttBrokerSim::reply(Connection_t &connection, const uint8_t *data, size_t size)
+{
+  // A real broker answers on its own
+  if (connection.fd >= 0)
+    return;
+  uint64_t readyUs = mockClockMicros() + MOCK_MQTT_RTT_MS * 1000;
+  for (size_t i = 0; i < size; i++)
+    connection.rx.push_back({readyUs, data[i]});
+}
+
+void MqttBrokerSim::receive(Connection_t &connection, bool wait)
+{
+  if (connection.fd < 0)
+    return;
+
+  // The virtual clock can't advance with the real broker's answer, wait for it in real time
+  struct pollfd pfd = {connection.fd, POLLIN, 0};
+  if (poll(&pfd, 1, wait && connection.outstanding > 0 ? 1000 : 0) <= 0)
+    return;
+
+  uint8_t buffer[256];
+  ssize_t n = recv(connection.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+  for (ssize_t i = 0; i < n; i++)
+  {
+    connection.rx.push_back({0, buffer[i]});
+    if (connection.replies.feed(buffer[i]) && connection.outstanding > 0)
+      connection.outstanding--;
+  }
+}
+
+int MqttBrokerSim::available(int stream)
+{
+  MockHeapHostScope hostOnly;
+  auto it = connections.find(stream);
+  if (it == connections.end())
+    return 0;
+  Connection_t &connection = it->second;
+
+  if (connection.rx.empty())
+    receive(connection, true);
+
+  uint64_t now = mockClockMicros();
+  int ready = 0;
+  for (auto &byte : connection.rx)
+  {
+    if (byte.first > now)
+      break;
+    ready++;
+  }
+  return ready;
+}
+
+int MqttBrokerSim::read(int stream)
+{
+  MockHeapHostScope hostOnly;
+  if (available(stream) == 0)
+    return -1;
+  Connection_t &connection = connections[stream];
+  uint8_t byte = connection.rx.front().second;
+  connection.rx.pop_front();
+  if (connection.fd < 0 && connection.replies.feed(byte) && connection.outstanding > 0)
+    connection.outstanding--;
+  return byte;
+}
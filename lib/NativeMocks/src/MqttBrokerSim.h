@@ -0,0 +1,89 @@
+#ifndef __NATIVE_MQTTBROKERSIM_H__
+#define __NATIVE_MQTTBROKERSIM_H__
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+
+// Time for a reply to come back from the broker
+#define MOCK_MQTT_RTT_MS 25
+
+typedef struct
+{
+  uint32_t connects;
+  uint32_t sessionsPresent;
+  uint32_t messages;
+  uint32_t duplicates;
+  uint32_t lines;
+  uint32_t records;
+  uint64_t payloadBytes;
+} MqttBrokerStats_t;
+
+//
+// Splits a byte stream into MQTT control packets
+//
+class MqttFramer
+{
+public:
+  // Returns true with a complete packet in `header` and `body`
+  bool feed(uint8_t byte);
+
+  uint8_t header = 0;
+  std::string body;
+
+private:
+  uint8_t stage = 0;
+  uint32_t remaining = 0;
+  uint8_t shift = 0;
+};
+
+//
+// MQTT 3.1.1 broker the mocked WiFiClient streams end at: CONNECT with persistent sessions, QoS 0
+// and 1 PUBLISH, PINGREQ and DISCONNECT, replies arriving MOCK_MQTT_RTT_MS later on the virtual
+// clock. Payloads are counted as line protocol lines or, with the firmware's binary header, records.
+// With forwarding enabled the streams go to a real broker instead, e.g. mosquitto or
+// tools/mqtt_standin.py; the virtual clock then stands still while a reply is outstanding
+//
+class MqttBrokerSim : public MockTcpPeer
+{
+public:
+  void setForwarding(bool forwarding) { this->forwarding = forwarding; }
+
+  int open(const char *host, uint16_t port);
+  void close(int stream) override;
+  size_t write(int stream, const uint8_t *data, size_t size) override;
+  int available(int stream) override;
+  int read(int stream) override;
+
+  const MqttBrokerStats_t &stats() const { return brokerStats; }
+
+private:
+  typedef struct
+  {
+    int fd;
+    std::string clientId;
+    MqttFramer requests;
+    MqttFramer replies;
+    uint32_t outstanding;
+    std::deque<std::pair<uint64_t, uint8_t>> rx;
+  } Connection_t;
+
+  void handle(Connection_t &connection, uint8_t header, const std::string &body);
+  void reply(Connection_t &connection, const uint8_t *data, size_t size);
+  void receive(Connection_t &connection, bool wait);
+
+  bool forwarding = false;
+  int nextStream = 0;
+  std::map<int, Connection_t> connections;
+  // Persistent sessions by client id, with the packet ids already delivered
+  std::map<std::string, std::set<uint16_t>> sessions;
+  MqttBrokerStats_t brokerStats = {};
+};
+
+extern MqttBrokerSim mqttBroker;
+
+#endif //__NATIVE_MQTTBROKERSIM_H__
@@ -0,0 +1,106 @@
+#ifndef __NATIVE_POINT_H__
+#define __NATIVE_POINT_H__
+
+#include <Arduino.h>
+
+//
+// The InfluxDB library's Point, built the same way: tags and fields are appended to Strings as they
+// are added, every name escaped into a new[] copy and every value formatted into a String of its
+// own, clearFields() releases the field String and toLineProtocol() joins everything into a new
+// String. Only there for the line protocol benchmark of the native runner, the firmware encodes
+// with LineProtocolEncoder. The mocked String grows geometrically where the core's reallocates to
+// the exact length, so the allocations counted here are a lower bound of the device's
+//
+class Point
+{
+public:
+  explicit Point(const String &measurement)
+  {
+    char *s = escape(measurement, ", ");
+    this->measurement = s;
+    delete[] s;
+  }
+
+  void addTag(const String &name, const String &value)
+  {
+    if (tags.length() > 0)
+      tags += ',';
+    char *s = escape(name, ",= ");
+    tags += s;
+    delete[] s;
+    tags += '=';
+    s = escape(value, ",= ");
+    tags += s;
+    delete[] s;
+  }
+
+  void addField(const String &name, int value) { putField(name, String(value) + "i"); }
+  void addField(const String &name, long value) { putField(name, String(value) + "i"); }
+  void addField(const String &name, unsigned int value) { putField(name, String(value) + "i"); }
+  void addField(const String &name, float value, int decimalPlaces = 2)
+  {
+    if (!isnan(value))
+      putField(name, String(value, decimalPlaces));
+  }
+
+  void setTime(unsigned long timestamp) { this->timestamp = String(timestamp); }
+  void clearFields()
+  {
+    fields = (char *)nullptr;
+    timestamp = (char *)nullptr;
+  }
+  bool hasFields() const { return fields.length() > 0; }
+
+  String toLineProtocol() const
+  {
+    String line;
+    line.reserve(measurement.length() + 1 + tags.length() + 1 + fields.length() + 1 + timestamp.length());
+    line += measurement;
+    if (tags.length() > 0)
+    {
+      line += ',';
+      line += tags;
+    }
+    line += ' ';
+    line += fields;
+    if (timestamp.length() > 0)
+    {
+      line += ' ';
+      line += timestamp;
+    }
+    return line;
+  }
+
+private:
+  static char *escape(const String &text, const char *special)
+  {
+    char *out = new char[text.length() * 2 + 1];
+    char *end = out;
+    for (unsigned int i = 0; i < text.length(); i++)
+    {
+      if (strchr(special, text[i]) != nullptr)
+        *end++ = '\\';
+      *end++ = text[i];
+    }
+    *end = '\0';
+    return out;
+  }
+
+  void putField(const String &name, const String &value)
+  {
+    if (fields.length() > 0)
+      fields += ',';
+    char *s = escape(name, ",= ");
+    fields += s;
+    delete[] s;
+    fields += '=';
+    fields += value;
+  }
+
+  String measurement;
+  String tags;
+  String fields;
+  String timestamp;
+};
+
+#endif //__NATIVE_POINT_H__
@@ -0,0 +1,165 @@
+#include "ScrapeSim.h"
+#include "ESP8266WiFi.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+ScrapeSim scrapeSim;
+
+void ScrapeSim::listen(uint16_t port)
+{
+  this->port = port;
+  listening = true;
+  nextUs = mockClockMicros() + (uint64_t)intervalMs * 1000;
+  if (!forwarding || listenFd >= 0)
+    return;
+
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || ::listen(listenFd, 4) != 0)
+  {
+    fprintf(stderr, "could not listen on port %u\n", port);
+    ::close(listenFd);
+    listenFd = -1;
+    return;
+  }
+  fcntl(listenFd, F_SETFL, O_NONBLOCK);
+}
+
+void ScrapeSim::unlisten()
+{
+  listening = false;
+  if (listenFd >= 0)
+    ::close(listenFd);
+  listenFd = -1;
+}
+
+bool ScrapeSim::pending()
+{
+  if (!listening || stream >= 0)
+    return stream >= 0 && !accepted;
+
+  if (forwarding)
+  {
+    if (listenFd < 0)
+      return false;
+    fd = ::accept(listenFd, nullptr, nullptr);
+    if (fd < 0)
+      return false;
+    dueUs = mockClockMicros();
+  }
+  else
+  {
+    if (intervalMs == 0 || mockClockMicros() < nextUs)
+      return false;
+    dueUs = nextUs;
+    nextUs += (uint64_t)intervalMs * 1000;
+    if (!WiFi.isConnected())
+    {
+      scrapeStats.missed++;
+      return false;
+    }
+  }
+
+  stream = nextStream++;
+  accepted = false;
+  requestPos = 0;
+  responseLength = 0;
+  scrapeStats.scrapes++;
+  return true;
+}
+
+int ScrapeSim::accept()
+{
+  accepted = true;
+  return stream;
+}
+
+size_t ScrapeSim::write(int stream, const uint8_t *data, size_t size)
+{
+  if (stream != this->stream)
+    return 0;
+  if (fd >= 0 && send(fd, data, size, MSG_NOSIGNAL) != (ssize_t)size)
+    return 0;
+  size_t copied = min(size, sizeof(response) - responseLength);
+  memcpy(response + responseLength, data, copied);
+  responseLength += copied;
+  return size;
+}
+
+int ScrapeSim::available(int stream)
+{
+  if (stream != this->stream)
+    return 0;
+  if (fd >= 0)
+  {
+    int n = 0;
+    ioctl(fd, FIONREAD, &n);
+    return n;
+  }
+  return sizeof(MOCK_SCRAPE_REQUEST) - 1 - requestPos;
+}
+
+int ScrapeSim::read(int stream)
+{
+  if (available(stream) == 0)
+    return -1;
+  if (fd >= 0)
+  {
+    uint8_t byte;
+    return recv(fd, &byte, 1, 0) == 1 ? byte : -1;
+  }
+  return MOCK_SCRAPE_REQUEST[requestPos++];
+}
+
+void ScrapeSim::close(int stream)
+{
+  if (stream != this->stream)
+    return;
+  finish();
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+  this->stream = -1;
+}
+
+void ScrapeSim::finish()
+{
+  uint32_t latencyMs = (mockClockMicros() - dueUs) / 1000;
+  scrapeStats.bytes += responseLength;
+  scrapeStats.maxLatencyMs = max(scrapeStats.maxLatencyMs, latencyMs);
+
+  const char *end = (const char *)memmem(response, responseLength, "\r\n\r\n", 4);
+  const char *length = (const char *)memmem(response, responseLength, "Content-Length: ", 16);
+  size_t bodyLength = end != nullptr ? response + responseLength - end - 4 : 0;
+  bool ok = latencyMs < MOCK_SCRAPE_TIMEOUT_MS && responseLength < sizeof(response) && end != nullptr &&
+            length != nullptr && length < end && strncmp(response, "HTTP/1.1 200 ", 13) == 0 &&
+            strtoul(length + 16, nullptr, 10) == bodyLength;
+  if (!ok)
+  {
+    scrapeStats.failed++;
+    return;
+  }
+
+  scrapeStats.ok++;
+  memcpy(body, end + 4, bodyLength);
+  body[bodyLength] = '\0';
+  for (const char *line = body; *line != '\0';)
+  {
+    const char *next = strchr(line, '\n');
+    if (*line != '#' && *line != '\n')
+      scrapeStats.samples++;
+    if (next == nullptr)
+      break;
+    line = next + 1;
+  }
+}
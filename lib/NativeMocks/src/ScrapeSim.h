@@ -0,0 +1,80 @@
+#ifndef __NATIVE_SCRAPESIM_H__
+#define __NATIVE_SCRAPESIM_H__
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+
+// What Prometheus sends, and how long it waits for the answer by default
+#define MOCK_SCRAPE_REQUEST                                                                                            \
+  "GET /metrics HTTP/1.1\r\nHost: airgradient\r\nUser-Agent: Prometheus/2.45.0\r\n"                                    \
+  "Accept: text/plain;version=0.0.4;q=0.5,*/*;q=0.1\r\nAccept-Encoding: gzip\r\n\r\n"
+#define MOCK_SCRAPE_TIMEOUT_MS 10000
+#define MOCK_SCRAPE_RESPONSE_MAX 4096
+
+typedef struct
+{
+  uint32_t scrapes;
+  uint32_t ok;
+  uint32_t failed;
+  uint32_t missed;
+  uint32_t samples;
+  uint64_t bytes;
+  uint32_t maxLatencyMs;
+} ScrapeStats_t;
+
+//
+// Prometheus scraping the mocked WiFiServer every `intervalMs` of virtual time: a scrape is due
+// at the interval, missed while WiFi is down, and answered once the firmware accepted the
+// connection, read the request, wrote a response and closed it. The response must be a 200 whose
+// Content-Length matches the body; every non-comment line of the body counts as a sample. With
+// forwarding enabled the server listens on its port for real instead, e.g. for
+// `curl localhost:9926/metrics`. Fixed buffers only, so scrapes show up in the runner's
+// allocation counts with what the firmware allocates and nothing else
+//
+class ScrapeSim : public MockTcpPeer
+{
+public:
+  void setInterval(uint32_t intervalMs) { this->intervalMs = intervalMs; }
+  void setForwarding(bool forwarding) { this->forwarding = forwarding; }
+
+  void listen(uint16_t port);
+  void unlisten();
+  // A connection waiting to be accepted
+  bool pending();
+  int accept();
+
+  size_t write(int stream, const uint8_t *data, size_t size) override;
+  int available(int stream) override;
+  int read(int stream) override;
+  void close(int stream) override;
+
+  const ScrapeStats_t &stats() const { return scrapeStats; }
+  // Body of the last good response
+  const char *lastBody() const { return body; }
+
+private:
+  void finish();
+
+  bool forwarding = false;
+  uint16_t port = 0;
+  bool listening = false;
+  int listenFd = -1;
+  uint32_t intervalMs = 0;
+  uint64_t nextUs = 0;
+
+  // The one connection in progress
+  int stream = -1;
+  int nextStream = 0;
+  int fd = -1;
+  bool accepted = false;
+  uint64_t dueUs = 0;
+  size_t requestPos = 0;
+  char response[MOCK_SCRAPE_RESPONSE_MAX];
+  size_t responseLength = 0;
+  char body[MOCK_SCRAPE_RESPONSE_MAX];
+  ScrapeStats_t scrapeStats = {};
+};
+
+extern ScrapeSim scrapeSim;
+
+#endif //__NATIVE_SCRAPESIM_H__
@@ -0,0 +1,139 @@
+#include "SensorSim.h"
+
+#define PMS_FRAME_INTERVAL_MS 1000
+#define S8_REPLY_MS 35
+#define S8_ABC_PERIOD_HOURS 180
+
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+  uint16_t crc = 0xffff;
+  while (len--)
+  {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+  }
+  return crc;
+}
+
+void Pms5003Sim::receive(uint8_t c)
+{
+  // Commands are 42 4D cmd dataH dataL sumH sumL, only sleep/wake (0xe4) changes anything here
+  if (commandLength == 0 && c != 0x42)
+    return;
+  command[commandLength++] = c;
+  if (commandLength < sizeof(command))
+    return;
+  commandLength = 0;
+
+  uint16_t sum = 0;
+  for (int i = 0; i < 5; i++)
+    sum += command[i];
+  if (command[1] != 0x4d || ((command[5] << 8) | command[6]) != sum || command[2] != 0xe4)
+    return;
+  sleeping = command[4] == 0;
+  waking = !sleeping;
+}
+
+void Pms5003Sim::service(uint32_t nowMs, SerialFifo &rx)
+{
+  if (waking)
+  {
+    nextFrameMs = nowMs + PMS_SPINUP_MS;
+    waking = false;
+  }
+  if (sleeping)
+    return;
+
+  while ((int32_t)(nowMs - nextFrameMs) >= 0)
+  {
+    nextFrameMs += PMS_FRAME_INTERVAL_MS;
+    frameCount++;
+
+    pm25 += ((rand() % 2001) - 1000) / 1000.0f;
+    if (pm25 < 0)
+      pm25 = 0;
+
+    uint16_t pm = (uint16_t)pm25;
+    uint16_t words[13] = {
+        (uint16_t)(pm * 7 / 10), pm, (uint16_t)(pm * 13 / 10),
+        (uint16_t)(pm * 7 / 10), pm, (uint16_t)(pm * 13 / 10),
+        (uint16_t)(pm * 120), (uint16_t)(pm * 35), (uint16_t)(pm * 6), pm, (uint16_t)(pm / 4), (uint16_t)(pm / 10),
+        0x9700};
+
+    uint8_t frame[32] = {0x42, 0x4d, 0x00, 28};
+    for (int i = 0; i < 13; i++)
+    {
+      frame[4 + 2 * i] = words[i] >> 8;
+      frame[5 + 2 * i] = words[i] & 0xff;
+    }
+
+    uint16_t sum = 0;
+    for (int i = 0; i < 30; i++)
+      sum += frame[i];
+    frame[30] = sum >> 8;
+    frame[31] = sum & 0xff;
+
+    if (corruptEvery > 0 && frameCount % corruptEvery == 0)
+      frame[10] ^= 0x5a;
+
+    rx.append(frame, sizeof(frame));
+  }
+}
+
+void S8Sim::receive(uint8_t c)
+{
+  if (requestLength == 0 && c != 0xfe)
+    return;
+  request[requestLength++] = c;
+  if (requestLength < sizeof(request))
+    return;
+  requestLength = 0;
+
+  if (crc16(request, 6) != (request[6] | (request[7] << 8)))
+    return;
+
+  uint8_t function = request[1];
+  uint16_t address = (request[2] << 8) | request[3];
+  uint8_t count = request[5];
+
+  co2 += ((rand() % 2001) - 1000) / 100.0f;
+  if (co2 < 400)
+    co2 = 400;
+
+  // Never more registers than fit a reply
+  count = min(count, (uint8_t)((sizeof(pending) - 5) / 2));
+  pendingLength = 0;
+  pending[pendingLength++] = 0xfe;
+  pending[pendingLength++] = function;
+  pending[pendingLength++] = 2 * count;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uint16_t reg = address + i;
+    uint16_t value = 0;
+    if (function == 0x04 && reg == 0x0003)
+      value = (uint16_t)co2;
+    else if (function == 0x03 && reg == 0x001f)
+      value = S8_ABC_PERIOD_HOURS;
+    pending[pendingLength++] = value >> 8;
+    pending[pendingLength++] = value & 0xff;
+  }
+
+  uint16_t crc = crc16(pending, pendingLength);
+  pending[pendingLength++] = crc & 0xff;
+  pending[pendingLength++] = crc >> 8;
+
+  replyAtMs = millis() + S8_REPLY_MS;
+  replies++;
+  if (dropEvery > 0 && replies % dropEvery == 0)
+    pendingLength = 0;
+}
+
+void S8Sim::service(uint32_t nowMs, SerialFifo &rx)
+{
+  if (pendingLength == 0 || (int32_t)(nowMs - replyAtMs) < 0)
+    return;
+
+  rx.append(pending, pendingLength);
+  pendingLength = 0;
+}
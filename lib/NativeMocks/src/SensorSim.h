@@ -0,0 +1,56 @@
+#ifndef __NATIVE_SENSORSIM_H__
+#define __NATIVE_SENSORSIM_H__
+
+#include "SoftwareSerial.h"
+
+#define PMS_SPINUP_MS 2500
+
+//
+// PMS5003 in active mode: emits a 32-byte frame every second with slowly drifting readings, the
+// first one PMS_SPINUP_MS after power on or a wake command once the fan is up to speed. The sleep
+// command stops the fan and the frames.
+// Every `corruptEvery`-th frame gets a flipped byte to exercise checksum handling
+//
+class Pms5003Sim : public SerialDevice
+{
+public:
+  void service(uint32_t nowMs, SerialFifo &rx) override;
+  void receive(uint8_t c) override;
+
+  void setCorruptEvery(uint32_t frames) { corruptEvery = frames; }
+
+private:
+  uint8_t command[7];
+  uint8_t commandLength = 0;
+  bool sleeping = false;
+  bool waking = false;
+  uint32_t nextFrameMs = PMS_SPINUP_MS;
+  uint32_t frameCount = 0;
+  uint32_t corruptEvery = 0;
+  float pm25 = 8;
+};
+
+//
+// SenseAir S8 Modbus slave: answers read input/holding register requests ~35 ms after the request,
+// dropping every `dropEvery`-th reply to exercise timeouts and retries
+//
+class S8Sim : public SerialDevice
+{
+public:
+  void service(uint32_t nowMs, SerialFifo &rx) override;
+  void receive(uint8_t c) override;
+
+  void setDropEvery(uint32_t replies) { dropEvery = replies; }
+
+private:
+  uint8_t request[8];
+  uint8_t requestLength = 0;
+  uint8_t pending[32];
+  uint8_t pendingLength = 0;
+  uint32_t replyAtMs = 0;
+  uint32_t replies = 0;
+  uint32_t dropEvery = 0;
+  float co2 = 600;
+};
+
+#endif //__NATIVE_SENSORSIM_H__
@@ -0,0 +1,141 @@
+#ifndef __NATIVE_SOFTWARESERIAL_H__
+#define __NATIVE_SOFTWARESERIAL_H__
+
+#include <Arduino.h>
+
+enum SoftwareSerialConfig
+{
+  SWSERIAL_8N1 = 0
+};
+
+//
+// Fixed ring of bytes on the wire, so simulated traffic doesn't show up in the runner's heap counts.
+// Bytes pushed while it's full are dropped
+//
+#define SERIAL_FIFO_SIZE 1024
+
+class SerialFifo
+{
+public:
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  uint8_t front() const { return data[head]; }
+
+  void pop_front()
+  {
+    head = (head + 1) % SERIAL_FIFO_SIZE;
+    count--;
+  }
+
+  void push_back(uint8_t c)
+  {
+    if (count == SERIAL_FIFO_SIZE)
+      return;
+    data[(head + count) % SERIAL_FIFO_SIZE] = c;
+    count++;
+  }
+
+  void append(const uint8_t *bytes, size_t length)
+  {
+    while (length--)
+      push_back(*bytes++);
+  }
+
+  // Keeps the oldest `length` bytes
+  void truncate(size_t length) { count = min(count, length); }
+  void clear() { head = count = 0; }
+
+private:
+  uint8_t data[SERIAL_FIFO_SIZE];
+  size_t head = 0;
+  size_t count = 0;
+};
+
+//
+// Simulated peripheral on the other end of a serial line. `service()` is called before every read
+// with the virtual time so the device can queue what it would have sent by now
+//
+class SerialDevice
+{
+public:
+  virtual ~SerialDevice() {}
+  virtual void service(uint32_t nowMs, SerialFifo &rx) = 0;
+  virtual void receive(uint8_t c) = 0;
+};
+
+//
+// EspSoftwareSerial stand-in with a bounded RX buffer, bytes beyond its capacity are lost and
+// flagged through overflow() like on the device
+//
+class SoftwareSerial : public Stream
+{
+public:
+  void begin(uint32_t baud, SoftwareSerialConfig config, int8_t rxPin, int8_t txPin, bool invert, int bufCapacity = 64)
+  {
+    (void)baud;
+    (void)config;
+    (void)rxPin;
+    (void)txPin;
+    (void)invert;
+    capacity = bufCapacity;
+    rx.clear();
+  }
+
+  void attach(SerialDevice *device) { this->device = device; }
+
+  size_t write(uint8_t c) override
+  {
+    if (device)
+      device->receive(c);
+    return 1;
+  }
+  using Print::write;
+
+  int available() override
+  {
+    service();
+    return rx.size();
+  }
+  int read() override
+  {
+    service();
+    if (rx.empty())
+      return -1;
+    uint8_t c = rx.front();
+    rx.pop_front();
+    return c;
+  }
+  int peek() override
+  {
+    service();
+    return rx.empty() ? -1 : rx.front();
+  }
+
+  bool overflow()
+  {
+    service();
+    bool overflowed = overflowed_;
+    overflowed_ = false;
+    return overflowed;
+  }
+
+private:
+  void service()
+  {
+    if (!device)
+      return;
+    device->service(millis(), rx);
+    if (rx.size() > capacity)
+    {
+      rx.truncate(capacity);
+      overflowed_ = true;
+    }
+  }
+
+  SerialDevice *device = nullptr;
+  size_t capacity = 64;
+  bool overflowed_ = false;
+  SerialFifo rx;
+};
+
+#endif //__NATIVE_SOFTWARESERIAL_H__
@@ -0,0 +1,54 @@
+#include "U8g2lib.h"
+#include "Wire.h"
+
+#define DISPLAY_TILE_BYTES 8
+
+TwoWire Wire;
+
+static const u8g2_cb_t rotation0 = {0};
+static const u8g2_cb_t rotation2 = {2};
+const u8g2_cb_t *U8G2_R0 = &rotation0;
+const u8g2_cb_t *U8G2_R2 = &rotation2;
+
+const uint8_t u8g2_font_t0_16_tf[] = {8, 11, 4};
+const uint8_t u8g2_font_6x10_tf[] = {6, 7, 2};
+
+void U8G2::firstPage()
+{
+}
+
+uint8_t U8G2::nextPage()
+{
+  // The F (full buffer) variant renders everything in one pass, then sends all pages
+  sendBuffer();
+  return 0;
+}
+
+void U8G2::sendBuffer()
+{
+  uint32_t tiles = getBufferTileWidth() * getBufferTileHeight();
+  displayStats.frames++;
+  displayStats.tiles += tiles;
+  displayStats.bytesSent += tiles * DISPLAY_TILE_BYTES;
+}
+
+void U8G2::updateDisplayArea(uint8_t tx, uint8_t ty, uint8_t tw, uint8_t th)
+{
+  // Like the real driver, the area is clipped to the buffer
+  if (tx >= getBufferTileWidth() || ty >= getBufferTileHeight())
+    return;
+  tw = min(tw, (uint8_t)(getBufferTileWidth() - tx));
+  th = min(th, (uint8_t)(getBufferTileHeight() - ty));
+
+  displayStats.partialUpdates++;
+  displayStats.tiles += tw * th;
+  displayStats.bytesSent += tw * th * DISPLAY_TILE_BYTES;
+}
+
+uint16_t U8G2::drawStr(uint16_t x, uint16_t y, const char *str)
+{
+  (void)x;
+  (void)y;
+  displayStats.strings++;
+  return getStrWidth(str);
+}
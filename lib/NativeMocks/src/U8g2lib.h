@@ -0,0 +1,81 @@
+#ifndef __NATIVE_U8G2LIB_H__
+#define __NATIVE_U8G2LIB_H__
+
+#include <Arduino.h>
+
+#define U8X8_PIN_NONE 255
+
+typedef struct
+{
+  uint8_t rotation;
+} u8g2_cb_t;
+
+extern const u8g2_cb_t *U8G2_R0;
+extern const u8g2_cb_t *U8G2_R2;
+
+// Mock fonts are fixed width: { glyph width, ascent, descent below the baseline }
+extern const uint8_t u8g2_font_t0_16_tf[];
+extern const uint8_t u8g2_font_6x10_tf[];
+
+typedef struct
+{
+  uint32_t frames;
+  uint32_t partialUpdates;
+  uint32_t tiles;
+  uint32_t strings;
+  uint32_t bytesSent;
+} DisplayStats_t;
+
+//
+// Counts the work done by the firmware against a 128x64 display instead of drawing it.
+// A full frame is 8 rows of 16 tiles (8x8 pixels, 8 bytes each) pushed over I2C
+//
+class U8G2
+{
+public:
+  U8G2(const u8g2_cb_t *rotation) : rotation(rotation) {}
+
+  bool begin() { return true; }
+
+  void firstPage();
+  uint8_t nextPage();
+  void clearBuffer() {}
+  void sendBuffer();
+  void updateDisplayArea(uint8_t tx, uint8_t ty, uint8_t tw, uint8_t th);
+
+  uint8_t getBufferTileWidth() const { return 16; }
+  uint8_t getBufferTileHeight() const { return 8; }
+
+  void setFont(const uint8_t *font) { this->font = font; }
+  int8_t getAscent() const { return (int8_t)font[1]; }
+  int8_t getDescent() const { return -(int8_t)font[2]; }
+  uint16_t getStrWidth(const char *str) const { return strlen(str) * font[0]; }
+
+  void setDrawColor(uint8_t color) { (void)color; }
+  void drawBox(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+  {
+    (void)x;
+    (void)y;
+    (void)w;
+    (void)h;
+  }
+  uint16_t drawStr(uint16_t x, uint16_t y, const char *str);
+
+  const DisplayStats_t &stats() const { return displayStats; }
+
+private:
+  const u8g2_cb_t *rotation;
+  const uint8_t *font = u8g2_font_t0_16_tf;
+  DisplayStats_t displayStats = {};
+};
+
+class U8G2_SH1106_128X64_NONAME_F_HW_I2C : public U8G2
+{
+public:
+  U8G2_SH1106_128X64_NONAME_F_HW_I2C(const u8g2_cb_t *rotation, uint8_t reset) : U8G2(rotation)
+  {
+    (void)reset;
+  }
+};
+
+#endif //__NATIVE_U8G2LIB_H__
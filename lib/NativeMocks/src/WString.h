@@ -0,0 +1,140 @@
+#ifndef __NATIVE_WSTRING_H__
+#define __NATIVE_WSTRING_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+//
+// Subset of the Arduino String API backed by std::string
+//
+class String
+{
+public:
+  String() {}
+  String(const char *str) : value(str ? str : "") {}
+  String(const std::string &str) : value(str) {}
+  explicit String(char c) : value(1, c) {}
+  explicit String(int number, unsigned char base = 10) : value(toBase((long long)number, base)) {}
+  explicit String(unsigned int number, unsigned char base = 10) : value(toBase((unsigned long long)number, base)) {}
+  explicit String(long number, unsigned char base = 10) : value(toBase((long long)number, base)) {}
+  explicit String(unsigned long number, unsigned char base = 10) : value(toBase((unsigned long long)number, base)) {}
+  explicit String(float number, unsigned char decimals = 2) : value(toFixed(number, decimals)) {}
+  explicit String(double number, unsigned char decimals = 2) : value(toFixed(number, decimals)) {}
+
+  // Like the core's String, assigning a null pointer releases the buffer
+  String &operator=(const char *str)
+  {
+    if (str == nullptr)
+      std::string().swap(value);
+    else
+      value = str;
+    return *this;
+  }
+
+  const char *c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.length(); }
+  bool isEmpty() const { return value.empty(); }
+  bool reserve(unsigned int size)
+  {
+    value.reserve(size);
+    return true;
+  }
+
+  char operator[](unsigned int index) const { return index < value.length() ? value[index] : 0; }
+  char charAt(unsigned int index) const { return (*this)[index]; }
+
+  bool concat(const String &str)
+  {
+    value += str.value;
+    return true;
+  }
+  bool concat(const char *str)
+  {
+    value += str ? str : "";
+    return true;
+  }
+  bool concat(char c)
+  {
+    value += c;
+    return true;
+  }
+
+  String &operator+=(const String &str)
+  {
+    concat(str);
+    return *this;
+  }
+  String &operator+=(const char *str)
+  {
+    concat(str);
+    return *this;
+  }
+  String &operator+=(char c)
+  {
+    concat(c);
+    return *this;
+  }
+
+  bool equals(const String &str) const { return value == str.value; }
+  bool operator==(const String &str) const { return value == str.value; }
+  bool operator==(const char *str) const { return value == (str ? str : ""); }
+  bool operator!=(const String &str) const { return value != str.value; }
+  bool operator!=(const char *str) const { return !(*this == str); }
+
+  bool startsWith(const String &prefix) const { return value.compare(0, prefix.value.length(), prefix.value) == 0; }
+  int indexOf(char c, unsigned int from = 0) const
+  {
+    size_t pos = value.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+  }
+  int indexOf(const String &str, unsigned int from = 0) const
+  {
+    size_t pos = value.find(str.value, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+  }
+  String substring(unsigned int from) const { return from < value.length() ? String(value.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const
+  {
+    return from < to && from < value.length() ? String(value.substr(from, to - from)) : String();
+  }
+
+  long toInt() const { return strtol(value.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(value.c_str(), nullptr); }
+
+  friend String operator+(const String &lhs, const String &rhs) { return String(lhs.value + rhs.value); }
+  friend String operator+(const String &lhs, const char *rhs) { return String(lhs.value + (rhs ? rhs : "")); }
+  friend String operator+(const char *lhs, const String &rhs) { return String((lhs ? lhs : "") + rhs.value); }
+  friend String operator+(const String &lhs, char rhs) { return String(lhs.value + rhs); }
+
+private:
+  static std::string toBase(unsigned long long number, unsigned char base)
+  {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    do
+    {
+      out.insert(out.begin(), digits[number % base]);
+      number /= base;
+    } while (number);
+    return out;
+  }
+
+  static std::string toBase(long long number, unsigned char base)
+  {
+    if (number < 0 && base == 10)
+      return "-" + toBase((unsigned long long)-number, base);
+    return toBase((unsigned long long)number, base);
+  }
+
+  static std::string toFixed(double number, unsigned char decimals)
+  {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, number);
+    return buf;
+  }
+
+  std::string value;
+};
+
+#endif //__NATIVE_WSTRING_H__
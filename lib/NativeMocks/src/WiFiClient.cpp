@@ -0,0 +1,52 @@
+#include "WiFiClient.h"
+#include "MqttBrokerSim.h"
+
+WiFiClient::WiFiClient(MockTcpPeer *peer, int stream) : peer(peer), stream(stream)
+{
+  open = stream >= 0 && WiFi.isConnected();
+  link = WiFi.linkCount();
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+  stop();
+  strlcpy(this->host, host, sizeof(this->host));
+  this->port = port;
+  open = WiFi.isConnected();
+  link = WiFi.linkCount();
+  return open;
+}
+
+void WiFiClient::stop()
+{
+  open = false;
+  if (stream >= 0)
+    peer->close(stream);
+  stream = -1;
+}
+
+size_t WiFiClient::write(const uint8_t *data, size_t size)
+{
+  if (!connected())
+    return 0;
+  if (stream < 0)
+  {
+    peer = &mqttBroker;
+    stream = mqttBroker.open(host, port);
+  }
+  return stream >= 0 ? peer->write(stream, data, size) : 0;
+}
+
+int WiFiClient::available()
+{
+  if (!connected() || stream < 0)
+    return 0;
+  return peer->available(stream);
+}
+
+int WiFiClient::read()
+{
+  if (!connected() || stream < 0)
+    return -1;
+  return peer->read(stream);
+}
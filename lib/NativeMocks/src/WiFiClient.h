@@ -0,0 +1,61 @@
+#ifndef __NATIVE_WIFICLIENT_H__
+#define __NATIVE_WIFICLIENT_H__
+
+#include "ESP8266WiFi.h"
+
+//
+// Far end of the mocked TCP streams, each identified by its own stream numbers
+//
+class MockTcpPeer
+{
+public:
+  virtual ~MockTcpPeer() {}
+
+  virtual size_t write(int stream, const uint8_t *data, size_t size) = 0;
+  virtual int available(int stream) = 0;
+  virtual int read(int stream) = 0;
+  virtual void close(int stream) = 0;
+};
+
+//
+// Plain TCP connection, opening one costs nothing worth modelling. It lives as long as the
+// association it was opened on. The mocked HTTPClient only uses it to track the connection and
+// hands requests to the HttpSink; bytes written to it directly open a stream to the MqttBrokerSim,
+// the only other protocol the firmware speaks as a client. Connections a WiFiServer accepts come
+// with the peer that opened them
+//
+// A Print like the real one (through Client and Stream), so dumps can be written straight to it
+class WiFiClient : public Print
+{
+public:
+  WiFiClient() {}
+  // Not in the real API: an accepted connection
+  WiFiClient(MockTcpPeer *peer, int stream);
+  virtual ~WiFiClient() {}
+
+  virtual int connect(const char *host, uint16_t port);
+  virtual uint8_t connected() { return open && link == WiFi.linkCount(); }
+  virtual void stop();
+
+  void setNoDelay(bool noDelay) { (void)noDelay; }
+  void setTimeout(unsigned long timeout) { (void)timeout; }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t size) override;
+  using Print::write;
+  int available();
+  int read();
+
+  // Not in the real API: the mocked HTTPClient marks each request so servers can time out idle connections
+  void markUsed() { lastUseMs = mockClockMicros() / 1000; }
+
+protected:
+  bool open = false;
+  uint32_t link = 0;
+  uint64_t lastUseMs = 0;
+  char host[64] = {};
+  uint16_t port = 0;
+  MockTcpPeer *peer = nullptr;
+  int stream = -1;
+};
+
+#endif //__NATIVE_WIFICLIENT_H__
@@ -0,0 +1,68 @@
+#include "WiFiClientSecure.h"
+#include "MockHeap.h"
+
+#include <map>
+#include <string>
+#include <unistd.h>
+
+MockTlsStats_t mockTls;
+
+// Session IDs the server issued and when, on the virtual clock
+static std::map<std::string, uint64_t> serverSessions;
+// Unique per run too, a session saved by an earlier run must not match a new one by accident
+static uint32_t nextSessionId = (uint32_t)getpid() << 16;
+
+int WiFiClientSecure::connect(const char *host, uint16_t port)
+{
+  if (!WiFiClient::connect(host, port))
+    return 0;
+  buffers.reset(new uint8_t[MOCK_TLS_BUFFER_BYTES]);
+
+  // The session cache is the server's, not on the device's heap
+  MockHeapHostScope hostOnly;
+  uint64_t now = mockClockMicros() / 1000;
+  bool resumed = false;
+  if (session != nullptr && session->sessionIdLength > 0)
+  {
+    auto issued = serverSessions.find(std::string((const char *)session->sessionId, session->sessionIdLength));
+    resumed = issued != serverSessions.end() && now - issued->second < MOCK_TLS_SESSION_LIFETIME_MS;
+  }
+
+  uint32_t cost = resumed ? MOCK_TLS_RESUMED_HANDSHAKE_MS : MOCK_TLS_FULL_HANDSHAKE_MS;
+  delay(cost);
+  mockTls.handshakeMs += cost;
+  if (resumed)
+  {
+    mockTls.resumedHandshakes++;
+  }
+  else
+  {
+    mockTls.fullHandshakes++;
+    if (session != nullptr)
+    {
+      *session = BearSSL::Session();
+      session->sessionIdLength = sizeof(session->sessionId);
+      memcpy(session->sessionId, &nextSessionId, sizeof(nextSessionId));
+      memcpy(session->masterSecret, &nextSessionId, sizeof(nextSessionId));
+      session->version = 0x0303;
+      session->cipherSuite = 0xc02f;
+      nextSessionId++;
+      serverSessions[std::string((const char *)session->sessionId, session->sessionIdLength)] = now;
+    }
+  }
+  markUsed();
+  return 1;
+}
+
+uint8_t WiFiClientSecure::connected()
+{
+  if (open && mockClockMicros() / 1000 - lastUseMs >= MOCK_TLS_IDLE_TIMEOUT_MS)
+    open = false;
+  return WiFiClient::connected();
+}
+
+void WiFiClientSecure::stop()
+{
+  WiFiClient::stop();
+  buffers.reset();
+}
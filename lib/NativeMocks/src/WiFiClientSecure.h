@@ -0,0 +1,78 @@
+#ifndef __NATIVE_WIFICLIENTSECURE_H__
+#define __NATIVE_WIFICLIENTSECURE_H__
+
+#include "ESP8266HTTPClient.h"
+
+#include <memory>
+
+//
+// What a handshake costs on the 80 MHz ESP8266: a full one verifies the server certificate and
+// runs the key exchange, a resumed one is little more than two round trips
+//
+#define MOCK_TLS_FULL_HANDSHAKE_MS 2600
+#define MOCK_TLS_RESUMED_HANDSHAKE_MS 220
+
+// The server closes keep-alive connections idle for longer and forgets sessions after their lifetime
+#define MOCK_TLS_IDLE_TIMEOUT_MS 75000
+#define MOCK_TLS_SESSION_LIFETIME_MS 3600000
+
+// BearSSL's receive and send buffers, allocated on connect and freed on stop() like the core's
+#define MOCK_TLS_BUFFER_BYTES (16709 + 597)
+
+typedef struct
+{
+  uint32_t fullHandshakes;
+  uint32_t resumedHandshakes;
+  uint64_t handshakeMs;
+} MockTlsStats_t;
+
+extern MockTlsStats_t mockTls;
+
+class WiFiClientSecure;
+
+namespace BearSSL
+{
+// Opaque like the real one, whose bytes are BearSSL's br_ssl_session_parameters
+class Session
+{
+  friend class ::WiFiClientSecure;
+
+public:
+  Session() { memset(this, 0, sizeof(*this)); }
+
+private:
+  uint8_t sessionId[32];
+  uint8_t sessionIdLength;
+  uint16_t version;
+  uint16_t cipherSuite;
+  uint8_t masterSecret[48];
+};
+
+class X509List
+{
+public:
+  explicit X509List(const char *pem) { (void)pem; }
+};
+} // namespace BearSSL
+
+//
+// TLS connection with the handshake costs above, on the virtual clock. The server side keeps a
+// cache of the session IDs it issued, a client offering one of those within its lifetime resumes
+//
+class WiFiClientSecure : public WiFiClient
+{
+public:
+  void setInsecure() {}
+  void setTrustAnchors(const BearSSL::X509List *trustAnchors) { (void)trustAnchors; }
+  void setSession(BearSSL::Session *session) { this->session = session; }
+
+  int connect(const char *host, uint16_t port) override;
+  uint8_t connected() override;
+  void stop() override;
+
+private:
+  BearSSL::Session *session = nullptr;
+  std::unique_ptr<uint8_t[]> buffers;
+};
+
+#endif //__NATIVE_WIFICLIENTSECURE_H__
@@ -0,0 +1,28 @@
+#include "WiFiServer.h"
+#include "ScrapeSim.h"
+
+void WiFiServer::begin(uint16_t port)
+{
+  this->port = port;
+  listening = true;
+  scrapeSim.listen(port);
+}
+
+void WiFiServer::stop()
+{
+  if (listening)
+    scrapeSim.unlisten();
+  listening = false;
+}
+
+bool WiFiServer::hasClient()
+{
+  return listening && scrapeSim.pending();
+}
+
+WiFiClient WiFiServer::accept()
+{
+  if (!hasClient())
+    return WiFiClient();
+  return WiFiClient(&scrapeSim, scrapeSim.accept());
+}
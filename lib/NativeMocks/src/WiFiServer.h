@@ -0,0 +1,27 @@
+#ifndef __NATIVE_WIFISERVER_H__
+#define __NATIVE_WIFISERVER_H__
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+
+//
+// Listening TCP socket, the connections it accepts come from the ScrapeSim
+//
+class WiFiServer
+{
+public:
+  WiFiServer(uint16_t port) : port(port) {}
+
+  void begin() { begin(port); }
+  void begin(uint16_t port);
+  void stop();
+  bool hasClient();
+  WiFiClient accept();
+  void setNoDelay(bool noDelay) { (void)noDelay; }
+
+private:
+  uint16_t port;
+  bool listening = false;
+};
+
+#endif //__NATIVE_WIFISERVER_H__
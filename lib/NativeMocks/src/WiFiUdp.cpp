@@ -0,0 +1,45 @@
+#include "WiFiUdp.h"
+#include "ESP8266WiFi.h"
+#include "MockHeap.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+UdpSink udpSink;
+
+bool UdpSink::send(IPAddress address, uint16_t port, const uint8_t *data, size_t length)
+{
+  MockHeapHostScope hostOnly;
+  if (!WiFi.isConnected())
+  {
+    sinkStats.failed++;
+    return false;
+  }
+
+  sinkStats.datagrams++;
+  sinkStats.bytes += length;
+  sinkStats.largest = max(sinkStats.largest, (uint32_t)length);
+  if (length > MOCK_UDP_UNFRAGMENTED_MAX)
+    sinkStats.fragmented++;
+  for (size_t i = 0; i < length; i++)
+  {
+    if (data[i] == '\n')
+      sinkStats.lines++;
+  }
+  if (length > 0 && data[length - 1] != '\n')
+    sinkStats.lines++;
+
+  if (forwarding)
+  {
+    if (fd < 0)
+      fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(port);
+    to.sin_addr.s_addr = (uint32_t)address;
+    if (fd < 0 || sendto(fd, data, length, 0, (struct sockaddr *)&to, sizeof(to)) != (ssize_t)length)
+      return false;
+  }
+  return true;
+}
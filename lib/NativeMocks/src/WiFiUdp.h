@@ -0,0 +1,90 @@
+#ifndef __NATIVE_WIFIUDP_H__
+#define __NATIVE_WIFIUDP_H__
+
+#include <Arduino.h>
+#include <memory>
+#include "IPAddress.h"
+
+//
+// Handing a datagram to lwIP and the MAC queue: a fixed cost plus the copy into the packet buffer
+//
+#define MOCK_UDP_SEND_US 40
+#define MOCK_UDP_BYTES_PER_US 10
+
+// Largest datagram the mock buffers, anything above 1472 bytes would be fragmented on the way
+#define MOCK_UDP_PACKET_MAX 8192
+#define MOCK_UDP_UNFRAGMENTED_MAX 1472
+
+typedef struct
+{
+  uint32_t datagrams;
+  uint32_t failed;
+  uint32_t fragmented;
+  uint32_t lines;
+  uint32_t largest;
+  uint64_t bytes;
+} UdpSinkStats_t;
+
+//
+// Destination of every datagram the mocked WiFiUDP sends. Datagrams are lost while WiFi is down;
+// with forwarding enabled they are sent for real to the address they were meant for, e.g.
+// tools/influx_standin.py --udp-port
+//
+class UdpSink
+{
+public:
+  void setForwarding(bool forwarding) { this->forwarding = forwarding; }
+  bool send(IPAddress address, uint16_t port, const uint8_t *data, size_t length);
+  const UdpSinkStats_t &stats() const { return sinkStats; }
+
+private:
+  bool forwarding = false;
+  int fd = -1;
+  UdpSinkStats_t sinkStats = {};
+};
+
+extern UdpSink udpSink;
+
+class WiFiUDP
+{
+public:
+  int beginPacket(IPAddress address, uint16_t port)
+  {
+    this->address = address;
+    this->port = port;
+    packet.reset();
+    length = 0;
+    return 1;
+  }
+
+  // Like lwIP's pbuf, the packet is taken from the heap and grown by every write until it is sent
+  size_t write(const uint8_t *data, size_t size)
+  {
+    if (length + size > MOCK_UDP_PACKET_MAX)
+      return 0;
+    uint8_t *grown = new uint8_t[length + size];
+    if (length > 0)
+      memcpy(grown, packet.get(), length);
+    memcpy(grown + length, data, size);
+    packet.reset(grown);
+    length += size;
+    return size;
+  }
+
+  int endPacket()
+  {
+    delayMicroseconds(MOCK_UDP_SEND_US + length / MOCK_UDP_BYTES_PER_US);
+    bool sent = udpSink.send(address, port, packet.get(), length);
+    packet.reset();
+    length = 0;
+    return sent ? 1 : 0;
+  }
+
+private:
+  IPAddress address;
+  uint16_t port = 0;
+  std::unique_ptr<uint8_t[]> packet;
+  size_t length = 0;
+};
+
+#endif //__NATIVE_WIFIUDP_H__
@@ -0,0 +1,15 @@
+#ifndef __NATIVE_WIRE_H__
+#define __NATIVE_WIRE_H__
+
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+  void begin() {}
+  void setClock(uint32_t frequency) { (void)frequency; }
+};
+
+extern TwoWire Wire;
+
+#endif //__NATIVE_WIRE_H__
@@ -0,0 +1,149 @@
+#include "aggregator.h"
+
+void RunningStats::reset()
+{
+  n = 0;
+  avg = 0;
+  m2 = 0;
+  lowest = 0;
+  highest = 0;
+}
+
+void RunningStats::add(float value)
+{
+  if (n == 0 || value < lowest)
+    lowest = value;
+  if (n == 0 || value > highest)
+    highest = value;
+
+  n++;
+  float delta = value - avg;
+  avg += delta / n;
+  m2 += delta * (value - avg);
+}
+
+float RunningStats::stddev() const
+{
+  // Population deviation of the window, a single sample has none
+  return n > 1 ? sqrtf(m2 / n) : 0;
+}
+
+// `stddevScale` brings the deviation to hundredths of the reported unit, temperature and humidity already are
+static void fillStats(ChannelStats_t &out, const RunningStats &stats, float stddevScale)
+{
+  out.min = (int16_t)lroundf(stats.minimum());
+  out.max = (int16_t)lroundf(stats.maximum());
+  out.stddev = (uint16_t)min(lroundf(stats.stddev() * stddevScale), (long)UINT16_MAX);
+}
+
+SampleAggregator::SampleAggregator() : windowSamples(1)
+{
+  reset();
+}
+
+void SampleAggregator::begin(uint16_t windowSamples)
+{
+  this->windowSamples = windowSamples > 0 ? windowSamples : 1;
+  reset();
+}
+
+void SampleAggregator::reset()
+{
+  count = 0;
+  lastTimestamp = 0;
+  s8Status = 0;
+  s8AbcHours = SAMPLE_ABC_INVALID;
+
+  for (uint8_t i = 0; i < PMS_DATA_WORDS; i++)
+    pms[i].reset();
+  co2.reset();
+  tempC.reset();
+  humidity.reset();
+  rssi.reset();
+}
+
+void SampleAggregator::add(const SampleRecord_t &sample)
+{
+  count++;
+  lastTimestamp = sample.timestamp;
+
+  if (sample.pms[PMS_PM25] != SAMPLE_PMS_INVALID)
+  {
+    for (uint8_t i = 0; i < PMS_DATA_WORDS; i++)
+      pms[i].add(sample.pms[i]);
+  }
+
+  if (sample.co2 != SAMPLE_CO2_INVALID)
+  {
+    co2.add(sample.co2);
+    // Any error flag seen during the window is reported
+    s8Status |= sample.s8Status;
+  }
+
+  if (sample.s8AbcHours != SAMPLE_ABC_INVALID)
+    s8AbcHours = sample.s8AbcHours;
+
+  if (sample.tempC != SAMPLE_TEMP_INVALID)
+    tempC.add(sample.tempC);
+
+  if (sample.humidity != SAMPLE_HUMIDITY_INVALID)
+    humidity.add(sample.humidity);
+
+  if (sample.rssi != SAMPLE_RSSI_INVALID)
+    rssi.add(sample.rssi);
+}
+
+void SampleAggregator::summarize(SampleRecord_t &summary)
+{
+  memset(&summary, 0, sizeof(summary));
+  summary.timestamp = lastTimestamp;
+  summary.samples = count;
+
+  if (pms[PMS_PM25].count() > 0)
+  {
+    for (uint8_t i = 0; i < PMS_DATA_WORDS; i++)
+      summary.pms[i] = (uint16_t)lroundf(pms[i].mean());
+    fillStats(summary.stats[SAMPLE_CH_PM25], pms[PMS_PM25], 100);
+  }
+  else
+  {
+    summary.pms[PMS_PM25] = SAMPLE_PMS_INVALID;
+  }
+
+  if (co2.count() > 0)
+  {
+    summary.co2 = (int16_t)lroundf(co2.mean());
+    fillStats(summary.stats[SAMPLE_CH_CO2], co2, 100);
+  }
+  else
+  {
+    summary.co2 = SAMPLE_CO2_INVALID;
+  }
+  summary.s8Status = s8Status;
+  summary.s8AbcHours = s8AbcHours;
+
+  if (tempC.count() > 0)
+  {
+    summary.tempC = (int16_t)lroundf(tempC.mean());
+    fillStats(summary.stats[SAMPLE_CH_TEMP], tempC, 1);
+  }
+  else
+  {
+    summary.tempC = SAMPLE_TEMP_INVALID;
+  }
+
+  if (humidity.count() > 0)
+  {
+    summary.humidity = (uint16_t)lroundf(humidity.mean());
+    fillStats(summary.stats[SAMPLE_CH_HUMIDITY], humidity, 1);
+  }
+  else
+  {
+    summary.humidity = SAMPLE_HUMIDITY_INVALID;
+  }
+
+  summary.rssi = rssi.count() > 0 ? (int8_t)lroundf(rssi.mean()) : SAMPLE_RSSI_INVALID;
+
+  sampleRecordSeal(summary);
+  reset();
+}
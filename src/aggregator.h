@@ -0,0 +1,67 @@
+#ifndef __AGGREGATOR_H__
+#define __AGGREGATOR_H__
+
+#include <Arduino.h>
+#include "sample_record.h"
+
+//
+// Welford running mean/variance with min and max, constant memory per field
+//
+class RunningStats
+{
+public:
+  RunningStats() { reset(); }
+
+  void reset();
+  void add(float value);
+
+  uint16_t count() const { return n; }
+  float mean() const { return avg; }
+  float stddev() const;
+  float minimum() const { return lowest; }
+  float maximum() const { return highest; }
+
+private:
+  uint16_t n;
+  float avg;
+  float m2;
+  float lowest;
+  float highest;
+};
+
+//
+// Folds consecutive sample records into one summary record per window of `windowSamples`.
+// Every value field is averaged; pm2.5, co2, temperature and humidity also keep min/max/stddev.
+//
+class SampleAggregator
+{
+public:
+  SampleAggregator();
+
+  void begin(uint16_t windowSamples);
+
+  void add(const SampleRecord_t &sample);
+  bool ready() const { return count >= windowSamples; }
+  // The next add() completes the window
+  bool readyAfterNext() const { return count + 1 >= windowSamples; }
+  void summarize(SampleRecord_t &summary);
+
+  uint16_t window() const { return windowSamples; }
+
+private:
+  void reset();
+
+  uint16_t windowSamples;
+  uint16_t count;
+  uint32_t lastTimestamp;
+  uint16_t s8Status;
+  uint16_t s8AbcHours;
+
+  RunningStats pms[PMS_DATA_WORDS];
+  RunningStats co2;
+  RunningStats tempC;
+  RunningStats humidity;
+  RunningStats rssi;
+};
+
+#endif //__AGGREGATOR_H__
@@ -0,0 +1,175 @@
+#include "alloc_tracker.h"
+
+#if ALLOC_TRACKING
+
+AllocTracker allocTracker;
+
+// Sites whose table entry ran out share the last one
+#define ALLOC_SITE_OVERFLOW (ALLOC_SITES_MAX - 1)
+
+AllocTracker::AllocTracker() : siteCount(0), liveCount(0), currentTag(nullptr), loopStartAllocations(0)
+{
+  memset(sites, 0, sizeof(sites));
+  memset(live, 0, sizeof(live));
+  memset(&trackerStats, 0, sizeof(trackerStats));
+  sites[ALLOC_SITE_OVERFLOW].tag = "other";
+}
+
+uint8_t AllocTracker::findSite(const void *caller)
+{
+  for (uint8_t i = 0; i < siteCount; i++)
+  {
+    if (sites[i].caller == caller && sites[i].tag == currentTag)
+      return i;
+  }
+  if (siteCount == ALLOC_SITE_OVERFLOW)
+  {
+    trackerStats.untracked++;
+    return ALLOC_SITE_OVERFLOW;
+  }
+
+  sites[siteCount].tag = currentTag;
+  sites[siteCount].caller = caller;
+  return siteCount++;
+}
+
+void AllocTracker::allocated(void *ptr, size_t size, const void *caller)
+{
+  if (ptr == nullptr)
+    return;
+
+  uint8_t s = findSite(caller);
+  AllocSite_t &site = sites[s];
+  site.allocations++;
+  site.bytes += size;
+  trackerStats.allocations++;
+  trackerStats.bytes += size;
+
+  // A block that can't be remembered is counted but never shows up as live
+  if (liveCount == ALLOC_LIVE_MAX || size > UINT16_MAX)
+  {
+    trackerStats.untracked++;
+    return;
+  }
+  live[liveCount++] = {ptr, (uint16_t)size, s};
+  site.liveBytes += size;
+  site.peakLiveBytes = max(site.peakLiveBytes, site.liveBytes);
+  trackerStats.liveBytes += size;
+  trackerStats.peakLiveBytes = max(trackerStats.peakLiveBytes, trackerStats.liveBytes);
+}
+
+void AllocTracker::freed(void *ptr)
+{
+  if (ptr == nullptr)
+    return;
+
+  trackerStats.frees++;
+  // Most blocks are short-lived, the newest are searched first
+  for (uint16_t i = liveCount; i-- > 0;)
+  {
+    if (live[i].ptr != ptr)
+      continue;
+    sites[live[i].site].liveBytes -= live[i].size;
+    trackerStats.liveBytes -= live[i].size;
+    live[i] = live[--liveCount];
+    return;
+  }
+}
+
+void AllocTracker::loopFinished(bool steady)
+{
+  if (!steady)
+    return;
+
+  uint32_t allocations = trackerStats.allocations - loopStartAllocations;
+  trackerStats.loops++;
+  trackerStats.loopAllocations += allocations;
+  if (allocations > 0)
+    trackerStats.allocatingLoops++;
+  trackerStats.maxLoopAllocations = max(trackerStats.maxLoopAllocations, allocations);
+}
+
+void AllocTracker::printStats(Print &out) const
+{
+  // Per-mille keeps the average in integers, printf's float support isn't always linked in
+  out.printf("alloc %u allocations %u frees %u B live, peak %u B, untracked %u; steady loops %u allocating %u "
+             "allocations %u (%u per 1000 loops) max %u in one loop\n",
+             trackerStats.allocations, trackerStats.frees, trackerStats.liveBytes, trackerStats.peakLiveBytes,
+             trackerStats.untracked, trackerStats.loops, trackerStats.allocatingLoops, trackerStats.loopAllocations,
+             trackerStats.loops > 0 ? (uint32_t)((uint64_t)trackerStats.loopAllocations * 1000 / trackerStats.loops)
+                                    : 0,
+             trackerStats.maxLoopAllocations);
+
+  // Busiest sites first, a handful of passes over a small table
+  uint8_t order[ALLOC_SITES_MAX];
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < ALLOC_SITES_MAX; i++)
+  {
+    if (sites[i].allocations == 0)
+      continue;
+    uint8_t j = count++;
+    while (j > 0 && sites[order[j - 1]].allocations < sites[i].allocations)
+    {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+
+  for (uint8_t i = 0; i < count && i < ALLOC_REPORT_SITES; i++)
+  {
+    const AllocSite_t &site = sites[order[i]];
+    out.printf("alloc site %-8s %08x allocations %6u bytes %8u live %5u B peak %5u B\n",
+               site.tag != nullptr ? site.tag : "-", (uint32_t)(uintptr_t)site.caller, site.allocations,
+               (uint32_t)site.bytes, site.liveBytes, site.peakLiveBytes);
+  }
+}
+
+#ifndef NATIVE
+//
+// Linked with -Wl,--wrap=malloc,--wrap=free,--wrap=realloc,--wrap=calloc: every call from the sketch,
+// its libraries and the core's operator new lands here first. The SDK allocates through its own
+// entry points and isn't counted.
+//
+extern "C"
+{
+  void *__real_malloc(size_t size);
+  void __real_free(void *ptr);
+  void *__real_realloc(void *ptr, size_t size);
+  void *__real_calloc(size_t count, size_t size);
+
+  void *__wrap_malloc(size_t size)
+  {
+    void *ptr = __real_malloc(size);
+    allocTracker.allocated(ptr, size, __builtin_return_address(0));
+    return ptr;
+  }
+
+  void __wrap_free(void *ptr)
+  {
+    allocTracker.freed(ptr);
+    __real_free(ptr);
+  }
+
+  void *__wrap_realloc(void *ptr, size_t size)
+  {
+    void *moved = __real_realloc(ptr, size);
+    // A failed realloc leaves the old block in place
+    if (moved != nullptr || size == 0)
+    {
+      allocTracker.freed(ptr);
+      allocTracker.allocated(moved, size, __builtin_return_address(0));
+    }
+    return moved;
+  }
+
+  void *__wrap_calloc(size_t count, size_t size)
+  {
+    void *ptr = __real_calloc(count, size);
+    allocTracker.allocated(ptr, count * size, __builtin_return_address(0));
+    return ptr;
+  }
+}
+#endif
+
+#endif // ALLOC_TRACKING
@@ -0,0 +1,105 @@
+#ifndef __ALLOC_TRACKER_H__
+#define __ALLOC_TRACKER_H__
+
+#include <Arduino.h>
+#include "config.h"
+
+#if ALLOC_TRACKING
+
+typedef struct
+{
+  const char *tag;
+  // Return address of the malloc() or operator new call
+  const void *caller;
+  uint32_t allocations;
+  uint64_t bytes;
+  uint32_t liveBytes;
+  uint32_t peakLiveBytes;
+} AllocSite_t;
+
+typedef struct
+{
+  uint32_t allocations;
+  uint32_t frees;
+  uint64_t bytes;
+  uint32_t liveBytes;
+  uint32_t peakLiveBytes;
+  // Allocations kept out of the sites or the live blocks, their tables were full
+  uint32_t untracked;
+  // loop() iterations once the boot sequence finished, how many of them allocated and how much
+  uint32_t loops;
+  uint32_t allocatingLoops;
+  uint32_t loopAllocations;
+  uint32_t maxLoopAllocations;
+} AllocStats_t;
+
+//
+// Counts heap allocations by where they come from: the tag of the innermost ALLOC_TAG scope (the
+// scheduler tags each task with its name) and the calling address, which addr2line resolves
+// against the firmware's ELF. A fixed table of the live blocks gives every site the bytes it still
+// holds and its peak. Nothing here allocates, the hooks run inside the allocator's wrappers.
+//
+class AllocTracker
+{
+public:
+  AllocTracker();
+
+  void allocated(void *ptr, size_t size, const void *caller);
+  void freed(void *ptr);
+
+  const char *tag() const { return currentTag; }
+  void setTag(const char *tag) { currentTag = tag; }
+
+  // Around every loop(), `steady` once the boot sequence is done and the loop should stop allocating
+  void loopStarted() { loopStartAllocations = trackerStats.allocations; }
+  void loopFinished(bool steady);
+
+  const AllocStats_t &stats() const { return trackerStats; }
+  // Totals, then the ALLOC_REPORT_SITES sites with the most allocations
+  void printStats(Print &out) const;
+
+private:
+  typedef struct
+  {
+    void *ptr;
+    uint16_t size;
+    uint8_t site;
+  } LiveBlock_t;
+
+  uint8_t findSite(const void *caller);
+
+  AllocSite_t sites[ALLOC_SITES_MAX];
+  uint8_t siteCount;
+  LiveBlock_t live[ALLOC_LIVE_MAX];
+  uint16_t liveCount;
+  const char *currentTag;
+  uint32_t loopStartAllocations;
+  AllocStats_t trackerStats;
+};
+
+extern AllocTracker allocTracker;
+
+// Allocations within the scope go to `tag`, the enclosing tag comes back when it is left
+class AllocTagScope
+{
+public:
+  explicit AllocTagScope(const char *tag) : previous(allocTracker.tag()) { allocTracker.setTag(tag); }
+  ~AllocTagScope() { allocTracker.setTag(previous); }
+
+private:
+  const char *previous;
+};
+
+#define ALLOC_TAG(tag) AllocTagScope allocTagScope(tag)
+#define ALLOC_LOOP_STARTED() allocTracker.loopStarted()
+#define ALLOC_LOOP_FINISHED(steady) allocTracker.loopFinished(steady)
+
+#else
+
+#define ALLOC_TAG(tag) ((void)0)
+#define ALLOC_LOOP_STARTED() ((void)0)
+#define ALLOC_LOOP_FINISHED(steady) ((void)0)
+
+#endif // ALLOC_TRACKING
+
+#endif //__ALLOC_TRACKER_H__
@@ -0,0 +1,62 @@
+#include "arena.h"
+
+#include <stdarg.h>
+
+Arena::Arena(uint8_t *buffer, size_t size) : buffer(buffer), size(size), offset(0)
+{
+  memset(&arenaStats, 0, sizeof(arenaStats));
+}
+
+void *Arena::alloc(size_t size)
+{
+  size_t start = (offset + 3) & ~(size_t)3;
+  if (start > this->size || size > this->size - start)
+  {
+    arenaStats.failures++;
+    return nullptr;
+  }
+
+  offset = start + size;
+  if (offset > arenaStats.peak)
+    arenaStats.peak = offset;
+  return buffer + start;
+}
+
+char *Arena::copy(const char *text)
+{
+  size_t length = strlen(text);
+  char *copied = (char *)alloc(length + 1);
+  if (copied != nullptr)
+    memcpy(copied, text, length + 1);
+  return copied;
+}
+
+char *Arena::printf(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(nullptr, 0, format, args);
+  va_end(args);
+  if (length < 0)
+    return nullptr;
+
+  char *text = (char *)alloc(length + 1);
+  if (text == nullptr)
+    return nullptr;
+  va_start(args, format);
+  vsnprintf(text, length + 1, format, args);
+  va_end(args);
+  return text;
+}
+
+void Arena::reset()
+{
+  offset = 0;
+  arenaStats.resets++;
+}
+
+void Arena::printStats(Print &out) const
+{
+  out.printf("arena %u B peak %u B resets %u failed allocations %u\n", (uint32_t)size, (uint32_t)arenaStats.peak,
+             arenaStats.resets, arenaStats.failures);
+}
@@ -0,0 +1,46 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <Arduino.h>
+
+typedef struct
+{
+  uint32_t resets;
+  uint32_t failures;
+  size_t peak;
+} ArenaStats_t;
+
+//
+// Bump allocator over a fixed block of RAM for buffers that only live until the end of the current
+// loop() cycle: allocations just move an offset forward and reset() hands the whole block back at
+// once, so per-sample temporaries never reach the heap and can't leave holes between the long-lived
+// allocations there. An allocation that doesn't fit returns nullptr, the caller skips that work.
+//
+class Arena
+{
+public:
+  Arena(uint8_t *buffer, size_t size);
+
+  // Aligned to 4 bytes, nullptr once the block is used up
+  void *alloc(size_t size);
+  char *copy(const char *text);
+  char *printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+  void reset();
+  // Hands back everything allocated since mark(), for loops that encode one buffer per pass
+  size_t mark() const { return offset; }
+  void rewind(size_t mark) { offset = mark < offset ? mark : offset; }
+
+  size_t used() const { return offset; }
+  size_t capacity() const { return size; }
+  const ArenaStats_t &stats() const { return arenaStats; }
+  void printStats(Print &out) const;
+
+private:
+  uint8_t *buffer;
+  size_t size;
+  size_t offset;
+  ArenaStats_t arenaStats;
+};
+
+#endif //__ARENA_H__
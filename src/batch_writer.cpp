@@ -0,0 +1,201 @@
+#include "batch_writer.h"
+#include "logger.h"
+#include "trace.h"
+
+#include <new>
+
+BatchWriter::BatchWriter()
+    : client(nullptr), http(nullptr), udp(nullptr), body(nullptr), bodyLength(0), batchSize(1), bufferSize(1),
+      flushIntervalMs(0), pendingPoints(0), oldestPendingMs(0), failedFlushMs(0)
+{
+  memset(&batchStats, 0, sizeof(batchStats));
+}
+
+void BatchWriter::begin(InfluxDBClient *client, uint16_t batchSize, uint16_t bufferSize, uint16_t flushIntervalSec,
+                        HttpWriter *http, UdpWriter *udp)
+{
+  this->client = client;
+  this->http = http;
+  this->udp = udp;
+  bodyLength = 0;
+  if (body == nullptr)
+  {
+    body = new (std::nothrow) char[BATCH_BODY_MAX];
+    if (body == nullptr)
+      LOG_ERROR("No memory for the batch body, nothing can be sent");
+  }
+  this->batchSize = batchSize > 0 ? batchSize : 1;
+  this->flushIntervalMs = (uint32_t)flushIntervalSec * 1000;
+
+  // The client buffer must hold at least one full batch
+  this->bufferSize = bufferSize < this->batchSize ? this->batchSize : bufferSize;
+
+  client->setWriteOptions(WriteOptions()
+                              .writePrecision(WritePrecision::S)
+                              .batchSize(this->batchSize)
+                              .bufferSize(this->bufferSize)
+                              .flushInterval(flushIntervalSec));
+}
+
+bool BatchWriter::write(const char *line)
+{
+  if (client == nullptr)
+    return false;
+
+  uint32_t start = millis();
+
+  if (pendingPoints == 0)
+    oldestPendingMs = start;
+
+  bool ok = true;
+  if (ownBody())
+  {
+    if (body == nullptr)
+      return false;
+    size_t length = strlen(line);
+    if (length + 1 > BATCH_BODY_MAX)
+      return false;
+    // A full body is sent early, what still doesn't fit after a failed send is dropped oldest first
+    if (bodyLength > 0 && bodyLength + 1 + length + 1 > BATCH_BODY_MAX)
+    {
+      if (!timedFlush(start))
+        dropOldest(bodyLength + 1 + length + 1 - BATCH_BODY_MAX);
+      else if (pendingPoints == 0)
+        // The next batch starts with this line, its interval counts from now
+        oldestPendingMs = start;
+    }
+    if (bodyLength > 0)
+      body[bodyLength++] = '\n';
+    memcpy(body + bodyLength, line, length + 1);
+    bodyLength += length;
+    pendingPoints++;
+  }
+  else
+  {
+    // Records carry their own second-precision timestamp from sample time
+    ok = client->writeRecord(line);
+    // The line is buffered even if the send it triggered failed, once the buffer is full the client
+    // drops the oldest point for it
+    if (pendingPoints < bufferSize)
+      pendingPoints++;
+    else
+      batchStats.droppedPoints++;
+  }
+  batchStats.points++;
+
+  if (pendingPoints >= batchSize || (flushIntervalMs > 0 && start - oldestPendingMs >= flushIntervalMs))
+    return timedFlush(start);
+
+  // The client may already have sent the batch from within writeRecord
+  if (ok && !ownBody() && client->isBufferEmpty())
+    return timedFlush(start);
+
+  return ok;
+}
+
+char *BatchWriter::replayBody(size_t *size)
+{
+  if (pendingPoints > 0 || body == nullptr)
+    return nullptr;
+  *size = BATCH_BODY_MAX;
+  return body;
+}
+
+bool BatchWriter::flushIfDue()
+{
+  if (pendingPoints == 0 || flushIntervalMs == 0)
+    return true;
+
+  uint32_t now = millis();
+  if (now - oldestPendingMs < flushIntervalMs)
+    return true;
+  if (batchStats.failedFlushes > 0 && now - failedFlushMs < flushIntervalMs)
+    return false;
+
+  return flush();
+}
+
+bool BatchWriter::flushDue(uint32_t atMs, uint16_t newPoints) const
+{
+  uint16_t points = pendingPoints + newPoints;
+  if (points == 0)
+    return false;
+
+  uint32_t oldest = pendingPoints > 0 ? oldestPendingMs : atMs;
+  return points >= batchSize || (flushIntervalMs > 0 && atMs - oldest >= flushIntervalMs);
+}
+
+bool BatchWriter::flush()
+{
+  if (client == nullptr || pendingPoints == 0)
+    return true;
+
+  return timedFlush(millis());
+}
+
+bool BatchWriter::timedFlush(uint32_t startMs)
+{
+  uint16_t points = pendingPoints;
+  TRACE_BEGIN(TRACE_WRITE);
+  bool ok = udp != nullptr    ? udp->send(body, bodyLength)
+            : http != nullptr ? http->post(body, bodyLength)
+                              : client->flushBuffer();
+  TRACE_END(TRACE_WRITE);
+  uint32_t elapsed = millis() - startMs;
+
+  batchStats.lastFlushMs = elapsed;
+  batchStats.totalFlushMs += elapsed;
+  if (elapsed > batchStats.maxFlushMs)
+    batchStats.maxFlushMs = elapsed;
+
+  if (!ok)
+  {
+    // Points stay in the client buffer and are retried with the next flush
+    batchStats.failedFlushes++;
+    failedFlushMs = millis();
+    LOG_WARN("InfluxDB flush failed: %s", lastError().c_str());
+    return false;
+  }
+
+  batchStats.flushes++;
+  batchStats.flushedPoints += points;
+  pendingPoints = 0;
+  bodyLength = 0;
+
+  LOG_INFO("InfluxDB flushed %u points in %u ms", points, elapsed);
+  return true;
+}
+
+void BatchWriter::dropOldest(size_t bytes)
+{
+  // Whole lines only, the body always starts at a line
+  size_t cut = 0;
+  while (cut < bodyLength && (cut < bytes || body[cut - 1] != '\n'))
+  {
+    if (body[cut++] == '\n')
+    {
+      pendingPoints--;
+      batchStats.droppedPoints++;
+    }
+  }
+  if (cut >= bodyLength)
+  {
+    batchStats.droppedPoints += pendingPoints;
+    pendingPoints = 0;
+    bodyLength = 0;
+    return;
+  }
+  memmove(body, body + cut, bodyLength - cut + 1);
+  bodyLength -= cut;
+}
+
+void BatchWriter::printStats(Print &out) const
+{
+  uint32_t attempts = batchStats.flushes + batchStats.failedFlushes;
+  out.printf("batch points %u flushed %u dropped %u flushes %u failed %u pending %u flush last %u ms max %u ms avg "
+             "%u ms\n",
+             batchStats.points, batchStats.flushedPoints, batchStats.droppedPoints, batchStats.flushes,
+             batchStats.failedFlushes, pendingPoints,
+             batchStats.lastFlushMs, batchStats.maxFlushMs,
+             attempts > 0 ? batchStats.totalFlushMs / attempts : 0);
+}
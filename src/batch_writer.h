@@ -0,0 +1,79 @@
+#ifndef __BATCH_WRITER_H__
+#define __BATCH_WRITER_H__
+
+#include <Arduino.h>
+#include <InfluxDbClient.h>
+#include "http_writer.h"
+#include "udp_writer.h"
+
+// Body buffer of a batch sent by our own writers, and of replayed batches; a batch is also sent once
+// its lines fill it. Allocated by `begin()`, which only the HTTP and UDP transports call
+#define BATCH_BODY_MAX 2048
+
+typedef struct
+{
+  uint32_t points;
+  uint32_t flushedPoints;
+  uint32_t droppedPoints;
+  uint32_t flushes;
+  uint32_t failedFlushes;
+  uint32_t lastFlushMs;
+  uint32_t maxFlushMs;
+  uint32_t totalFlushMs;
+} BatchStats_t;
+
+//
+// Queues line protocol records into the InfluxDBClient write buffer and flushes them as one
+// request once `batchSize` points are pending or the oldest one is older than
+// `flushIntervalSec`. The buffer itself is the client's fixed-size buffer,
+// configured through WriteOptions in `begin()`. With an HttpWriter the lines are kept in our own
+// body buffer instead and each batch goes out through it, with a UdpWriter it goes out as
+// datagrams; after failed sends the oldest lines make room for new ones, like the client does.
+// Those are counted in `droppedPoints`, a failed batch itself stays pending and is retried.
+//
+class BatchWriter
+{
+public:
+  BatchWriter();
+
+  void begin(InfluxDBClient *client, uint16_t batchSize, uint16_t bufferSize, uint16_t flushIntervalSec,
+             HttpWriter *http = nullptr, UdpWriter *udp = nullptr);
+
+  bool write(const char *line);
+  bool flushIfDue();
+  bool flush();
+  // Whether writing `newPoints` more at `atMs` sends the batch
+  bool flushDue(uint32_t atMs, uint16_t newPoints) const;
+
+  uint16_t pending() const { return pendingPoints; }
+  // While no point is pending the body is free for a replayed batch, nullptr otherwise
+  char *replayBody(size_t *size);
+  String lastError() const
+  {
+    return udp != nullptr ? String(udp->lastError()) : http != nullptr ? http->lastError() : client->getLastErrorMessage();
+  }
+  const BatchStats_t &stats() const { return batchStats; }
+  void printStats(Print &out) const;
+
+private:
+  bool timedFlush(uint32_t startMs);
+  void dropOldest(size_t bytes);
+  // Lines are kept in `body` rather than the client's buffer
+  bool ownBody() const { return http != nullptr || udp != nullptr; }
+
+  InfluxDBClient *client;
+  HttpWriter *http;
+  UdpWriter *udp;
+  char *body;
+  size_t bodyLength;
+  uint16_t batchSize;
+  uint16_t bufferSize;
+  uint32_t flushIntervalMs;
+  uint16_t pendingPoints;
+  uint32_t oldestPendingMs;
+  // A failed batch is retried from flushIfDue() once per interval, not on every check
+  uint32_t failedFlushMs;
+  BatchStats_t batchStats;
+};
+
+#endif //__BATCH_WRITER_H__
@@ -0,0 +1,86 @@
+#include "boot_sequence.h"
+#include "logger.h"
+
+BootSequence::BootSequence() : stageCount(0), settledCount(0)
+{
+  memset(stages, 0, sizeof(stages));
+}
+
+uint8_t BootSequence::addStage(const char *name, uint16_t dependsOn, BootStart_t start, BootPoll_t poll, uint32_t timeoutMs)
+{
+  if (stageCount >= BOOT_MAX_STAGES)
+    return BOOT_NO_STAGE;
+
+  BootStage_t &stage = stages[stageCount];
+  stage.name = name;
+  stage.dependsOn = dependsOn;
+  stage.start = start;
+  stage.poll = poll;
+  stage.timeoutMs = timeoutMs;
+  stage.state = BOOT_PENDING;
+  return stageCount++;
+}
+
+bool BootSequence::settled(uint8_t stage) const
+{
+  return stage < stageCount && stages[stage].state >= BOOT_DONE;
+}
+
+void BootSequence::settle(BootStage_t &stage, BootState_t state)
+{
+  stage.state = state;
+  stage.settledMs = millis();
+  settledCount++;
+
+  LOG_INFO("boot %-8s %s at %6u ms, took %5u ms", stage.name, state == BOOT_DONE ? "done     " : "timed out",
+           stage.settledMs, stage.settledMs - stage.startedMs);
+  if (finished())
+    LOG_INFO("boot finished at %u ms", stage.settledMs);
+}
+
+void BootSequence::run()
+{
+  if (finished())
+    return;
+
+  for (uint8_t i = 0; i < stageCount; i++)
+  {
+    BootStage_t &stage = stages[i];
+
+    if (stage.state == BOOT_PENDING)
+    {
+      bool ready = true;
+      for (uint8_t dep = 0; dep < stageCount; dep++)
+      {
+        if ((stage.dependsOn & BOOT_AFTER(dep)) && !settled(dep))
+          ready = false;
+      }
+      if (!ready)
+        continue;
+
+      stage.state = BOOT_RUNNING;
+      stage.startedMs = millis();
+      if (stage.start != nullptr)
+        stage.start();
+    }
+
+    if (stage.state != BOOT_RUNNING)
+      continue;
+
+    uint32_t elapsed = millis() - stage.startedMs;
+    if (stage.poll == nullptr || stage.poll(elapsed))
+      settle(stage, BOOT_DONE);
+    else if (stage.timeoutMs > 0 && elapsed >= stage.timeoutMs)
+      settle(stage, BOOT_TIMED_OUT);
+  }
+}
+
+void BootSequence::printStats(Print &out) const
+{
+  for (uint8_t i = 0; i < stageCount; i++)
+  {
+    const BootStage_t &stage = stages[i];
+    out.printf("boot %-8s started %6u ms settled %6u ms%s\n", stage.name, stage.startedMs, stage.settledMs,
+               stage.state == BOOT_TIMED_OUT ? " (timed out)" : stage.state < BOOT_DONE ? " (pending)" : "");
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef __BOOT_SEQUENCE_H__
+#define __BOOT_SEQUENCE_H__
+
+#include <Arduino.h>
+
+#ifndef BOOT_MAX_STAGES
+#define BOOT_MAX_STAGES 8
+#endif
+
+#define BOOT_NO_STAGE 0xff
+#define BOOT_AFTER(stage) (1u << (stage))
+
+typedef void (*BootStart_t)();
+// Returns true once the stage is complete, `elapsedMs` counts from the stage's start
+typedef bool (*BootPoll_t)(uint32_t elapsedMs);
+
+typedef enum
+{
+  BOOT_PENDING = 0,
+  BOOT_RUNNING,
+  BOOT_DONE,
+  BOOT_TIMED_OUT
+} BootState_t;
+
+typedef struct
+{
+  const char *name;
+  uint16_t dependsOn;
+  BootStart_t start;
+  BootPoll_t poll;
+  uint32_t timeoutMs;
+  uint32_t startedMs;
+  uint32_t settledMs;
+  BootState_t state;
+} BootStage_t;
+
+//
+// Startup as a set of stages with dependencies, advanced from loop(). A stage starts once every
+// stage it depends on has settled (completed or timed out), so independent work such as sensor
+// warm-up and WiFi association overlaps instead of running back to back. Each stage is logged
+// with its start and end time since boot.
+//
+class BootSequence
+{
+public:
+  BootSequence();
+
+  // `poll` may be nullptr for stages that complete in `start`; a `timeoutMs` of 0 waits forever
+  uint8_t addStage(const char *name, uint16_t dependsOn, BootStart_t start, BootPoll_t poll, uint32_t timeoutMs = 0);
+
+  void run();
+  bool settled(uint8_t stage) const;
+  bool finished() const { return settledCount == stageCount; }
+
+  void printStats(Print &out) const;
+
+private:
+  void settle(BootStage_t &stage, BootState_t state);
+
+  BootStage_t stages[BOOT_MAX_STAGES];
+  uint8_t stageCount;
+  uint8_t settledCount;
+};
+
+#endif //__BOOT_SEQUENCE_H__
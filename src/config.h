@@ -8,10 +8,236 @@
 //#define USE_IRSG_ROOT_CERT
 
 //
-// Enable HTTP Connection Reuse -- Only enable this if you're trying to reduce conneciton overhead
+// Enable HTTP Connection Reuse -- Only enable this if you're trying to reduce conneciton overhead.
+// Connections that were closed anyway still resume the TLS session cached in `/tls.bin`
 //
 //#define ENABLE_CONNECTION_REUSE
 
 #define U8G2_TOP
 
+//
+// Sampling period used when `sample_delay` is missing from `config.json`
+//
+#define DEFAULT_SAMPLE_DELAY_MS 10000
+
+//
+// Samples taken within `aggregate_window` ms are folded into one point carrying mean/min/max/stddev.
+// 0 (or anything up to the sample period) uploads every sample as before
+//
+#define DEFAULT_AGGREGATE_WINDOW_MS 0
+
+//
+// InfluxDB write batching defaults, overridden by `influx_db.batch_size`, `influx_db.buffer_size` and
+// `influx_db.flush_interval` (seconds) in `config.json`. A batch size of 1 writes every sample immediately.
+// The age of the oldest pending point is checked every BATCH_FLUSH_CHECK_MS between samples
+//
+#define DEFAULT_BATCH_SIZE 1
+#define DEFAULT_BUFFER_SIZE 30
+#define DEFAULT_FLUSH_INTERVAL_S 60
+#define BATCH_FLUSH_CHECK_MS 1000
+
+//
+// Batches (and offline log replays) are sent gzip-compressed when `influx_db.gzip` is true
+//
+#define DEFAULT_GZIP false
+
+//
+// `influx_db.transport`: "http" (the default) or "udp", which sends batches fire-and-forget to the
+// udp://host[:port] in `influx_db.url`, e.g. an InfluxDB 1.x UDP listener or Telegraf's
+// socket_listener set to second precision. A datagram carries whole lines up to UDP_PAYLOAD_MAX
+// bytes, which a 1500-byte MTU takes without fragmenting
+//
+#define TRANSPORT_HTTP 0
+#define TRANSPORT_UDP 1
+#define TRANSPORT_MQTT 2
+#define DEFAULT_TRANSPORT TRANSPORT_HTTP
+#define DEFAULT_UDP_PORT 8089
+#define UDP_PAYLOAD_MAX 1472
+
+//
+// `influx_db.transport: "mqtt"` publishes the batches to the broker in the `mqtt` object of
+// `config.json` instead (host, port, topic, client_id, username, password, keep_alive in seconds and
+// format "line" or "binary"), e.g. for Telegraf's mqtt_consumer. Batches go out with QoS 1 over one
+// persistent session; up to MQTT_INFLIGHT_MAX messages of at most MQTT_PAYLOAD_MAX bytes can wait
+// for their PUBACK at once. Without one for MQTT_ACK_TIMEOUT_MS the connection is dropped and the
+// messages are sent again after reconnecting. Connecting blocks loop() for up to
+// MQTT_CONNECT_TIMEOUT_MS, so while the broker is down the attempts back off from MQTT_RECONNECT_MS
+// to MQTT_RECONNECT_MAX_MS
+//
+#define DEFAULT_MQTT_PORT 1883
+#define DEFAULT_MQTT_KEEP_ALIVE_S 60
+#define MQTT_FORMAT_LINE 0
+#define MQTT_FORMAT_BINARY 1
+#define MQTT_PAYLOAD_MAX 1024
+#define MQTT_INFLIGHT_MAX 4
+#define MQTT_POLL_MS 50
+#define MQTT_ACK_TIMEOUT_MS 10000
+#define MQTT_CONNECT_TIMEOUT_MS 1000
+#define MQTT_RECONNECT_MS 5000
+#define MQTT_RECONNECT_MAX_MS 60000
+#define MQTT_FLUSH_TIMEOUT_MS 3000
+
+//
+// PMS5003 UART, read by our own frame parser instead of the blocking AirGradient call. The RX buffer
+// has to hold what arrives while other tasks block (~1 frame of 32 bytes per second at 9600 baud).
+// A PM reading older than PMS_STALE_MS is reported as missing
+//
+#define PMS_RX_PIN D5
+#define PMS_TX_PIN D6
+#define PMS_BAUD 9600
+#define PMS_RX_BUFFER 256
+#define PMS_STALE_MS 5000
+
+//
+// SenseAir S8 UART, driven by the non-blocking Modbus engine. A transaction is retried S8_RETRIES
+// times after S8_TIMEOUT_MS without a valid reply; the ABC period register is re-read every S8_ABC_REFRESH_MS
+//
+#define CO2_RX_PIN D4
+#define CO2_TX_PIN D3
+#define S8_BAUD 9600
+#define S8_TIMEOUT_MS 180
+#define S8_RETRIES 2
+#define S8_ABC_REFRESH_MS 3600000
+
+//
+// Offline log replay: how often the backlog is checked and how many records are read per replay. A
+// replay sends as many of them as fit the batch writer's body (BATCH_BODY_MAX), idle while there is a
+// backlog: 6-7 plain or 4 aggregated points per request. Replays follow each other back to back until
+// the log is empty, at ~0.4 s per request over https a backlog drains at 15-20 records/s.
+// OFFLINE_PENDING_MAX bounds the samples of pending points mirrored in RAM, those of points the batch
+// writer drops are spilled to the log
+//
+#define OFFLINE_DRAIN_MS 2000
+#define OFFLINE_DRAIN_BATCH 8
+#define OFFLINE_PENDING_MAX 32
+
+//
+// Boot stages: sampling starts once the PMS streams and the S8 answers, or after SENSOR_WARMUP_MS.
+// WiFi first rejoins the saved network in the background: directly on the cached access point,
+// channel and IP lease for WIFI_FAST_CONNECT_MS, then with a scan and DHCP, and only opens the
+// WiFiManager portal after WIFI_CONNECT_TIMEOUT_MS. Once half of the cached lease has passed, or
+// when its age is unknown after a power-on, the direct attempt asks DHCP instead and gets
+// WIFI_FAST_DHCP_MS more. The lease is WIFI_LEASE_DEFAULT_S long when the DHCP server's can't be
+// read. Samples taken before NTP sets the clock (time() below CLOCK_VALID_EPOCH) are held, up to
+// UNSYNCED_SAMPLES_MAX, and dated once it is set
+//
+#define SENSOR_WARMUP_MS 30000
+#define WIFI_FAST_CONNECT_MS 2000
+#define WIFI_FAST_DHCP_MS 2000
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+#define WIFI_LEASE_DEFAULT_S 3600
+#define NTP_SYNC_TIMEOUT_MS 20000
+#define CLOCK_VALID_EPOCH 1600000000
+#define UNSYNCED_SAMPLES_MAX 8
+
+//
+// Offset between the PMS, CO2 and SHT reads within a sample period, the upload runs after the last read
+//
+#define SENSOR_STAGGER_MS 250
+
+//
+// Display layout, overridden by `display_mode` ("pages" or "dashboard") in `config.json`.
+// Pages rotate one sensor per screen every DISPLAY_PAGE_MS, the dashboard shows all readings at once
+// and is checked for changed values every DISPLAY_REFRESH_MS
+//
+#define DISPLAY_MODE_PAGES 0
+#define DISPLAY_MODE_DASHBOARD 1
+#define DEFAULT_DISPLAY_MODE DISPLAY_MODE_PAGES
+#define DISPLAY_PAGE_MS 3000
+#define DISPLAY_REFRESH_MS 1000
+
+//
+// Power saving, overridden by `sleep_mode` ("none", "modem" or "deep") in `config.json`.
+// In modem sleep the radio is switched off between uploads. The radio task checks every
+// RADIO_CHECK_MS and wakes it ahead of the sample period whose point sends the batch, by the last
+// association time plus RADIO_WAKE_MARGIN_MS. In deep sleep the
+// device resets every sample period (D0 wired to RST): it reads the sensors once, keeps the sample
+// in RTC memory and only brings WiFi up every `deep_sleep_flush_every` wakes, or when RTC memory is
+// full, to upload the batch and replay up to DEEP_SLEEP_DRAIN_BATCHES offline log batches. A wake
+// sleeps at least DEEP_SLEEP_MIN_MS
+//
+#define SLEEP_MODE_NONE 0
+#define SLEEP_MODE_DEEP 1
+#define SLEEP_MODE_MODEM 2
+#define DEFAULT_SLEEP_MODE SLEEP_MODE_NONE
+#define RADIO_CHECK_MS 100
+#define RADIO_WAKE_MARGIN_MS 200
+#define DEFAULT_DEEP_SLEEP_FLUSH_EVERY 6
+#define DEEP_SLEEP_DRAIN_BATCHES 4
+#define DEEP_SLEEP_MIN_MS 1000
+
+//
+// Prometheus endpoint, served on `metrics_port` from `config.json` (0 disables it, the usual exporter
+// port for these sensors is 9926). GET /metrics returns the readings of the last sample from a page
+// rendered once per sample; a scrape that hasn't sent its request within METRICS_REQUEST_TIMEOUT_MS
+// is dropped. Scrapes only get through while the radio is on, so not between uploads in modem sleep
+// and never in deep sleep
+//
+#define DEFAULT_METRICS_PORT 0
+#define METRICS_PAGE_MAX 1536
+#define METRICS_REQUEST_TIMEOUT_MS 2000
+
+//
+// Self-telemetry: every `health_interval` seconds of `config.json` (0 disables it) a point of the
+// airgradient_health measurement with heap, loop, task and upload figures joins the next upload.
+// It isn't kept in the offline log
+//
+#define DEFAULT_HEALTH_INTERVAL_S 300
+
+//
+// Per-cycle arena for the buffers a loop() cycle needs only until it ends: the line protocol of a
+// sample and the error text of its write. Only one task runs per cycle, so they share it instead
+// of each holding its own static buffer
+//
+#define CYCLE_ARENA_SIZE 896
+
+//
+// Serial log levels; messages above LOG_LEVEL are compiled out. Messages wait in a LOG_BUFFER_SIZE
+// ring until the UART has room for them, lines longer than LOG_LINE_MAX are cut
+//
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#define LOG_BUFFER_SIZE 2048
+#define LOG_LINE_MAX 160
+
+//
+// Begin/end events of the sensor reads, display updates, writes, TLS connects and LittleFS I/O, kept
+// in a ring of the last TRACE_EVENTS (a power of two, 8 bytes each) for tools/trace_to_chrome.py.
+// Off unless built with -DTRACE_ENABLED=1, e.g. env:d1_mini_trace; the ring is dumped on GET /trace
+// of the metrics port or when a 't' arrives on Serial
+//
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+#define TRACE_EVENTS 512
+
+//
+// Heap allocations counted per tag (the scheduler task, or the setup() and loop() around it) and
+// calling address, with the bytes each still holds, and per loop() once the boot sequence is through.
+// Off unless built with -DALLOC_TRACKING=1: env:d1_mini_alloc, which also wraps malloc, free, realloc
+// and calloc, or env:native_alloc. The busiest ALLOC_REPORT_SITES go out with the housekeeping stats
+//
+#ifndef ALLOC_TRACKING
+#define ALLOC_TRACKING 0
+#endif
+#define ALLOC_SITES_MAX 48
+#define ALLOC_LIVE_MAX 128
+#define ALLOC_REPORT_SITES 10
+#if ALLOC_TRACKING
+// The site report comes on top of the housekeeping stats, the log ring takes both
+#undef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 4096
+#endif
+
+//
+// Interval for printing scheduler statistics (runs, overruns, jitter) on Serial
+//
+#define HOUSEKEEPING_MS 60000
+
 #endif //__CONFIG_H__
@@ -0,0 +1,58 @@
+#include "config_snapshot.h"
+#include "crc32.h"
+
+#include <LittleFS.h>
+
+#define CONFIG_HASH_CHUNK 64
+
+bool configFileHash(const char *path, uint32_t &size, uint32_t &crc)
+{
+  File file = LittleFS.open(path, "r");
+  if (!file)
+    return false;
+
+  uint8_t chunk[CONFIG_HASH_CHUNK];
+  size_t n;
+  size = 0;
+  crc = 0;
+  while ((n = file.read(chunk, sizeof(chunk))) > 0)
+  {
+    crc = crc32Update(crc, chunk, n);
+    size += n;
+  }
+  file.close();
+  return true;
+}
+
+bool configSnapshotLoad(ConfigSnapshot_t &snapshot, uint32_t jsonSize, uint32_t jsonCrc)
+{
+  File file = LittleFS.open(CONFIG_SNAPSHOT_PATH, "r");
+  if (!file)
+    return false;
+
+  size_t n = file.read((uint8_t *)&snapshot, sizeof(snapshot));
+  file.close();
+
+  return n == sizeof(snapshot) && snapshot.magic == CONFIG_SNAPSHOT_MAGIC &&
+         snapshot.version == CONFIG_SNAPSHOT_VERSION && snapshot.length == sizeof(snapshot) &&
+         snapshot.crc == crc32Update(0, (const uint8_t *)&snapshot, offsetof(ConfigSnapshot_t, crc)) &&
+         snapshot.jsonSize == jsonSize && snapshot.jsonCrc == jsonCrc;
+}
+
+bool configSnapshotSave(ConfigSnapshot_t &snapshot, uint32_t jsonSize, uint32_t jsonCrc)
+{
+  snapshot.magic = CONFIG_SNAPSHOT_MAGIC;
+  snapshot.version = CONFIG_SNAPSHOT_VERSION;
+  snapshot.length = sizeof(snapshot);
+  snapshot.jsonSize = jsonSize;
+  snapshot.jsonCrc = jsonCrc;
+  snapshot.crc = crc32Update(0, (const uint8_t *)&snapshot, offsetof(ConfigSnapshot_t, crc));
+
+  File file = LittleFS.open(CONFIG_SNAPSHOT_PATH, "w");
+  if (!file)
+    return false;
+
+  size_t n = file.write((const uint8_t *)&snapshot, sizeof(snapshot));
+  file.close();
+  return n == sizeof(snapshot);
+}
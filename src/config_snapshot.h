@@ -0,0 +1,64 @@
+#ifndef __CONFIG_SNAPSHOT_H__
+#define __CONFIG_SNAPSHOT_H__
+
+#include <Arduino.h>
+
+#define CONFIG_JSON_PATH "/config.json"
+#define CONFIG_SNAPSHOT_PATH "/config.bin"
+
+// Bump the version whenever ConfigSnapshot_t changes
+#define CONFIG_SNAPSHOT_MAGIC 0x47464341 // "ACFG"
+#define CONFIG_SNAPSHOT_VERSION 7
+
+//
+// Everything loadConfig() takes from config.json, in a fixed-size image. `jsonSize` and
+// `jsonCrc` identify the config.json it was generated from, an edited config.json no longer
+// matches and is parsed again.
+//
+typedef struct __attribute__((packed))
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t length;
+  uint32_t jsonSize;
+  uint32_t jsonCrc;
+
+  char deviceName[32];
+  char url[128];
+  char org[64];
+  char bucket[64];
+  char token[128];
+  int32_t sampleDelay;
+  uint32_t aggregateWindow;
+  uint16_t batchSize;
+  uint16_t bufferSize;
+  uint16_t flushInterval;
+  uint8_t displayMode;
+  uint8_t sleepMode;
+  uint16_t deepSleepFlushEvery;
+  uint8_t gzip;
+  uint8_t transport;
+  char mqttHost[64];
+  char mqttTopic[64];
+  char mqttClientId[32];
+  char mqttUsername[32];
+  char mqttPassword[64];
+  uint16_t mqttPort;
+  uint16_t mqttKeepAlive;
+  uint8_t mqttFormat;
+  uint16_t metricsPort;
+  uint16_t healthInterval;
+
+  uint32_t crc;
+} ConfigSnapshot_t;
+
+// Size and CRC-32 of a file, read in small chunks without buffering it whole
+bool configFileHash(const char *path, uint32_t &size, uint32_t &crc);
+
+// Reads the snapshot and checks it is intact and matches the config.json of `jsonSize`/`jsonCrc`
+bool configSnapshotLoad(ConfigSnapshot_t &snapshot, uint32_t jsonSize, uint32_t jsonCrc);
+
+// Stamps the header and CRC and writes the snapshot
+bool configSnapshotSave(ConfigSnapshot_t &snapshot, uint32_t jsonSize, uint32_t jsonCrc);
+
+#endif //__CONFIG_SNAPSHOT_H__
@@ -0,0 +1,14 @@
+#include "crc32.h"
+
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len)
+{
+  // Bitwise, a 1 KB table would cost more RAM than the few checksums here save in time
+  crc = ~crc;
+  while (len--)
+  {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+  }
+  return ~crc;
+}
@@ -0,0 +1,9 @@
+#ifndef __CRC32_H__
+#define __CRC32_H__
+
+#include <Arduino.h>
+
+// CRC-32 (IEEE) as in gzip, `crc` is 0 for the first block and the result of the previous one after
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len);
+
+#endif //__CRC32_H__
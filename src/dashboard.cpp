@@ -0,0 +1,97 @@
+#include "dashboard.h"
+#include <ESP8266WiFi.h>
+
+#define DASH_COLUMN_WIDTH 64
+#define DASH_ROW_HEIGHT 21
+// Labels use the fixed-width 6x10 font, values start this many pixels after the label
+#define DASH_LABEL_GLYPH_WIDTH 6
+#define DASH_LABEL_GAP 2
+// Baseline of the 16 px value font, leaving its descent inside the row
+#define DASH_BASELINE 16
+#define DASH_INVALID INT32_MIN
+// The SDK reports -127 and below when it has no signal to measure
+#define DASH_RSSI_MIN -126
+
+typedef struct
+{
+  const char *label;
+  uint8_t x;
+  uint8_t y;
+  uint8_t valueX;
+} DashboardCell_t;
+
+static constexpr uint8_t labelWidth(const char *label)
+{
+  return *label ? DASH_LABEL_GLYPH_WIDTH + labelWidth(label + 1) : DASH_LABEL_GAP;
+}
+
+#define DASH_CELL(label, column, row) \
+  {label, (column) * DASH_COLUMN_WIDTH, (row) * DASH_ROW_HEIGHT + DASH_BASELINE, (column) * DASH_COLUMN_WIDTH + labelWidth(label)}
+
+static constexpr DashboardCell_t layout[DASH_VALUES] = {
+    DASH_CELL("PM2.5", 0, 0),
+    DASH_CELL("CO2", 1, 0),
+    DASH_CELL("T", 0, 1),
+    DASH_CELL("RH", 1, 1),
+    DASH_CELL("dBm", 0, 2),
+    DASH_CELL("Log", 1, 2)};
+
+static_assert(2 * DASH_VALUES <= DISPLAY_MAX_FIELDS, "dashboard needs a label and a value field per cell");
+// Widest values: "1000" for PM2.5 and "-10.0F" for temperature, 8 px per glyph
+static_assert(layout[DASH_PM25].valueX + 4 * 8 <= DASH_COLUMN_WIDTH, "PM2.5 value overlaps the next column");
+static_assert(layout[DASH_TEMP].valueX + 6 * 8 <= DASH_COLUMN_WIDTH, "temperature value overlaps the next column");
+static_assert(2 * DASH_ROW_HEIGHT + DASH_BASELINE + 4 <= 64, "dashboard rows don't fit the display");
+
+Dashboard::Dashboard() : renderer(nullptr)
+{
+}
+
+void Dashboard::begin(DisplayRenderer *renderer)
+{
+  this->renderer = renderer;
+  renderer->clearFields();
+
+  for (uint8_t i = 0; i < DASH_VALUES; i++)
+  {
+    uint8_t label = renderer->addField(layout[i].x, layout[i].y, u8g2_font_6x10_tf);
+    renderer->setText(label, layout[i].label);
+    valueFields[i] = renderer->addField(layout[i].valueX, layout[i].y, u8g2_font_t0_16_tf);
+    // Something no reading maps to, so the first update formats every value
+    shown[i] = DASH_INVALID + 1;
+  }
+}
+
+void Dashboard::update(const SampleRecord_t &sample, uint32_t backlog)
+{
+  if (renderer == nullptr)
+    return;
+
+  show(DASH_PM25, sample.pms[PMS_PM25] != SAMPLE_PMS_INVALID ? sample.pms[PMS_PM25] : DASH_INVALID);
+  show(DASH_CO2, sample.co2 != SAMPLE_CO2_INVALID ? sample.co2 : DASH_INVALID);
+  // Fahrenheit tenths from centi-Celsius, rounded half away from zero
+  int32_t tempF = sample.tempC * 9 / 5 + 3200;
+  show(DASH_TEMP, sample.tempC != SAMPLE_TEMP_INVALID ? (tempF + (tempF < 0 ? -5 : 5)) / 10 : DASH_INVALID);
+  show(DASH_HUMIDITY, sample.humidity != SAMPLE_HUMIDITY_INVALID ? (sample.humidity + 50) / 100 : DASH_INVALID);
+  // The sample may be older than a disconnect, the link decides whether its signal still means anything
+  show(DASH_RSSI, sample.rssi >= DASH_RSSI_MIN && WiFi.isConnected() ? sample.rssi : DASH_INVALID);
+  show(DASH_BACKLOG, backlog);
+}
+
+void Dashboard::show(uint8_t value, int32_t raw)
+{
+  if (raw == shown[value])
+    return;
+  shown[value] = raw;
+
+  char text[DISPLAY_FIELD_CHARS];
+  if (raw == DASH_INVALID)
+    strcpy(text, "--");
+  else if (value == DASH_TEMP)
+    snprintf(text, sizeof(text), "%s%d.%dF", raw < 0 ? "-" : "", abs(raw) / 10, abs(raw) % 10);
+  else if (value == DASH_HUMIDITY)
+    snprintf(text, sizeof(text), "%d%%", raw);
+  else
+    snprintf(text, sizeof(text), "%d", raw);
+
+  renderer->setText(valueFields[value], text);
+}
@@ -0,0 +1,40 @@
+#ifndef __DASHBOARD_H__
+#define __DASHBOARD_H__
+
+#include <Arduino.h>
+#include "display_renderer.h"
+#include "sample_record.h"
+
+// Values shown on the dashboard, in layout order
+enum DashboardValue
+{
+  DASH_PM25 = 0,
+  DASH_CO2,
+  DASH_TEMP,
+  DASH_HUMIDITY,
+  DASH_RSSI,
+  DASH_BACKLOG,
+  DASH_VALUES
+};
+
+//
+// Single-screen view of all readings, two columns of three label/value cells. Positions are
+// fixed at compile time; a value is only formatted again when the reading behind it changed.
+//
+class Dashboard
+{
+public:
+  Dashboard();
+
+  void begin(DisplayRenderer *renderer);
+  void update(const SampleRecord_t &sample, uint32_t backlog);
+
+private:
+  void show(uint8_t value, int32_t raw);
+
+  DisplayRenderer *renderer;
+  uint8_t valueFields[DASH_VALUES];
+  int32_t shown[DASH_VALUES];
+};
+
+#endif //__DASHBOARD_H__
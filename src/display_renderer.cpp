@@ -0,0 +1,141 @@
+#include "display_renderer.h"
+
+#define DISPLAY_TILE_PIXELS 8
+
+DisplayRenderer::DisplayRenderer()
+    : display(nullptr), flipped(false), layoutChanged(true), currentFont(nullptr), fieldCount(0)
+{
+  memset(&renderStats, 0, sizeof(renderStats));
+}
+
+void DisplayRenderer::begin(U8G2 *display, bool flipped)
+{
+  this->display = display;
+  this->flipped = flipped;
+  clearFields();
+}
+
+uint8_t DisplayRenderer::addField(uint8_t x, uint8_t y, const uint8_t *font)
+{
+  if (fieldCount == DISPLAY_MAX_FIELDS)
+    return DISPLAY_NO_FIELD;
+
+  DisplayField_t &field = fields[fieldCount];
+  field.x = x;
+  field.y = y;
+  field.font = font;
+  field.paintedWidth = 0;
+  field.dirty = true;
+  field.text[0] = '\0';
+  layoutChanged = true;
+  return fieldCount++;
+}
+
+void DisplayRenderer::clearFields()
+{
+  // The next render starts from a blank screen
+  fieldCount = 0;
+  layoutChanged = true;
+}
+
+void DisplayRenderer::setText(uint8_t field, const char *text)
+{
+  if (field >= fieldCount || strncmp(fields[field].text, text, DISPLAY_FIELD_CHARS - 1) == 0)
+    return;
+
+  strlcpy(fields[field].text, text, DISPLAY_FIELD_CHARS);
+  fields[field].dirty = true;
+}
+
+void DisplayRenderer::useFont(const uint8_t *font)
+{
+  if (font != currentFont)
+  {
+    display->setFont(font);
+    currentFont = font;
+  }
+}
+
+bool DisplayRenderer::render()
+{
+  if (display == nullptr)
+    return false;
+
+  uint32_t start = micros();
+  uint8_t tileWidth = display->getBufferTileWidth();
+  uint8_t tileHeight = display->getBufferTileHeight();
+
+  if (layoutChanged)
+  {
+    display->clearBuffer();
+    for (uint8_t i = 0; i < fieldCount; i++)
+    {
+      DisplayField_t &field = fields[i];
+      useFont(field.font);
+      field.paintedWidth = display->drawStr(field.x, field.y, field.text);
+      field.dirty = false;
+    }
+    display->sendBuffer();
+    layoutChanged = false;
+    renderStats.fullFrames++;
+    renderStats.tiles += tileWidth * tileHeight;
+  }
+  else
+  {
+    bool sent = false;
+    for (uint8_t i = 0; i < fieldCount; i++)
+    {
+      DisplayField_t &field = fields[i];
+      if (!field.dirty)
+        continue;
+
+      useFont(field.font);
+      int16_t top = max(0, field.y - display->getAscent());
+      int16_t bottom = field.y - display->getDescent();
+      uint8_t width = display->getStrWidth(field.text);
+      int16_t right = field.x + max(width, field.paintedWidth);
+
+      // Blank what the old text covered, then draw the new one
+      display->setDrawColor(0);
+      display->drawBox(field.x, top, field.paintedWidth, bottom - top);
+      display->setDrawColor(1);
+      field.paintedWidth = display->drawStr(field.x, field.y, field.text);
+      field.dirty = false;
+
+      // Send each field's own tiles, a box around fields far apart would resend what is between them
+      uint8_t tx = field.x / DISPLAY_TILE_PIXELS;
+      uint8_t ty = top / DISPLAY_TILE_PIXELS;
+      uint8_t tw = min((right + DISPLAY_TILE_PIXELS - 1) / DISPLAY_TILE_PIXELS, (int)tileWidth) - tx;
+      uint8_t th = min((bottom + DISPLAY_TILE_PIXELS - 1) / DISPLAY_TILE_PIXELS, (int)tileHeight) - ty;
+      if (flipped)
+      {
+        // U8G2_R2 rotates while drawing, so the buffer holds the tiles in panel order
+        tx = tileWidth - tx - tw;
+        ty = tileHeight - ty - th;
+      }
+      display->updateDisplayArea(tx, ty, tw, th);
+      renderStats.tiles += tw * th;
+      sent = true;
+    }
+
+    if (!sent)
+    {
+      renderStats.skipped++;
+      return false;
+    }
+    renderStats.partialFrames++;
+  }
+
+  renderStats.lastUs = micros() - start;
+  renderStats.maxUs = max(renderStats.maxUs, renderStats.lastUs);
+  renderStats.totalUs += renderStats.lastUs;
+  return true;
+}
+
+void DisplayRenderer::printStats(Print &out) const
+{
+  uint32_t frames = renderStats.fullFrames + renderStats.partialFrames;
+  out.printf("display full frames %u partial %u skipped %u tiles %u render last %u avg %u max %u us\n",
+             renderStats.fullFrames, renderStats.partialFrames, renderStats.skipped, renderStats.tiles,
+             renderStats.lastUs, frames > 0 ? (uint32_t)(renderStats.totalUs / frames) : 0, renderStats.maxUs);
+}
@@ -0,0 +1,66 @@
+#ifndef __DISPLAY_RENDERER_H__
+#define __DISPLAY_RENDERER_H__
+
+#include <Arduino.h>
+#include <U8g2lib.h>
+
+#define DISPLAY_MAX_FIELDS 12
+#define DISPLAY_FIELD_CHARS 16
+#define DISPLAY_NO_FIELD 0xff
+
+typedef struct
+{
+  uint8_t x;
+  uint8_t y; // baseline
+  const uint8_t *font;
+  uint8_t paintedWidth;
+  bool dirty;
+  char text[DISPLAY_FIELD_CHARS];
+} DisplayField_t;
+
+typedef struct
+{
+  uint32_t fullFrames;
+  uint32_t partialFrames;
+  uint32_t skipped;
+  uint32_t tiles;
+  uint32_t lastUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+} DisplayRenderStats_t;
+
+//
+// Retained-mode text display. The layout is a set of fields at fixed positions, each remembering
+// what it last showed. render() only touches the fields whose text changed: it repaints them in
+// the frame buffer and sends just the 8x8 pixel tiles around them, or nothing when all is unchanged.
+//
+class DisplayRenderer
+{
+public:
+  DisplayRenderer();
+
+  // `flipped` tells that the display is mounted with U8G2_R2, whose buffer tiles are mirrored
+  void begin(U8G2 *display, bool flipped);
+
+  uint8_t addField(uint8_t x, uint8_t y, const uint8_t *font);
+  void clearFields();
+
+  void setText(uint8_t field, const char *text);
+  bool render();
+
+  const DisplayRenderStats_t &stats() const { return renderStats; }
+  void printStats(Print &out) const;
+
+private:
+  void useFont(const uint8_t *font);
+
+  U8G2 *display;
+  bool flipped;
+  bool layoutChanged;
+  const uint8_t *currentFont;
+  uint8_t fieldCount;
+  DisplayField_t fields[DISPLAY_MAX_FIELDS];
+  DisplayRenderStats_t renderStats;
+};
+
+#endif //__DISPLAY_RENDERER_H__
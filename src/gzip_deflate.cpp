@@ -0,0 +1,204 @@
+#include "gzip_deflate.h"
+#include "crc32.h"
+
+// RFC 1951 length and distance codes: base value and number of extra bits
+static const uint16_t lengthBase[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBase[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtra[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+typedef struct
+{
+  uint8_t *out;
+  size_t size;
+  size_t pos;
+  uint32_t bits;
+  uint8_t count;
+  bool overflow;
+} BitWriter_t;
+
+// Deflate packs values least significant bit first
+static void putBits(BitWriter_t &w, uint32_t value, uint8_t count)
+{
+  w.bits |= value << w.count;
+  w.count += count;
+  while (w.count >= 8)
+  {
+    if (w.pos < w.size)
+      w.out[w.pos++] = w.bits & 0xff;
+    else
+      w.overflow = true;
+    w.bits >>= 8;
+    w.count -= 8;
+  }
+}
+
+// ... but Huffman codes most significant bit first
+static void putCode(BitWriter_t &w, uint16_t code, uint8_t length)
+{
+  uint16_t reversed = 0;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+  putBits(w, reversed, length);
+}
+
+static void putSymbol(BitWriter_t &w, uint16_t symbol)
+{
+  if (symbol < 144)
+    putCode(w, 0x30 + symbol, 8);
+  else if (symbol < 256)
+    putCode(w, 0x190 + symbol - 144, 9);
+  else if (symbol < 280)
+    putCode(w, symbol - 256, 7);
+  else
+    putCode(w, 0xc0 + symbol - 280, 8);
+}
+
+static void putMatch(BitWriter_t &w, uint16_t length, uint16_t distance)
+{
+  uint8_t i = sizeof(lengthBase) / sizeof(lengthBase[0]) - 1;
+  while (lengthBase[i] > length)
+    i--;
+  putSymbol(w, 257 + i);
+  putBits(w, length - lengthBase[i], lengthExtra[i]);
+
+  uint8_t d = sizeof(distanceBase) / sizeof(distanceBase[0]) - 1;
+  while (distanceBase[d] > distance)
+    d--;
+  putCode(w, d, 5);
+  putBits(w, distance - distanceBase[d], distanceExtra[d]);
+}
+
+static uint16_t hash3(const uint8_t *p)
+{
+  uint32_t key = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+  return (key * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+//
+// Longest match for position `i` among the earlier positions with the same hash, which the caller
+// has already looked up in `head` and passes as `candidate` (position + 1, 0 for none)
+//
+static size_t longestMatch(const uint8_t *in, size_t length, size_t i, size_t candidate, const uint16_t *chain,
+                           size_t &distance)
+{
+  size_t best = 0;
+  size_t limit = min((size_t)DEFLATE_MAX_MATCH, length - i);
+  for (uint8_t tries = 0; candidate > 0 && tries < DEFLATE_CHAIN; tries++)
+  {
+    size_t pos = candidate - 1;
+    if (i - pos > DEFLATE_WINDOW)
+      break;
+
+    const uint8_t *match = in + pos;
+    if (match[best] == in[i + best])
+    {
+      size_t n = 0;
+      while (n < limit && match[n] == in[i + n])
+        n++;
+      if (n > best)
+      {
+        best = n;
+        distance = i - pos;
+        if (n == limit)
+          break;
+      }
+    }
+    candidate = chain[pos % DEFLATE_WINDOW];
+    // Older entries of the chain may have been overwritten by newer positions
+    if (candidate > pos)
+      break;
+  }
+  return best;
+}
+
+static void putLE32(uint8_t *out, uint32_t value)
+{
+  for (uint8_t i = 0; i < 4; i++)
+    out[i] = value >> (8 * i);
+}
+
+size_t gzipCompress(const uint8_t *in, size_t length, uint8_t *out, size_t outSize, DeflateTables_t &tables)
+{
+  if (length > UINT16_MAX || outSize < GZIP_OVERHEAD)
+    return 0;
+
+  uint16_t *head = tables.head;
+  uint16_t *chain = tables.chain;
+  memset(head, 0, sizeof(tables.head));
+
+  // Member header: deflate, no name or timestamp, unknown OS
+  static const uint8_t header[] = {0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff};
+  memcpy(out, header, sizeof(header));
+
+  BitWriter_t w = {out, outSize - 8, sizeof(header), 0, 0, false};
+  // One final block with the fixed codes
+  putBits(w, 1, 1);
+  putBits(w, 1, 2);
+
+  // Match found at the previous position, held back in case this one has a longer one
+  size_t heldLength = 0;
+  size_t heldDistance = 0;
+
+  size_t i = 0;
+  while (i < length && !w.overflow)
+  {
+    size_t matchLength = 0;
+    size_t matchDistance = 0;
+    if (i + DEFLATE_MIN_MATCH <= length)
+    {
+      uint16_t h = hash3(in + i);
+      matchLength = longestMatch(in, length, i, head[h], chain, matchDistance);
+      chain[i % DEFLATE_WINDOW] = head[h];
+      head[h] = i + 1;
+    }
+
+    if (heldLength >= DEFLATE_MIN_MATCH && matchLength <= heldLength)
+    {
+      // The previous position wins, its match started one byte back
+      putMatch(w, heldLength, heldDistance);
+      for (size_t k = i + 1; k < i - 1 + heldLength && k + DEFLATE_MIN_MATCH <= length; k++)
+      {
+        uint16_t h = hash3(in + k);
+        chain[k % DEFLATE_WINDOW] = head[h];
+        head[h] = k + 1;
+      }
+      i += heldLength - 1;
+      heldLength = 0;
+      continue;
+    }
+
+    // Emit the previous byte as a literal if it wasn't covered by a match
+    if (i > 0 && heldLength > 0)
+      putSymbol(w, in[i - 1]);
+    if (matchLength >= DEFLATE_MIN_MATCH)
+    {
+      heldLength = matchLength;
+      heldDistance = matchDistance;
+    }
+    else
+    {
+      putSymbol(w, in[i]);
+      heldLength = 0;
+    }
+    i++;
+  }
+  if (heldLength >= DEFLATE_MIN_MATCH)
+    putMatch(w, heldLength, heldDistance);
+
+  putSymbol(w, 256);
+  if (w.count > 0)
+    putBits(w, 0, 8 - w.count);
+  if (w.overflow)
+    return 0;
+
+  putLE32(out + w.pos, crc32Update(0, in, length));
+  putLE32(out + w.pos + 4, length);
+  return w.pos + 8;
+}
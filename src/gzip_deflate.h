@@ -0,0 +1,39 @@
+#ifndef __GZIP_DEFLATE_H__
+#define __GZIP_DEFLATE_H__
+
+#include <Arduino.h>
+
+//
+// Matches are searched DEFLATE_WINDOW bytes back, through a hash of the next 3 bytes chained over
+// the window and followed for at most DEFLATE_CHAIN candidates. The hash heads and the chain are
+// 16-bit positions, (DEFLATE_HASH_SIZE + DEFLATE_WINDOW) * 2 bytes are all the RAM the compressor
+// needs besides its input and output, held by the caller in DeflateTables_t
+//
+#define DEFLATE_WINDOW 1024
+#define DEFLATE_CHAIN 8
+#define DEFLATE_HASH_BITS 9
+#define DEFLATE_HASH_SIZE (1 << DEFLATE_HASH_BITS)
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+
+// Fixed header and trailer of a gzip member
+#define GZIP_OVERHEAD 18
+
+typedef struct
+{
+  // Last position + 1 of each 3-byte hash and, per position in the window, the previous one with
+  // the same hash; 0 for none
+  uint16_t head[DEFLATE_HASH_SIZE];
+  uint16_t chain[DEFLATE_WINDOW];
+} DeflateTables_t;
+
+//
+// Compresses `length` bytes (at most 64 KiB) into a gzip member made of a single deflate block with
+// the fixed Huffman codes. Line protocol repeats the measurement and tags on every line, so short
+// matches against the previous lines do most of the work and dynamic codes wouldn't pay for their
+// table. `tables` is scratch space, overwritten by every call. Returns the compressed size, 0 when it
+// doesn't fit into `outSize`.
+//
+size_t gzipCompress(const uint8_t *in, size_t length, uint8_t *out, size_t outSize, DeflateTables_t &tables);
+
+#endif //__GZIP_DEFLATE_H__
@@ -0,0 +1,87 @@
+#include "health_monitor.h"
+#include "logger.h"
+
+// Scheduler tasks of each stage and the fields their average and longest run go to
+static const char *const stageTasks[HEALTH_STAGES][HEALTH_STAGE_TASKS] = {
+    {"pm", "co2", "sht"}, {"display", nullptr, nullptr}, {"network", nullptr, nullptr}};
+static const char *const stageFields[HEALTH_STAGES][2] = {
+    {"sensors_us", "sensors_max_us"}, {"display_us", "display_max_us"}, {"network_us", "network_max_us"}};
+
+HealthMonitor::HealthMonitor()
+    : loopStartUs(0), loops(0), busyUs(0), maxBusyUs(0), maxPeriodUs(0), windowStartUs(0), windowLoops(0), uptimeMs(0),
+      lastCollectMs(0), lastWrites(0), lastWriteMs(0)
+{
+  memset(stageTotalUs, 0, sizeof(stageTotalUs));
+  memset(stageRuns, 0, sizeof(stageRuns));
+}
+
+uint8_t HealthMonitor::collect(Scheduler &scheduler, const HealthWrites_t &writes, LineProtocolField_t *fields)
+{
+  uint8_t n = 0;
+
+  // One walk of the heap for all three
+  uint32_t freeHeap = 0;
+  uint32_t maxBlock = 0;
+  uint8_t fragmentation = 0;
+  ESP.getHeapStats(&freeHeap, &maxBlock, &fragmentation);
+  fields[n++] = {"free_heap", (int32_t)freeHeap};
+  fields[n++] = {"max_free_block", (int32_t)maxBlock};
+  fields[n++] = {"heap_fragmentation", fragmentation};
+
+  // Averages over the window, the longest loop() and the longest gap between two of them
+  uint32_t nowUs = micros();
+  uint32_t windowLoopCount = loops - windowLoops;
+  fields[n++] = {"loop_period_us", windowLoopCount > 0 ? (int32_t)((nowUs - windowStartUs) / windowLoopCount) : 0};
+  fields[n++] = {"loop_period_max_us", (int32_t)maxPeriodUs};
+  fields[n++] = {"loop_busy_us", windowLoopCount > 0 ? (int32_t)(busyUs / windowLoopCount) : 0};
+  fields[n++] = {"loop_busy_max_us", (int32_t)maxBusyUs};
+  fields[n++] = {"overruns", (int32_t)scheduler.totalOverruns()};
+
+  for (uint8_t s = 0; s < HEALTH_STAGES; s++)
+  {
+    uint64_t totalUs = 0;
+    uint32_t runs = 0;
+    uint32_t peakUs = 0;
+    for (uint8_t t = 0; t < HEALTH_STAGE_TASKS && stageTasks[s][t] != nullptr; t++)
+    {
+      const Task_t *task = scheduler.findTask(stageTasks[s][t]);
+      if (task == nullptr)
+        continue;
+      totalUs += task->totalRunUs;
+      runs += task->runs;
+      peakUs = max(peakUs, task->peakRunUs);
+    }
+    uint32_t windowRuns = runs - stageRuns[s];
+    fields[n++] = {stageFields[s][0], windowRuns > 0 ? (int32_t)((totalUs - stageTotalUs[s]) / windowRuns) : 0};
+    fields[n++] = {stageFields[s][1], (int32_t)peakUs};
+    stageTotalUs[s] = totalUs;
+    stageRuns[s] = runs;
+  }
+  scheduler.clearPeaks();
+
+  // Write latency averaged over the window, the rest are totals since boot
+  uint32_t windowWrites = writes.writes - lastWrites;
+  fields[n++] = {"write_ms", windowWrites > 0 ? (int32_t)((writes.totalMs - lastWriteMs) / windowWrites) : 0};
+  fields[n++] = {"write_max_ms", (int32_t)writes.maxMs};
+  fields[n++] = {"writes", (int32_t)writes.writes};
+  fields[n++] = {"write_failures", (int32_t)writes.failures};
+  fields[n++] = {"write_retries", (int32_t)writes.retries};
+  lastWrites = writes.writes;
+  lastWriteMs = writes.totalMs;
+
+  // millis() wraps after 49 days, the points come much more often than that
+  uint32_t nowMs = millis();
+  uptimeMs += nowMs - lastCollectMs;
+  lastCollectMs = nowMs;
+  fields[n++] = {"uptime_s", (int32_t)(uptimeMs / 1000)};
+  fields[n++] = {"reset_reason", (int32_t)ESP.getResetInfoPtr()->reason};
+  // Serial lines the log ring had no room for, a non-zero count means the console missed some
+  fields[n++] = {"log_dropped", (int32_t)logger.stats().dropped};
+
+  windowStartUs = nowUs;
+  windowLoops = loops;
+  busyUs = 0;
+  maxBusyUs = 0;
+  maxPeriodUs = 0;
+  return n;
+}
@@ -0,0 +1,74 @@
+#ifndef __HEALTH_MONITOR_H__
+#define __HEALTH_MONITOR_H__
+
+#include <Arduino.h>
+#include "line_protocol.h"
+#include "scheduler.h"
+
+// Fields of one health point
+#define HEALTH_FIELDS_MAX 24
+
+// Scheduler tasks timed together as one stage
+#define HEALTH_STAGES 3
+#define HEALTH_STAGE_TASKS 3
+
+// Upload counters of whichever transport is in use, totals since boot
+typedef struct
+{
+  uint32_t writes;
+  uint32_t failures;
+  uint32_t retries;
+  uint64_t totalMs;
+  uint32_t maxMs;
+} HealthWrites_t;
+
+//
+// Self-telemetry of the device for the `airgradient_health` measurement. The hot path only keeps
+// counters: loop() marks its start and end (one micros() each) and the scheduler times every task
+// on its own. collect() turns them into the fields of one point, with averages and peaks over the
+// window since the previous point and running totals as counters.
+//
+class HealthMonitor
+{
+public:
+  HealthMonitor();
+
+  void loopStarted()
+  {
+    uint32_t now = micros();
+    if (loops > 0 && now - loopStartUs > maxPeriodUs)
+      maxPeriodUs = now - loopStartUs;
+    loopStartUs = now;
+    loops++;
+  }
+
+  void loopFinished()
+  {
+    uint32_t busy = micros() - loopStartUs;
+    busyUs += busy;
+    if (busy > maxBusyUs)
+      maxBusyUs = busy;
+  }
+
+  // Fills `fields` (HEALTH_FIELDS_MAX) and starts the next window, returns the number of fields
+  uint8_t collect(Scheduler &scheduler, const HealthWrites_t &writes, LineProtocolField_t *fields);
+
+private:
+  // Loop, since the start of the window
+  uint32_t loopStartUs;
+  uint32_t loops;
+  uint64_t busyUs;
+  uint32_t maxBusyUs;
+  uint32_t maxPeriodUs;
+
+  uint32_t windowStartUs;
+  uint32_t windowLoops;
+  uint64_t uptimeMs;
+  uint32_t lastCollectMs;
+  uint64_t stageTotalUs[HEALTH_STAGES];
+  uint32_t stageRuns[HEALTH_STAGES];
+  uint32_t lastWrites;
+  uint64_t lastWriteMs;
+};
+
+#endif //__HEALTH_MONITOR_H__
@@ -0,0 +1,168 @@
+#include "http_writer.h"
+#include "config.h"
+#include "logger.h"
+
+#include <new>
+
+#ifdef USE_IRSG_ROOT_CERT
+#include <InfluxDbCloud.h>
+
+static BearSSL::X509List rootCert(InfluxDbCloud2CACert);
+#endif
+
+// Query parameters are percent-encoded like the InfluxDB client does
+static void appendEncoded(String &url, const char *value)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  for (; *value; value++)
+  {
+    char c = *value;
+    if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~')
+    {
+      url += c;
+    }
+    else
+    {
+      url += '%';
+      url += hex[(uint8_t)c >> 4];
+      url += hex[c & 0xf];
+    }
+  }
+}
+
+HttpWriter::HttpWriter()
+    : secure(false), compress(false), deflateTables(nullptr), compressed(nullptr), lastStatusCode(0)
+{
+  memset(&writerStats, 0, sizeof(writerStats));
+}
+
+void HttpWriter::begin(const char *url, const char *org, const char *bucket, const char *token, bool compress)
+{
+  if (compress && compressed == nullptr)
+  {
+    deflateTables = new (std::nothrow) DeflateTables_t;
+    compressed = new (std::nothrow) uint8_t[GZIP_BODY_MAX];
+    if (deflateTables == nullptr || compressed == nullptr)
+    {
+      LOG_ERROR("No memory for gzip, writing uncompressed");
+      delete deflateTables;
+      delete[] compressed;
+      deflateTables = nullptr;
+      compressed = nullptr;
+      compress = false;
+    }
+  }
+  this->compress = compress;
+  healthUrl = url;
+  healthUrl += "/health";
+  writeUrl = url;
+  writeUrl += "/api/v2/write?org=";
+  appendEncoded(writeUrl, org);
+  writeUrl += "&bucket=";
+  appendEncoded(writeUrl, bucket);
+  // Records always carry second-precision timestamps
+  writeUrl += "&precision=s";
+
+  authorization = "Token ";
+  authorization += token;
+
+  secure = strncmp(url, "https:", 6) == 0;
+  if (secure)
+  {
+    // Same certificate checks as the InfluxDB client
+#ifdef USE_IRSG_ROOT_CERT
+    secureClient.setTrustAnchors(&rootCert);
+#else
+    secureClient.setInsecure();
+#endif
+    // Sessions are cached per server host
+    String host = url + 8;
+    int end = host.indexOf('/');
+    if (end >= 0)
+      host = host.substring(0, end);
+    tlsSession.begin(secureClient, host.c_str());
+  }
+
+#ifdef ENABLE_CONNECTION_REUSE
+  http.setReuse(true);
+#else
+  http.setReuse(false);
+#endif
+}
+
+bool HttpWriter::request(const String &url)
+{
+  if (secure)
+    tlsSession.beforeRequest();
+  if (!http.begin(secure ? secureClient : plainClient, url))
+  {
+    lastStatusCode = HTTPC_ERROR_CONNECTION_FAILED;
+    return false;
+  }
+  http.addHeader("Authorization", authorization);
+  return true;
+}
+
+bool HttpWriter::validate()
+{
+  if (!request(healthUrl))
+    return false;
+  lastStatusCode = http.GET();
+  http.end();
+  if (secure)
+    tlsSession.afterRequest(lastStatusCode > 0);
+  return lastStatusCode == 200 || lastStatusCode == 204;
+}
+
+bool HttpWriter::post(const char *body, size_t length)
+{
+  size_t size = 0;
+  if (compress)
+  {
+    uint32_t start = micros();
+    size = gzipCompress((const uint8_t *)body, length, compressed, GZIP_BODY_MAX, *deflateTables);
+    uint32_t elapsed = micros() - start;
+    writerStats.lastCompressUs = elapsed;
+    writerStats.maxCompressUs = max(writerStats.maxCompressUs, elapsed);
+    writerStats.totalCompressUs += elapsed;
+  }
+  writerStats.requests++;
+
+  if (!request(writeUrl))
+  {
+    writerStats.failed++;
+    return false;
+  }
+  http.addHeader("Content-Type", "text/plain; charset=utf-8");
+  if (size > 0)
+  {
+    http.addHeader("Content-Encoding", "gzip");
+    lastStatusCode = http.POST(compressed, size);
+  }
+  else
+  {
+    writerStats.uncompressed++;
+    size = length;
+    lastStatusCode = http.POST((const uint8_t *)body, length);
+  }
+  http.end();
+  if (secure)
+    tlsSession.afterRequest(lastStatusCode > 0);
+
+  if (lastStatusCode < 200 || lastStatusCode >= 300)
+  {
+    writerStats.failed++;
+    return false;
+  }
+  writerStats.rawBytes += length;
+  writerStats.sentBytes += size;
+  return true;
+}
+
+void HttpWriter::printStats(Print &out) const
+{
+  out.printf("http writer requests %u failed %u uncompressed %u raw %u B sent %u B compress last %u us max %u us avg %u us\n",
+             writerStats.requests, writerStats.failed, writerStats.uncompressed, (uint32_t)writerStats.rawBytes,
+             (uint32_t)writerStats.sentBytes, writerStats.lastCompressUs, writerStats.maxCompressUs,
+             writerStats.requests > 0 ? (uint32_t)(writerStats.totalCompressUs / writerStats.requests) : 0);
+}
@@ -0,0 +1,75 @@
+#ifndef __HTTP_WRITER_H__
+#define __HTTP_WRITER_H__
+
+#include <Arduino.h>
+#include <ESP8266HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include "gzip_deflate.h"
+#include "tls_session.h"
+
+// Room for a compressed body. The largest one is a full 2 KB batch body, 6-7 lines that `--bench-gzip`
+// compresses 2.7-2.9x to ~750 B. Four aggregated points fill it too and compress worse, down to ~2.3x, so
+// this leaves room for that; a body that compresses even worse goes out as is
+#define GZIP_BODY_MAX 896
+
+typedef struct
+{
+  uint32_t requests;
+  uint32_t failed;
+  uint32_t uncompressed;
+  uint64_t rawBytes;
+  uint64_t sentBytes;
+  uint32_t lastCompressUs;
+  uint32_t maxCompressUs;
+  uint64_t totalCompressUs;
+} HttpWriterStats_t;
+
+//
+// Posts multi-line bodies to the InfluxDB v2 write endpoint itself, bypassing the InfluxDBClient for
+// what it can't do: with `compress` the bodies go out with Content-Encoding: gzip, and over https
+// the connection resumes a cached TLS session instead of a full handshake, kept open between
+// requests with ENABLE_CONNECTION_REUSE. The InfluxDBClient's own TLS client never resumes, so over
+// https every write and the health check go through here, compressed or not, and only this one
+// BearSSL client ever connects. The deflate tables and the compressed body are only allocated, in
+// `begin()`, when compressing.
+//
+class HttpWriter
+{
+public:
+  HttpWriter();
+
+  void begin(const char *url, const char *org, const char *bucket, const char *token, bool compress);
+  bool post(const char *body, size_t length);
+  // GET /health, like InfluxDBClient::validateConnection()
+  bool validate();
+
+  int lastStatus() const { return lastStatusCode; }
+  String lastError() const
+  {
+    return String(compress ? "gzip" : "https") + " write failed with status " + String(lastStatusCode);
+  }
+
+  const HttpWriterStats_t &stats() const { return writerStats; }
+  bool isSecure() const { return secure; }
+  const TlsSession &tls() const { return tlsSession; }
+  void printStats(Print &out) const;
+
+private:
+  bool request(const String &url);
+
+  String writeUrl;
+  String healthUrl;
+  String authorization;
+  bool secure;
+  bool compress;
+  WiFiClient plainClient;
+  WiFiClientSecure secureClient;
+  TlsSession tlsSession;
+  HTTPClient http;
+  DeflateTables_t *deflateTables;
+  uint8_t *compressed;
+  int lastStatusCode;
+  HttpWriterStats_t writerStats;
+};
+
+#endif //__HTTP_WRITER_H__
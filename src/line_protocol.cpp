@@ -0,0 +1,298 @@
+#include "line_protocol.h"
+
+// Field names for the PMS5003 data words, in PmsWord order
+static const char *const pmsFields[PMS_DATA_WORDS] = {
+    "pm1.0_cf1", "pm2.5_cf1", "pm10_cf1",
+    "pm1.0", "pm2.5", "pm10",
+    "pc0.3", "pc0.5", "pc1.0", "pc2.5", "pc5.0", "pc10",
+    "pms_status"};
+
+// Window statistics per SampleChannel; integer channels keep integer min/max like their base field
+static const struct
+{
+  const char *min;
+  const char *max;
+  const char *stddev;
+  bool integer;
+} channelFields[SAMPLE_CHANNELS] = {
+    {"pm2.5_min", "pm2.5_max", "pm2.5_stddev", true},
+    {"co2_min", "co2_max", "co2_stddev", true},
+    {"temp_c_min", "temp_c_max", "temp_c_stddev", false},
+    {"humidity_min", "humidity_max", "humidity_stddev", false}};
+
+namespace
+{
+  struct Writer
+  {
+    char *buf;
+    size_t size;
+    size_t pos;
+    bool overflow;
+
+    void put(char c)
+    {
+      if (pos + 1 < size)
+        buf[pos++] = c;
+      else
+        overflow = true;
+    }
+
+    void put(const char *str)
+    {
+      while (*str)
+        put(*str++);
+    }
+
+    void putEscaped(const char *str, const char *special)
+    {
+      for (; *str; str++)
+      {
+        if (strchr(special, *str))
+          put('\\');
+        put(*str);
+      }
+    }
+
+    void putUnsigned(uint32_t value)
+    {
+      char digits[10];
+      uint8_t n = 0;
+      do
+      {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+      } while (value);
+
+      while (n)
+        put(digits[--n]);
+    }
+
+    void putInt(int32_t value)
+    {
+      if (value < 0)
+      {
+        put('-');
+        putUnsigned(-(int64_t)value);
+      }
+      else
+      {
+        putUnsigned(value);
+      }
+    }
+
+    // Fixed point value in hundredths, printed with two decimals like String(float, 2)
+    void putCenti(int32_t value)
+    {
+      if (value < 0)
+      {
+        put('-');
+        value = -value;
+      }
+      putUnsigned(value / 100);
+      put('.');
+      put('0' + (value / 10) % 10);
+      put('0' + value % 10);
+    }
+
+    // Integer field ("12i") or hundredths printed as a float field
+    void putValue(int32_t value, bool integer)
+    {
+      if (integer)
+      {
+        putInt(value);
+        put('i');
+      }
+      else
+      {
+        putCenti(value);
+      }
+    }
+  };
+}
+
+LineProtocolEncoder::LineProtocolEncoder() : prefixLen(0)
+{
+  prefixBuf[0] = '\0';
+}
+
+void LineProtocolEncoder::begin(const char *measurement)
+{
+  Writer w = {prefixBuf, sizeof(prefixBuf), 0, false};
+  w.putEscaped(measurement, ", ");
+  prefixLen = w.pos;
+  prefixBuf[prefixLen] = '\0';
+}
+
+bool LineProtocolEncoder::addTag(const char *key, const char *value)
+{
+  if (value == nullptr || *value == '\0')
+    return true;
+
+  Writer w = {prefixBuf, sizeof(prefixBuf), prefixLen, false};
+  w.put(',');
+  w.putEscaped(key, ",= ");
+  w.put('=');
+  w.putEscaped(value, ",= ");
+
+  if (w.overflow)
+  {
+    prefixBuf[prefixLen] = '\0';
+    return false;
+  }
+
+  prefixLen = w.pos;
+  prefixBuf[prefixLen] = '\0';
+  return true;
+}
+
+size_t LineProtocolEncoder::encode(const SampleRecord_t &record, char *out, size_t size) const
+{
+  Writer w = {out, size, 0, false};
+  char sep = ' ';
+
+  w.put(prefixBuf);
+
+  if (record.pms[PMS_PM25] != SAMPLE_PMS_INVALID)
+  {
+    for (uint8_t i = 0; i < PMS_DATA_WORDS; i++)
+    {
+      if (record.pms[i] == SAMPLE_PMS_INVALID)
+        continue;
+      w.put(sep);
+      w.put(pmsFields[i]);
+      w.put('=');
+      w.putUnsigned(record.pms[i]);
+      w.put('i');
+      sep = ',';
+    }
+  }
+
+  if (record.co2 != SAMPLE_CO2_INVALID)
+  {
+    w.put(sep);
+    w.put("co2=");
+    w.putInt(record.co2);
+    w.put("i,s8_status=");
+    w.putUnsigned(record.s8Status);
+    w.put('i');
+    sep = ',';
+  }
+
+  if (record.s8AbcHours != SAMPLE_ABC_INVALID)
+  {
+    w.put(sep);
+    w.put("s8_abc_hours=");
+    w.putUnsigned(record.s8AbcHours);
+    w.put('i');
+    sep = ',';
+  }
+
+  if (record.tempC != SAMPLE_TEMP_INVALID)
+  {
+    // °F in hundredths, rounded half away from zero
+    int32_t tempF = record.tempC * 9;
+    tempF = (tempF >= 0 ? tempF + 2 : tempF - 2) / 5 + 3200;
+
+    w.put(sep);
+    w.put("temp_c=");
+    w.putCenti(record.tempC);
+    w.put(",temp_f=");
+    w.putCenti(tempF);
+    sep = ',';
+  }
+
+  if (record.humidity != SAMPLE_HUMIDITY_INVALID)
+  {
+    w.put(sep);
+    w.put("humidity=");
+    w.putCenti(record.humidity);
+    sep = ',';
+  }
+
+  if (record.rssi != SAMPLE_RSSI_INVALID)
+  {
+    w.put(sep);
+    w.put("rssi=");
+    w.putInt(record.rssi);
+    w.put('i');
+    sep = ',';
+  }
+
+  // A point needs at least one field
+  if (sep == ' ')
+  {
+    if (size > 0)
+      out[0] = '\0';
+    return 0;
+  }
+
+  if (record.samples > 1)
+  {
+    bool valid[SAMPLE_CHANNELS] = {record.pms[PMS_PM25] != SAMPLE_PMS_INVALID, record.co2 != SAMPLE_CO2_INVALID,
+                                   record.tempC != SAMPLE_TEMP_INVALID, record.humidity != SAMPLE_HUMIDITY_INVALID};
+
+    w.put(",samples=");
+    w.putUnsigned(record.samples);
+    w.put('i');
+
+    for (uint8_t ch = 0; ch < SAMPLE_CHANNELS; ch++)
+    {
+      if (!valid[ch])
+        continue;
+
+      const ChannelStats_t &stats = record.stats[ch];
+      w.put(',');
+      w.put(channelFields[ch].min);
+      w.put('=');
+      w.putValue(stats.min, channelFields[ch].integer);
+      w.put(',');
+      w.put(channelFields[ch].max);
+      w.put('=');
+      w.putValue(stats.max, channelFields[ch].integer);
+      w.put(',');
+      w.put(channelFields[ch].stddev);
+      w.put('=');
+      w.putCenti(stats.stddev);
+    }
+  }
+
+  w.put(' ');
+  w.putUnsigned(record.timestamp);
+
+  if (w.overflow || size == 0)
+  {
+    if (size > 0)
+      out[0] = '\0';
+    return 0;
+  }
+
+  out[w.pos] = '\0';
+  return w.pos;
+}
+
+size_t LineProtocolEncoder::encodeFields(const LineProtocolField_t *fields, uint8_t count, uint32_t timestamp,
+                                         char *out, size_t size) const
+{
+  Writer w = {out, size, 0, false};
+  w.put(prefixBuf);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    w.put(i == 0 ? ' ' : ',');
+    w.put(fields[i].name);
+    w.put('=');
+    w.putInt(fields[i].value);
+    w.put('i');
+  }
+  w.put(' ');
+  w.putUnsigned(timestamp);
+
+  if (w.overflow || count == 0 || size == 0)
+  {
+    if (size > 0)
+      out[0] = '\0';
+    return 0;
+  }
+
+  out[w.pos] = '\0';
+  return w.pos;
+}
@@ -0,0 +1,52 @@
+#ifndef __LINE_PROTOCOL_H__
+#define __LINE_PROTOCOL_H__
+
+#include <Arduino.h>
+#include "sample_record.h"
+
+//
+// Upper bounds for the encoder buffers, the prefix holds the escaped measurement and tag set
+//
+#ifndef LINE_PROTOCOL_PREFIX_MAX
+#define LINE_PROTOCOL_PREFIX_MAX 96
+#endif
+
+#ifndef LINE_PROTOCOL_MAX
+#define LINE_PROTOCOL_MAX 640
+#endif
+
+// Integer field of a point written by encodeFields()
+typedef struct
+{
+  const char *name;
+  int32_t value;
+} LineProtocolField_t;
+
+//
+// Heap-free InfluxDB line protocol encoder for sample records. The measurement
+// and tag prefix is escaped once after the config is loaded; encoding a record
+// only appends the field set and timestamp into a caller supplied buffer.
+// Field names and types match what the Point based path used to write.
+// encode() returns 0 when the record has no valid field or doesn't fit.
+//
+class LineProtocolEncoder
+{
+public:
+  LineProtocolEncoder();
+
+  void begin(const char *measurement);
+  bool addTag(const char *key, const char *value);
+
+  size_t encode(const SampleRecord_t &record, char *out, size_t size) const;
+  // A point of `count` integer fields, for measurements other than the samples
+  size_t encodeFields(const LineProtocolField_t *fields, uint8_t count, uint32_t timestamp, char *out,
+                      size_t size) const;
+
+  const char *prefix() const { return prefixBuf; }
+
+private:
+  char prefixBuf[LINE_PROTOCOL_PREFIX_MAX];
+  size_t prefixLen;
+};
+
+#endif //__LINE_PROTOCOL_H__
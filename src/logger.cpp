@@ -0,0 +1,123 @@
+#include "logger.h"
+
+Logger logger;
+
+static const char levelTags[] = {' ', 'E', 'W', 'I', 'D'};
+
+Logger::Logger() : serial(nullptr), head(0), count(0), droppedSinceNote(0)
+{
+  memset(&loggerStats, 0, sizeof(loggerStats));
+}
+
+void Logger::begin(HardwareSerial *serial)
+{
+  this->serial = serial;
+}
+
+void Logger::log(uint8_t level, const char *format, ...)
+{
+  // One line at a time, formatted here so the ring only ever holds whole messages
+  static char line[LOG_LINE_MAX];
+  line[0] = levelTags[level < sizeof(levelTags) ? level : 0];
+  line[1] = ' ';
+
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line + 2, sizeof(line) - 4, format, args);
+  va_end(args);
+  if (length < 0)
+    return;
+
+  size_t end = 2 + min((size_t)length, sizeof(line) - 5);
+  line[end++] = '\r';
+  line[end++] = '\n';
+  loggerStats.messages++;
+  push(line, end);
+}
+
+size_t Logger::write(uint8_t c)
+{
+  return push((const char *)&c, 1) ? 1 : 0;
+}
+
+size_t Logger::write(const uint8_t *buffer, size_t size)
+{
+  return push((const char *)buffer, size) ? size : 0;
+}
+
+bool Logger::push(const char *data, size_t size)
+{
+  char note[40];
+  size_t noteLength = 0;
+  if (droppedSinceNote > 0)
+    noteLength = snprintf(note, sizeof(note), "W log dropped %u messages\r\n", droppedSinceNote);
+
+  if (noteLength + size > (size_t)(LOG_BUFFER_SIZE - count))
+  {
+    droppedSinceNote++;
+    loggerStats.dropped++;
+    loggerStats.droppedBytes += size;
+    return false;
+  }
+
+  droppedSinceNote = 0;
+  append(note, noteLength);
+  append(data, size);
+  if (count > loggerStats.maxPending)
+    loggerStats.maxPending = count;
+  return true;
+}
+
+void Logger::append(const char *data, size_t size)
+{
+  while (size > 0)
+  {
+    size_t chunk = min(size, (size_t)(LOG_BUFFER_SIZE - head));
+    memcpy(ring + head, data, chunk);
+    head = (head + chunk) % LOG_BUFFER_SIZE;
+    count += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+}
+
+void Logger::drain()
+{
+  if (serial == nullptr || count == 0)
+    return;
+
+  int room = serial->availableForWrite();
+  while (room > 0 && count > 0)
+  {
+    uint16_t tail = (head + LOG_BUFFER_SIZE - count) % LOG_BUFFER_SIZE;
+    size_t chunk = min(min((size_t)room, (size_t)count), (size_t)(LOG_BUFFER_SIZE - tail));
+    serial->write((const uint8_t *)ring + tail, chunk);
+    count -= chunk;
+    room -= chunk;
+    loggerStats.bytesOut += chunk;
+  }
+}
+
+void Logger::flush()
+{
+  if (serial == nullptr)
+    return;
+
+  // Blocking writes, the UART takes the rest as fast as it sends
+  while (count > 0)
+  {
+    uint16_t tail = (head + LOG_BUFFER_SIZE - count) % LOG_BUFFER_SIZE;
+    size_t chunk = min((size_t)count, (size_t)(LOG_BUFFER_SIZE - tail));
+    serial->write((const uint8_t *)ring + tail, chunk);
+    count -= chunk;
+    loggerStats.bytesOut += chunk;
+  }
+  serial->flush();
+}
+
+void Logger::printStats(Print &out) const
+{
+  out.printf("log messages %u dropped %u (%u B) pending %u B max %u B out %u B\n", loggerStats.messages,
+             loggerStats.dropped, loggerStats.droppedBytes, count, loggerStats.maxPending,
+             (uint32_t)loggerStats.bytesOut);
+}
@@ -0,0 +1,86 @@
+#ifndef __LOGGER_H__
+#define __LOGGER_H__
+
+#include <Arduino.h>
+#include "config.h"
+
+typedef struct
+{
+  uint32_t messages;
+  uint32_t dropped;
+  uint32_t droppedBytes;
+  uint16_t maxPending;
+  uint64_t bytesOut;
+} LoggerStats_t;
+
+//
+// Serial log that never waits for the UART. Messages are formatted into a LOG_BUFFER_SIZE ring and
+// drain() hands the UART only what its TX FIFO has room for, once per loop(), so printing costs the
+// formatting and not the ~87 us per byte the line takes at 115200 baud. A message that doesn't fit the
+// ring is dropped whole and counted; the next one that fits is preceded by a note of how many went.
+//
+// The LOG_* macros below compile to nothing above LOG_LEVEL, format strings and arguments included.
+// As a Print the logger takes the printStats() of the other modules, each write() kept or dropped whole.
+//
+class Logger : public Print
+{
+public:
+  Logger();
+
+  void begin(HardwareSerial *serial);
+  void log(uint8_t level, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+
+  // Moves what the TX FIFO takes right now, never blocks
+  void drain();
+  // Waits until the ring is out, before deep sleep or a restart
+  void flush();
+
+  uint16_t pending() const { return count; }
+  const LoggerStats_t &stats() const { return loggerStats; }
+  void printStats(Print &out) const;
+
+private:
+  bool push(const char *data, size_t size);
+  void append(const char *data, size_t size);
+
+  HardwareSerial *serial;
+  char ring[LOG_BUFFER_SIZE];
+  uint16_t head;
+  uint16_t count;
+  uint32_t droppedSinceNote;
+  LoggerStats_t loggerStats;
+};
+
+extern Logger logger;
+
+#define LOG_ENABLED(level) (LOG_LEVEL >= (level))
+
+#if LOG_ENABLED(LOG_LEVEL_ERROR)
+#define LOG_ERROR(...) logger.log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#if LOG_ENABLED(LOG_LEVEL_WARN)
+#define LOG_WARN(...) logger.log(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_ENABLED(LOG_LEVEL_INFO)
+#define LOG_INFO(...) logger.log(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_ENABLED(LOG_LEVEL_DEBUG)
+#define LOG_DEBUG(...) logger.log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#endif //__LOGGER_H__
@@ -28,8 +28,34 @@
  **/
 
 #include "config.h"
+#include "scheduler.h"
+#include "batch_writer.h"
+#include "offline_log.h"
+#include "sample_record.h"
+#include "line_protocol.h"
+#include "pms_parser.h"
+#include "s8_modbus.h"
+#include "aggregator.h"
+#include "display_renderer.h"
+#include "dashboard.h"
+#include "config_snapshot.h"
+#include "boot_sequence.h"
+#include "wifi_connector.h"
+#include "rtc_log.h"
+#include "radio_power.h"
+#include "http_writer.h"
+#include "udp_writer.h"
+#include "mqtt_publisher.h"
+#include "metrics_server.h"
+#include "health_monitor.h"
+#include "arena.h"
+#include "logger.h"
+#include "trace.h"
+#include "alloc_tracker.h"
 
+#include <new>
 #include <string.h>
+#include <sys/time.h>
 #include <Arduino.h>
 #include <AirGradient.h>
 #include <WiFiManager.h>
@@ -38,6 +64,7 @@
 #include <ArduinoJson.h>
 
 #include <Wire.h>
+#include <SoftwareSerial.h>
 
 #if defined(U8G2_BOTTOM) || defined(U8G2_TOP)
 #include <U8g2lib.h>
@@ -55,6 +82,10 @@ WiFiMulti wifiMulti;
 #include <ESP8266WiFiMulti.h>
 ESP8266WiFiMulti wifiMulti;
 #define DEVICE "ESP8266"
+#elif defined(NATIVE)
+#include <ESP8266WiFiMulti.h>
+ESP8266WiFiMulti wifiMulti;
+#define DEVICE "native"
 #endif
 
 #include <InfluxDbClient.h>
@@ -74,12 +105,21 @@ ESP8266WiFiMulti wifiMulti;
 
 AirGradient ag = AirGradient();
 
+SoftwareSerial pmsSerial;
+PmsParser pmsParser;
+
+SoftwareSerial co2Serial;
+S8Modbus s8;
+uint32_t lastAbcReadMs = 0;
+
 #if defined(U8G2_BOTTOM)
 // Display bottom right
 U8G2_SH1106_128X64_NONAME_F_HW_I2C display(U8G2_R0, /* reset=*/U8X8_PIN_NONE);
+#define DISPLAY_FLIPPED false
 #elif defined(U8G2_TOP)
 // Replace above if you have display on top left
 U8G2_SH1106_128X64_NONAME_F_HW_I2C display(U8G2_R2, /* reset=*/U8X8_PIN_NONE);
+#define DISPLAY_FLIPPED true
 #else
 SSD1306Wire display(0x3c, SDA, SCL);
 #endif
@@ -89,7 +129,8 @@ boolean hasPM = true;
 boolean hasCO2 = true;
 boolean hasSHT = true;
 
-Point sensor("airgradient");
+LineProtocolEncoder encoder;
+LineProtocolEncoder healthEncoder;
 
 // set to true if you want to connect to wifi. The display will show values only when the sensor has wifi connection
 boolean connectWIFI = true;
@@ -98,132 +139,1067 @@ typedef struct
 {
   char deviceName[32];
   int sampleDelay;
+  uint32_t aggregateWindow;
+  uint8_t displayMode;
+  uint8_t sleepMode;
+  uint16_t deepSleepFlushEvery;
+  uint16_t batchSize;
+  uint16_t bufferSize;
+  uint16_t flushInterval;
+  bool gzip;
+  // HTTP writes go through the HttpWriter: compressed, or over https where it holds the TLS session
+  bool directHttp;
+  uint8_t transport;
+  uint16_t metricsPort;
+  uint16_t healthInterval;
 } DeviceConfig_t;
 
+typedef struct
+{
+  uint16_t pms[PMS_DATA_WORDS];
+  int co2;
+  uint16_t s8Status;
+  uint16_t s8AbcHours;
+  float tempC;
+  float humidity;
+  bool pmValid;
+  bool co2Valid;
+  bool shtValid;
+} SensorReadings_t;
+
 void connectToWifi();
 bool loadConfig();
-void showTextRectangle(String ln1, String ln2, boolean small);
+bool parseConfig(ConfigSnapshot_t &config);
+void applyConfig(const ConfigSnapshot_t &config);
+void showTextRectangle(const char *ln1, const char *ln2, boolean small);
+void captureSample(SampleRecord_t &record);
+
+void pollSensors();
+void pmTask();
+void co2Task();
+void pollS8();
+void shtTask();
+void displayTask();
+void networkTask();
+void housekeepingTask();
+void flushTask();
+void drainTask();
+void radioTask();
+void radioIdle();
+void mqttTask();
+void healthTask();
+
+void startSensors();
+bool sensorsReady(uint32_t elapsedMs);
+void startSampling();
+void startWifi();
+bool wifiReady(uint32_t elapsedMs);
+void startTimeSync();
+bool timeReady(uint32_t elapsedMs);
+void validateInflux();
+bool clockValid();
+void uploadSample(SampleRecord_t &record);
+void mirrorPending(const SampleRecord_t &record, uint32_t droppedBefore);
+void releasePending(uint16_t count, bool spill);
+size_t encodeBatch(const SampleRecord_t *records, uint16_t count, char *body, size_t size, uint16_t *taken);
+bool sendBody(const char *body);
+bool sendRecords(const SampleRecord_t *records, uint16_t count, uint16_t *sent);
+bool uploadDue(uint32_t atMs, uint16_t newRecords);
+const char *writeError();
+void writeHealth();
+HealthWrites_t writeStats();
+void deepSleepCycle();
+void flushRtcLog(bool coldBoot);
 
 // InfluxDB client instance with preconfigured InfluxCloud certificate
 InfluxDBClient client = InfluxDBClient();
+BatchWriter batchWriter;
+HttpWriter httpWriter;
+UdpWriter udpWriter;
+MqttPublisher mqttPublisher;
+MetricsServer metricsServer;
+HealthMonitor health;
+OfflineLog offlineLog;
+SampleAggregator aggregator;
+
+// Samples of the points pending in the batch writer, oldest first. Those it drops to make room go to the
+// offline log, the others stay with the writer and are retried from there. Allocated in setup() for the
+// transports that batch
+SampleRecord_t *pendingSamples = nullptr;
+uint16_t pendingSampleCount = 0;
+static_assert(LINE_PROTOCOL_MAX < BATCH_BODY_MAX, "Every line must fit the batch body for the mirror to stay in step");
+
+SampleRecord_t drainRecords[OFFLINE_DRAIN_BATCH];
+uint16_t drainPositions[OFFLINE_DRAIN_BATCH];
+// A batch replayed over MQTT leaves the offline log once the broker acknowledged all of it
+bool replayPending = false;
+uint32_t replayMark = 0;
+uint16_t replayScanned = 0;
+uint16_t replayCount = 0;
+uint32_t replayStartMs = 0;
+
+// Samples taken before NTP set the clock, stamped with uptime until they can be dated
+SampleRecord_t unsyncedSamples[UNSYNCED_SAMPLES_MAX];
+uint8_t unsyncedSampleCount = 0;
+
+// Per-sample temporaries (encoded lines, error texts) only live until the end of the loop() cycle,
+// when the arena is reset
+static_assert(CYCLE_ARENA_SIZE >= LINE_PROTOCOL_MAX + 128, "CYCLE_ARENA_SIZE can't hold a line and its error text");
+uint8_t cycleArenaBuffer[CYCLE_ARENA_SIZE] __attribute__((aligned(4)));
+Arena cycleArena(cycleArenaBuffer, sizeof(cycleArenaBuffer));
+// Last health point, waiting for the radio in modem sleep; allocated in setup() when health is reported
+char *healthLine = nullptr;
+bool healthPending = false;
 
 DeviceConfig_t deviceConfig;
+SensorReadings_t readings;
+
+Scheduler scheduler;
+BootSequence boot;
+WifiConnector wifiConnector;
+DisplayRenderer renderer;
+Dashboard dashboard;
+uint8_t displayLines[2];
+uint8_t displayPage = 0;
+RtcLog rtcLog;
+RadioPower radio;
+Task_t *uploadTask = nullptr;
+Task_t *replayTask = nullptr;
 
 void setup()
 {
+  ALLOC_TAG("setup");
   Serial.begin(115200);
+  logger.begin(&Serial);
 
   // display.init();
   display.begin();
+  renderer.begin(&display, DISPLAY_FLIPPED);
+  displayLines[0] = renderer.addField(1, 10, u8g2_font_t0_16_tf);
+  displayLines[1] = renderer.addField(1, 30, u8g2_font_t0_16_tf);
 
   if (!LittleFS.begin())
   {
-    Serial.println("LittleFS Mount Failed");
+    LOG_ERROR("LittleFS Mount Failed");
     return;
   }
 
-  String deviceId(ESP.getChipId(), HEX);
+  offlineLog.begin();
+
+  char deviceId[9];
+  snprintf(deviceId, sizeof(deviceId), "%x", ESP.getChipId());
   showTextRectangle("Init", deviceId, true);
 
+  // Config comes from flash only, load it before networking so a slow connect doesn't delay it
+  LOG_INFO("Loading config");
+  loadConfig();
+
+  encoder.begin("airgradient");
+  encoder.addTag("device", DEVICE);
+  encoder.addTag("id", deviceId);
+  if (!encoder.addTag("deviceName", deviceConfig.deviceName))
+    LOG_WARN("Device name too long for the line protocol prefix");
+  healthEncoder.begin("airgradient_health");
+  healthEncoder.addTag("device", DEVICE);
+  healthEncoder.addTag("id", deviceId);
+  healthEncoder.addTag("deviceName", deviceConfig.deviceName);
+
+  if (deviceConfig.sleepMode == SLEEP_MODE_DEEP)
+  {
+    // Sample once and go back to sleep, the next wake starts over with a reset
+    deepSleepCycle();
+    return;
+  }
+
+  radio.begin(deviceConfig.sleepMode == SLEEP_MODE_MODEM);
+  metricsServer.begin(deviceConfig.metricsPort, deviceId, deviceConfig.deviceName);
+  if (deviceConfig.transport != TRANSPORT_MQTT)
+  {
+    pendingSamples = new (std::nothrow) SampleRecord_t[OFFLINE_PENDING_MAX];
+    if (pendingSamples == nullptr)
+      LOG_ERROR("No memory to mirror pending samples, points dropped during an outage are lost");
+  }
+
+  // Sensor warm-up and the network bring-up overlap, sampling starts as soon as the sensors answer
+  uint8_t sensors = boot.addStage("sensors", 0, startSensors, sensorsReady, SENSOR_WARMUP_MS);
+  boot.addStage("sampling", BOOT_AFTER(sensors), startSampling, nullptr);
+  uint8_t wifi = boot.addStage("wifi", 0, startWifi, wifiReady);
+  uint8_t ntp = boot.addStage("ntp", BOOT_AFTER(wifi), startTimeSync, timeReady, NTP_SYNC_TIMEOUT_MS);
+  boot.addStage("influx", BOOT_AFTER(wifi) | BOOT_AFTER(ntp), validateInflux, nullptr);
+
+  if (deviceConfig.displayMode == DISPLAY_MODE_DASHBOARD)
+  {
+    dashboard.begin(&renderer);
+    scheduler.addTask("display", displayTask, DISPLAY_REFRESH_MS, 3 * SENSOR_STAGGER_MS);
+  }
+  else
+  {
+    scheduler.addTask("display", displayTask, DISPLAY_PAGE_MS, 3 * SENSOR_STAGGER_MS);
+  }
+  scheduler.addTask("house", housekeepingTask, HOUSEKEEPING_MS, HOUSEKEEPING_MS);
+  if (deviceConfig.transport != TRANSPORT_MQTT && deviceConfig.flushInterval > 0)
+    scheduler.addTask("flush", flushTask, BATCH_FLUSH_CHECK_MS, BATCH_FLUSH_CHECK_MS);
+  replayTask = scheduler.addTask("drain", drainTask, OFFLINE_DRAIN_MS, OFFLINE_DRAIN_MS);
+  if (radio.modemSleep())
+    scheduler.addTask("radio", radioTask, RADIO_CHECK_MS, RADIO_CHECK_MS);
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+    scheduler.addTask("mqtt", mqttTask, MQTT_POLL_MS, 0);
+  if (deviceConfig.healthInterval > 0)
+  {
+    healthLine = new (std::nothrow) char[LINE_PROTOCOL_MAX];
+    if (healthLine == nullptr)
+      LOG_ERROR("No memory for the health point, not reporting health");
+    else
+      scheduler.addTask("health", healthTask, deviceConfig.healthInterval * 1000ul,
+                        deviceConfig.healthInterval * 1000ul);
+  }
+}
+
+void loop()
+{
+  ALLOC_TAG("loop");
+  ALLOC_LOOP_STARTED();
+  health.loopStarted();
+  boot.run();
+  pollSensors();
+  metricsServer.poll();
+  scheduler.run();
+  cycleArena.reset();
+  logger.drain();
+#if TRACE_ENABLED
+  // A 't' from the serial monitor dumps the trace, the log goes out first so the two don't mix
+  if (Serial.available() > 0 && Serial.read() == 't')
+  {
+    logger.flush();
+    trace.dump(Serial);
+  }
+#endif
+  ALLOC_LOOP_FINISHED(boot.finished());
+  health.loopFinished();
+}
+
+void pollSensors()
+{
   if (hasPM)
-    ag.PMS_Init();
+  {
+    if (pmsSerial.overflow())
+      pmsParser.countOverflow();
+    pmsParser.poll(pmsSerial);
+  }
+
   if (hasCO2)
-    ag.CO2_Init();
+    pollS8();
+}
+
+void startSensors()
+{
+  if (hasPM)
+  {
+    pmsSerial.begin(PMS_BAUD, SWSERIAL_8N1, PMS_RX_PIN, PMS_TX_PIN, false, PMS_RX_BUFFER);
+    pmsParser.setActiveMode(pmsSerial);
+  }
+  if (hasCO2)
+  {
+    co2Serial.begin(S8_BAUD, SWSERIAL_8N1, CO2_RX_PIN, CO2_TX_PIN, false);
+    s8.begin(&co2Serial, S8_TIMEOUT_MS, S8_RETRIES);
+    readings.s8AbcHours = SAMPLE_ABC_INVALID;
+  }
   if (hasSHT)
     ag.TMP_RH_Init(0x44);
+}
 
-  if (connectWIFI)
+bool sensorsReady(uint32_t /*elapsedMs*/)
+{
+  // The PMS streams once its fan is up to speed, the S8 is asked until it gives a reading
+  bool pmReady = !hasPM || pmsParser.hasFrame(PMS_STALE_MS);
+  if (hasCO2 && !readings.co2Valid && !s8.busy())
+    s8.request(S8_READ_INPUT, S8_IR_METER_STATUS, 4);
+  return pmReady && (!hasCO2 || readings.co2Valid);
+}
+
+void startSampling()
+{
+  // Stagger the sensor reads ahead of the upload so every point carries fresh values
+  uint32_t period = deviceConfig.sampleDelay > 0 ? deviceConfig.sampleDelay : DEFAULT_SAMPLE_DELAY_MS;
+  if (hasPM)
+    scheduler.addTask("pm", pmTask, period, 0);
+  if (hasCO2)
+    scheduler.addTask("co2", co2Task, period, SENSOR_STAGGER_MS);
+  if (hasSHT)
+    scheduler.addTask("sht", shtTask, period, 2 * SENSOR_STAGGER_MS);
+  uploadTask = scheduler.addTask("network", networkTask, period, 3 * SENSOR_STAGGER_MS);
+}
+
+void startWifi()
+{
+  if (!connectWIFI)
+    return;
+
+  // Join the network WiFiManager saved last time without blocking, the portal is only the fallback
+  wifiConnector.begin(WIFI_FAST_CONNECT_MS, WIFI_CONNECT_TIMEOUT_MS);
+}
+
+bool wifiReady(uint32_t /*elapsedMs*/)
+{
+  if (!connectWIFI || wifiConnector.poll())
+    return true;
+
+  if (wifiConnector.failed())
+  {
+    LOG_WARN("No saved WiFi network reachable, starting the config portal");
     connectToWifi();
-  delay(2000);
+    wifiConnector.connected();
+    return true;
+  }
+  return false;
+}
 
-  Serial.println("Synchronizing time with NTP Servers");
-  timeSync(TZ_INFO, "pool.ntp.org", "time.nis.gov", "time-a-g.nist.gov");
+void startTimeSync()
+{
+  // SNTP runs in the background, samples are held until the clock is set
+  LOG_INFO("Synchronizing time with NTP Servers");
+#if defined(ESP32)
+  configTzTime(TZ_INFO, "pool.ntp.org", "time.nis.gov", "time-a-g.nist.gov");
+#else
+  configTime(TZ_INFO, "pool.ntp.org", "time.nis.gov", "time-a-g.nist.gov");
+#endif
+}
 
-  Serial.println("Loading config from json file");
-  loadConfig();
+bool timeReady(uint32_t /*elapsedMs*/)
+{
+  return clockValid();
+}
 
-  // Set the config after load
-  sensor.addTag("device", DEVICE);
-  sensor.addTag("id", deviceId);
-  sensor.addTag("deviceName", deviceConfig.deviceName);
+bool clockValid()
+{
+  return time(nullptr) >= CLOCK_VALID_EPOCH;
+}
+
+void validateInflux()
+{
+  if (deviceConfig.transport == TRANSPORT_UDP)
+  {
+    // Nothing answers over UDP
+    LOG_INFO("Sending line protocol over UDP to %s", client.getServerUrl().c_str());
+    return;
+  }
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+  {
+    // The publisher connects to the broker on its own
+    LOG_INFO("Publishing to MQTT");
+    return;
+  }
 
   // Check server connection
-  if (client.validateConnection())
+  if (deviceConfig.directHttp ? httpWriter.validate() : client.validateConnection())
+  {
+    LOG_INFO("Connected to InfluxDB: %s", client.getServerUrl().c_str());
+  }
+  else if (deviceConfig.directHttp)
   {
-    Serial.print("Connected to InfluxDB: ");
-    Serial.println(client.getServerUrl());
+    LOG_ERROR("InfluxDB connection failed: health check status %d", httpWriter.lastStatus());
   }
   else
   {
-    Serial.print("InfluxDB connection failed: ");
-    Serial.println(client.getLastErrorMessage());
+    LOG_ERROR("InfluxDB connection failed: %s", client.getLastErrorMessage().c_str());
   }
 }
 
-void loop()
+void pmTask()
 {
-  sensor.clearFields();
+  TRACE_SCOPE(TRACE_PM);
+  // The PMS streams a frame every second or so, sample the latest one
+  readings.pmValid = pmsParser.hasFrame(PMS_STALE_MS);
+  if (readings.pmValid)
+    memcpy(readings.pms, pmsParser.words(), sizeof(readings.pms));
+}
 
-  if (hasPM)
+void co2Task()
+{
+  TRACE_SCOPE(TRACE_CO2);
+  // The reply is picked up by pollS8(), long before the upload of this period
+  if (!s8.request(S8_READ_INPUT, S8_IR_METER_STATUS, 4))
+    LOG_DEBUG("S8 still busy, skipping CO2 read");
+}
+
+void pollS8()
+{
+  S8State_t state = s8.poll();
+  if (state == S8_WAITING || state == S8_IDLE)
+    return;
+
+  bool inputRead = s8.function() == S8_READ_INPUT;
+  if (state == S8_DONE && inputRead)
+  {
+    int CO2 = s8.reg(S8_IR_SPACE_CO2 - S8_IR_METER_STATUS);
+    readings.s8Status = s8.reg(0);
+    readings.co2Valid = CO2 > 0;
+    if (readings.co2Valid)
+      readings.co2 = CO2;
+  }
+  else if (state == S8_DONE)
+  {
+    readings.s8AbcHours = s8.reg(0);
+    lastAbcReadMs = millis();
+  }
+  else if (inputRead)
   {
-    int PM2 = ag.getPM2_Raw();
-    if (PM2 >= 0) {
-      sensor.addField("pm2.5", PM2);
-      showTextRectangle("PM2", String(PM2), false);
+    readings.co2Valid = false;
+  }
+  s8.acknowledge();
+
+  // Chain the occasional ABC period read onto a finished CO2 read
+  if (inputRead && (readings.s8AbcHours == SAMPLE_ABC_INVALID || millis() - lastAbcReadMs >= S8_ABC_REFRESH_MS))
+    s8.request(S8_READ_HOLDING, S8_HR_ABC_PERIOD, 1);
+}
+
+void shtTask()
+{
+  TRACE_SCOPE(TRACE_SHT);
+  TMP_RH result = ag.periodicFetchData();
+  readings.tempC = result.t;
+  readings.humidity = result.rh;
+  readings.shtValid = true;
+}
+
+void displayTask()
+{
+  TRACE_SCOPE(TRACE_DISPLAY);
+  if (deviceConfig.displayMode == DISPLAY_MODE_DASHBOARD)
+  {
+    // Everything on one screen, only cells whose reading changed are redrawn
+    SampleRecord_t record = {};
+    captureSample(record);
+    dashboard.update(record, offlineLog.size());
+    renderer.render();
+    return;
+  }
+
+  char ln1[DISPLAY_FIELD_CHARS];
+  char ln2[DISPLAY_FIELD_CHARS];
+
+  // Rotate through the enabled sensors, one page per tick
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    uint8_t page = displayPage;
+    displayPage = (displayPage + 1) % 3;
+
+    if (page == 0 && hasPM)
+    {
+      if (readings.pmValid)
+        snprintf(ln2, sizeof(ln2), "%u", readings.pms[PMS_PM25]);
+      showTextRectangle("PM2", readings.pmValid ? ln2 : "error", false);
+      return;
     }
-    else {
-      showTextRectangle("PM2", "error", false);
+    if (page == 1 && hasCO2)
+    {
+      if (readings.co2Valid)
+        snprintf(ln2, sizeof(ln2), "%d", readings.co2);
+      showTextRectangle("CO2", readings.co2Valid ? ln2 : "error", false);
+      return;
     }
-    
-    delay(3000);
+    if (page == 2 && hasSHT && readings.shtValid)
+    {
+      float temp_f = (readings.tempC * 1.8f) + 32;
+      snprintf(ln1, sizeof(ln1), "%.2f", temp_f);
+      snprintf(ln2, sizeof(ln2), "%.2f%%", readings.humidity);
+      showTextRectangle(ln1, ln2, false);
+      return;
+    }
+  }
+}
+
+void captureSample(SampleRecord_t &record)
+{
+  // Uptime until NTP has set the clock, networkTask() dates those samples later
+  record.timestamp = clockValid() ? time(nullptr) : millis() / 1000;
+  if (hasPM && readings.pmValid)
+    memcpy(record.pms, readings.pms, sizeof(record.pms));
+  else
+    record.pms[PMS_PM25] = SAMPLE_PMS_INVALID;
+  record.co2 = hasCO2 && readings.co2Valid ? readings.co2 : SAMPLE_CO2_INVALID;
+  record.s8Status = readings.s8Status;
+  record.s8AbcHours = hasCO2 ? readings.s8AbcHours : SAMPLE_ABC_INVALID;
+  record.tempC = hasSHT && readings.shtValid ? (int16_t)lroundf(readings.tempC * 100) : SAMPLE_TEMP_INVALID;
+  record.humidity = hasSHT && readings.shtValid ? (uint16_t)lroundf(readings.humidity * 100) : SAMPLE_HUMIDITY_INVALID;
+  record.rssi = WiFi.isConnected() ? WiFi.RSSI() : SAMPLE_RSSI_INVALID;
+  record.samples = 1;
+  sampleRecordSeal(record);
+}
+
+void networkTask()
+{
+  SampleRecord_t record = {};
+  captureSample(record);
+  metricsServer.update(record);
+
+  // Upload one summary per aggregation window
+  aggregator.add(record);
+  if (!aggregator.ready())
+    return;
+  aggregator.summarize(record);
+
+  bool unsynced = record.timestamp < CLOCK_VALID_EPOCH;
+  if (unsynced)
+  {
+    // Hold the sample until NTP dates it, dropping the oldest if the sync takes very long
+    if (unsyncedSampleCount == UNSYNCED_SAMPLES_MAX)
+    {
+      memmove(unsyncedSamples, unsyncedSamples + 1, (UNSYNCED_SAMPLES_MAX - 1) * sizeof(SampleRecord_t));
+      unsyncedSampleCount--;
+    }
+    unsyncedSamples[unsyncedSampleCount++] = record;
   }
+  if (!clockValid())
+    return;
 
-  if (hasCO2)
+  if (unsyncedSampleCount > 0)
   {
-    int CO2 = ag.getCO2_Raw();
-    if (CO2 > 0) {
-      sensor.addField("co2", CO2);
-      showTextRectangle("CO2", String(CO2), false);
+    // Their timestamps are uptime seconds, turn them into wall clock time
+    uint32_t uptime = millis() / 1000;
+    time_t now = time(nullptr);
+    size_t mark = cycleArena.mark();
+    for (uint8_t i = 0; i < unsyncedSampleCount; i++)
+    {
+      unsyncedSamples[i].timestamp = now - (uptime - unsyncedSamples[i].timestamp);
+      sampleRecordSeal(unsyncedSamples[i]);
+      uploadSample(unsyncedSamples[i]);
+      cycleArena.rewind(mark);
     }
-    else {
-      showTextRectangle("CO2", "error", false);
+    unsyncedSampleCount = 0;
+  }
+
+  if (!unsynced)
+    uploadSample(record);
+  radioIdle();
+}
+
+void uploadSample(SampleRecord_t &record)
+{
+  // The health point goes with the batch the radio is on for
+  if (healthPending && radio.awake())
+    writeHealth();
+
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+  {
+    // The publisher holds the record until the broker acknowledges it, or refuses it when all its
+    // messages are waiting for that
+    if (!mqttPublisher.add(record))
+    {
+      LOG_WARN("MQTT messages all waiting, record kept offline");
+      offlineLog.append(&record, 1);
     }
-    delay(3000);
+    return;
+  }
+
+  // If no Wifi signal, try to reconnect it, unless the radio is in modem sleep on purpose
+  if (radio.awake() && wifiMulti.run() != WL_CONNECTED)
+  {
+    LOG_WARN("Wifi connection lost");
+  }
+
+  // Write record, the batch writer sends it once the batch is full or old enough
+  char *line = (char *)cycleArena.alloc(LINE_PROTOCOL_MAX);
+  if (line == nullptr || encoder.encode(record, line, LINE_PROTOCOL_MAX) == 0)
+  {
+    LOG_WARN("Line protocol buffer too small");
+    return;
+  }
+  uint32_t dropped = batchWriter.stats().droppedPoints;
+  bool written = batchWriter.write(line);
+  mirrorPending(record, dropped);
+  if (!written)
+    LOG_WARN("InfluxDB write failed: %s", writeError());
+}
+
+void mirrorPending(const SampleRecord_t &record, uint32_t droppedBefore)
+{
+  if (pendingSamples == nullptr)
+    return;
+  if (pendingSampleCount == OFFLINE_PENDING_MAX)
+  {
+    // More points pending than we can mirror in RAM, persist the oldest sample now
+    releasePending(1, true);
+  }
+  pendingSamples[pendingSampleCount++] = record;
+
+  // The writer drops its oldest points to make room, their samples are kept in the offline log instead.
+  // Older ones than the writer still holds went out with a batch
+  uint32_t dropped = batchWriter.stats().droppedPoints - droppedBefore;
+  releasePending(min<uint32_t>(dropped, pendingSampleCount), true);
+  if (pendingSampleCount > batchWriter.pending())
+    releasePending(pendingSampleCount - batchWriter.pending(), false);
+}
+
+void releasePending(uint16_t count, bool spill)
+{
+  if (spill)
+  {
+    // Health points are mirrored as empty records, only the samples are worth keeping
+    uint16_t samples = 0;
+    for (uint16_t i = 0; i < count; i++)
+    {
+      if (pendingSamples[i].timestamp != 0)
+        pendingSamples[samples++] = pendingSamples[i];
+    }
+    offlineLog.append(pendingSamples, samples);
+  }
+  memmove(pendingSamples, pendingSamples + count, (pendingSampleCount - count) * sizeof(SampleRecord_t));
+  pendingSampleCount -= count;
+}
+
+void drainTask()
+{
+  if (replayPending)
+  {
+    if (!mqttPublisher.acknowledged(replayMark))
+      return;
+    offlineLog.consume(replayScanned, replayCount, millis() - replayStartMs);
+    replayPending = false;
+    radioIdle();
+  }
+
+  // Only replay once live writes are going through again
+  if (offlineLog.size() == 0 || batchWriter.pending() > 0 || WiFi.status() != WL_CONNECTED)
+    return;
+  if (deviceConfig.transport == TRANSPORT_MQTT && !(mqttPublisher.connected() && mqttPublisher.idle()))
+    return;
+
+  uint16_t scanned;
+  uint16_t count = offlineLog.read(drainRecords, OFFLINE_DRAIN_BATCH, &scanned, drainPositions);
+
+  uint32_t start = millis();
+  uint16_t sent;
+  if (!sendRecords(drainRecords, count, &sent))
+  {
+    LOG_WARN("Offline log replay failed: %s", writeError());
+    return;
+  }
+  // Records that didn't fit the body are read again for the next batch
+  if (sent < count)
+    scanned = drainPositions[sent];
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+  {
+    // Queued isn't delivered, the records stay in the log until their PUBACK
+    replayPending = true;
+    replayMark = mqttPublisher.mark();
+    replayScanned = scanned;
+    replayCount = count;
+    replayStartMs = start;
+    return;
   }
 
+  offlineLog.consume(scanned, sent, millis() - start);
+  // The backlog goes out back to back, the tasks that are due still run in between
+  if (offlineLog.size() > 0)
+    scheduler.runNow(replayTask);
+  radioIdle();
+}
+
+void radioTask()
+{
+  // The boot sequence owns the radio until WiFi, NTP and InfluxDB are up
+  if (!boot.finished() || uploadTask == nullptr)
+    return;
+
+  if (radio.awake())
+  {
+    if (!wifiConnector.poll() && wifiConnector.failed())
+    {
+      LOG_WARN("No saved WiFi network reachable, radio back to sleep");
+      radio.sleep();
+    }
+    return;
+  }
+
+  // Wake just in time for the period whose point sends the batch, or that could replay the backlog
+  uint32_t lead = wifiConnector.stats().lastAssociationMs + RADIO_WAKE_MARGIN_MS;
+  int32_t untilUpload = uploadTask->nextRunMs - millis();
+  bool sends = aggregator.readyAfterNext() && uploadDue(uploadTask->nextRunMs, 1);
+  if (untilUpload <= (int32_t)lead && (sends || offlineLog.size() > 0))
+  {
+    radio.wake();
+    wifiConnector.begin(WIFI_FAST_CONNECT_MS, WIFI_CONNECT_TIMEOUT_MS);
+  }
+}
+
+void radioIdle()
+{
+  // Modem sleep: the radio goes off as long as no batch is due and the backlog is replayed, points
+  // written meanwhile wait in the client buffer
+  if (radio.modemSleep() && radio.awake() && boot.finished() && !uploadDue(millis(), 0) && offlineLog.size() == 0)
+    radio.sleep();
+}
+
+bool uploadDue(uint32_t atMs, uint16_t newRecords)
+{
+  // Published messages count until acknowledged, so the radio stays on for their PUBACK
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+    return mqttPublisher.batchDue(atMs, newRecords);
+  return batchWriter.flushDue(atMs, newRecords);
+}
+
+void mqttTask()
+{
+  if (!radio.awake())
+    return;
+  mqttPublisher.poll();
+  radioIdle();
+}
+
+size_t encodeBatch(const SampleRecord_t *records, uint16_t count, char *body, size_t size, uint16_t *taken)
+{
+  // The batch goes into `body` as a single multi-line record, sent in one request, up to the first
+  // record that doesn't fit
+  size_t len = 0;
+  *taken = 0;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    size_t separator = len > 0 ? 1 : 0;
+    size_t room = size - len - separator;
+    size_t written = encoder.encode(records[i], body + len + separator, room);
+    if (written == 0 && room < LINE_PROTOCOL_MAX)
+      break;
+    // A record with nothing valid to report adds no line
+    *taken = i + 1;
+    if (written == 0)
+      continue;
+    if (separator)
+      body[len] = '\n';
+    len += separator + written;
+  }
+  body[len] = '\0';
+  return len;
+}
+
+bool sendBody(const char *body)
+{
+  TRACE_SCOPE(TRACE_WRITE);
+  if (deviceConfig.transport == TRANSPORT_UDP)
+    return udpWriter.send(body, strlen(body));
+  // Replayed batches take the same path as the live ones
+  if (deviceConfig.directHttp)
+    return httpWriter.post(body, strlen(body));
+  return client.writeRecord(body) && client.flushBuffer();
+}
+
+bool sendRecords(const SampleRecord_t *records, uint16_t count, uint16_t *sent)
+{
+  *sent = count;
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+  {
+    // Deep sleep ends the connection, a batch only counts as sent there once it is acknowledged
+    if (!mqttPublisher.addBatch(records, count))
+      return false;
+    return deviceConfig.sleepMode != SLEEP_MODE_DEEP || mqttPublisher.flush(MQTT_FLUSH_TIMEOUT_MS);
+  }
+
+  // Replays only run while no live point is pending, the batch body is free then
+  size_t size;
+  char *body = batchWriter.replayBody(&size);
+  if (body == nullptr)
+    return false;
+  size_t len = encodeBatch(records, count, body, size, sent);
+  if (*sent == 0 && count > 0)
+    return false;
+  return len == 0 || sendBody(body);
+}
+
+const char *writeError()
+{
+  if (deviceConfig.transport == TRANSPORT_UDP)
+    return udpWriter.lastError();
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+    return mqttPublisher.connected() ? "no PUBACK in time" : "not connected to the broker";
+
+  // Formatted into the arena rather than a String, it is printed right away
+  const char *error = deviceConfig.directHttp
+                          ? cycleArena.printf("%s write failed with status %d", deviceConfig.gzip ? "gzip" : "https",
+                                              httpWriter.lastStatus())
+                          : cycleArena.copy(client.getLastErrorMessage().c_str());
+  return error != nullptr ? error : "error text didn't fit the arena";
+}
+
+void deepSleepCycle()
+{
+  uint32_t period = deviceConfig.sampleDelay > 0 ? deviceConfig.sampleDelay : DEFAULT_SAMPLE_DELAY_MS;
+
+  // RTC memory only holds our samples after a deep-sleep wake, a power-on starts a new batch
+  bool coldBoot = ESP.getResetInfoPtr()->reason != REASON_DEEP_SLEEP_AWAKE;
+  if (coldBoot || !rtcLog.load())
+    rtcLog.clear();
+
+  // The SDK clock restarts with every wake, carry the wall clock over from the last one
+  if (rtcLog.wakeTime() != 0)
+  {
+    uint32_t uptime = millis();
+    struct timeval now = {(time_t)(rtcLog.wakeTime() + uptime / 1000), (suseconds_t)(uptime % 1000) * 1000};
+    settimeofday(&now, nullptr);
+  }
+
+  startSensors();
+  if (hasPM)
+    pmsParser.setSleep(pmsSerial, false);
+  uint32_t warmupStart = millis();
+  while (!sensorsReady(millis() - warmupStart) && millis() - warmupStart < SENSOR_WARMUP_MS)
+  {
+    delay(10);
+    pollSensors();
+  }
+
+  if (hasPM)
+  {
+    pmTask();
+    // The fan and laser only run while we sample
+    pmsParser.setSleep(pmsSerial, true);
+  }
   if (hasSHT)
+    shtTask();
+
+  if (deviceConfig.displayMode == DISPLAY_MODE_DASHBOARD)
+    dashboard.begin(&renderer);
+  displayTask();
+
+  SampleRecord_t record = {};
+  captureSample(record);
+  if (!rtcLog.append(record))
   {
-    TMP_RH result = ag.periodicFetchData();
-    float temp_f = (result.t * 1.8f) + 32;
-    sensor.addField("temp_c", result.t);
-    sensor.addField("temp_f", temp_f);
-    sensor.addField("humidity", result.rh);
-    showTextRectangle(String(temp_f), String(result.rh) + "%", false);
-    delay(3000);
+    // Full, or the batch spans more time than a sample offset covers
+    flushRtcLog(coldBoot);
+    rtcLog.append(record);
   }
+  rtcLog.countWake();
 
-  sensor.addField("rssi", WiFi.RSSI());
+  // Without a clock the samples can only be dated by an upload in the same wake
+  if (!clockValid() || rtcLog.wakes() >= deviceConfig.deepSleepFlushEvery || rtcLog.full())
+    flushRtcLog(coldBoot);
 
-  // If no Wifi signal, try to reconnect it
-  if (wifiMulti.run() != WL_CONNECTED)
+  // Wake on a whole second of the wall clock so the next wake can carry it over exactly
+  uint32_t awake = millis();
+  uint32_t sleepMs = period > awake + DEEP_SLEEP_MIN_MS ? period - awake : DEEP_SLEEP_MIN_MS;
+  if (clockValid())
   {
-    Serial.println("Wifi connection lost");
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    sleepMs += (1000 - (now.tv_usec / 1000 + sleepMs) % 1000) % 1000;
+    rtcLog.setWakeTime(now.tv_sec + (now.tv_usec / 1000 + sleepMs) / 1000);
   }
 
-  // Write point
-  if (!client.writePoint(sensor))
+  // Only the wake that uploads needs the radio
+  bool nextFlush = !clockValid() || rtcLog.wakes() + 1 >= deviceConfig.deepSleepFlushEvery ||
+                   rtcLog.size() + 1u >= RTC_LOG_CAPACITY;
+  rtcLog.save();
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+    mqttPublisher.disconnect();
+
+  LOG_INFO("Awake %u ms, %u samples in RTC memory, sleeping %u ms", awake, rtcLog.size(), sleepMs);
+  logger.flush();
+  ESP.deepSleep((uint64_t)sleepMs * 1000, nextFlush ? RF_DEFAULT : RF_DISABLED);
+}
+
+void flushRtcLog(bool coldBoot)
+{
+  if (rtcLog.size() == 0)
+    return;
+
+  // The config portal is only opened after a power-on, a wake without WiFi keeps the samples offline
+  bool online = false;
+  if (connectWIFI)
   {
-    Serial.print("InfluxDB write failed: ");
-    Serial.println(client.getLastErrorMessage());
+    wifiConnector.begin(WIFI_FAST_CONNECT_MS, WIFI_CONNECT_TIMEOUT_MS);
+    while (!(online = wifiConnector.poll()) && !wifiConnector.failed())
+      delay(10);
+    if (!online && coldBoot)
+    {
+      connectToWifi();
+      wifiConnector.connected();
+      online = true;
+    }
   }
+
+  if (online)
+  {
+    startTimeSync();
+    uint32_t syncStart = millis();
+    while (!clockValid() && millis() - syncStart < NTP_SYNC_TIMEOUT_MS)
+      delay(10);
+  }
+
+  if (!clockValid())
+  {
+    LOG_WARN("Clock not set, dropping %u undated samples", rtcLog.size());
+    rtcLog.discard();
+    return;
+  }
+
+  // Samples taken before the clock was set in this wake carry uptime, date them now
+  uint32_t uptime = millis() / 1000;
+  time_t now = time(nullptr);
+  size_t mark = cycleArena.mark();
+  for (uint8_t first = 0; first < rtcLog.size();)
+  {
+    uint8_t count = min(OFFLINE_DRAIN_BATCH, rtcLog.size() - first);
+    for (uint8_t i = 0; i < count; i++)
+    {
+      rtcLog.expand(first + i, drainRecords[i]);
+      if (drainRecords[i].timestamp < CLOCK_VALID_EPOCH)
+      {
+        drainRecords[i].timestamp = now - (uptime - drainRecords[i].timestamp);
+        sampleRecordSeal(drainRecords[i]);
+      }
+    }
+
+    uint16_t sent = count;
+    if (online && !sendRecords(drainRecords, count, &sent))
+    {
+      LOG_WARN("InfluxDB write failed: %s", writeError());
+      online = false;
+    }
+    if (!online)
+    {
+      offlineLog.append(drainRecords, count);
+      sent = count;
+    }
+    first += sent;
+    cycleArena.rewind(mark);
+  }
+  rtcLog.discard();
+
+  for (uint8_t i = 0; online && i < DEEP_SLEEP_DRAIN_BATCHES && offlineLog.size() > 0; i++)
+  {
+    drainTask();
+    cycleArena.rewind(mark);
+  }
+}
+
+void healthTask()
+{
+  if (!clockValid())
+    return;
+
+  LineProtocolField_t fields[HEALTH_FIELDS_MAX];
+  uint8_t count = health.collect(scheduler, writeStats(), fields);
+  if (healthEncoder.encodeFields(fields, count, time(nullptr), healthLine, LINE_PROTOCOL_MAX) == 0)
+  {
+    LOG_WARN("Health point too long for the line buffer");
+    return;
+  }
+  healthPending = true;
+  if (radio.awake())
+    writeHealth();
+}
+
+void writeHealth()
+{
+  healthPending = false;
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+  {
+    if (!mqttPublisher.addLine(healthLine))
+      LOG_WARN("MQTT messages all waiting, health point dropped");
+    return;
+  }
+
+  // Mirrored as an empty record so the samples mirrored for the offline log stay in step
+  SampleRecord_t placeholder = {};
+  uint32_t dropped = batchWriter.stats().droppedPoints;
+  bool written = batchWriter.write(healthLine);
+  mirrorPending(placeholder, dropped);
+  if (!written)
+    LOG_WARN("InfluxDB write failed: %s", writeError());
+}
+
+HealthWrites_t writeStats()
+{
+  HealthWrites_t writes;
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+  {
+    const MqttStats_t &mqtt = mqttPublisher.stats();
+    writes = {mqtt.acked, mqtt.drops, mqtt.retransmits, mqtt.totalAckMs, mqtt.maxAckMs};
+  }
+  else
+  {
+    const BatchStats_t &batch = batchWriter.stats();
+    writes = {batch.flushes + batch.failedFlushes, batch.failedFlushes, 0, batch.totalFlushMs, batch.maxFlushMs};
+  }
+  // Batches replayed from the offline log are sent again
+  writes.retries += offlineLog.stats().replayBatches;
+  return writes;
+}
+
+void flushTask()
+{
+  // A batch that isn't filled up goes out once its oldest point is `flush_interval` old
+  if (radio.awake() && batchWriter.flushIfDue() && batchWriter.pending() == 0)
+    pendingSampleCount = 0;
+}
+
+void housekeepingTask()
+{
+  radio.tick(batchWriter.stats().flushedPoints + mqttPublisher.stats().records + offlineLog.stats().replayed);
+
+#if LOG_ENABLED(LOG_LEVEL_INFO)
+  scheduler.printStats(logger);
+  batchWriter.printStats(logger);
+  if (hasPM)
+    pmsParser.printStats(logger);
+  if (hasCO2)
+    s8.printStats(logger);
+  offlineLog.printStats(logger);
+  cycleArena.printStats(logger);
+  logger.printStats(logger);
+#if ALLOC_TRACKING
+  allocTracker.printStats(logger);
+#endif
+  if (deviceConfig.directHttp)
+    httpWriter.printStats(logger);
+  if (deviceConfig.directHttp && httpWriter.isSecure())
+    httpWriter.tls().printStats(logger);
+  if (deviceConfig.transport == TRANSPORT_UDP)
+    udpWriter.printStats(logger);
+  if (deviceConfig.transport == TRANSPORT_MQTT)
+    mqttPublisher.printStats(logger);
+  if (metricsServer.enabled())
+    metricsServer.printStats(logger);
+  renderer.printStats(logger);
+  wifiConnector.printStats(logger);
+  radio.printStats(logger);
+#endif
 }
 
 bool loadConfig()
 {
-  File configFile = LittleFS.open("/config.json", "r");
+  uint32_t jsonSize;
+  uint32_t jsonCrc;
+  if (!configFileHash(CONFIG_JSON_PATH, jsonSize, jsonCrc))
+  {
+    LOG_ERROR("Failed to open config file");
+    return false;
+  }
+
+  // config.json is only parsed again when it changed since the snapshot was taken
+  ConfigSnapshot_t config;
+  if (configSnapshotLoad(config, jsonSize, jsonCrc))
+  {
+    LOG_INFO("Config loaded from snapshot");
+  }
+  else
+  {
+    if (!parseConfig(config))
+      return false;
+    if (!configSnapshotSave(config, jsonSize, jsonCrc))
+      LOG_WARN("Failed to write config snapshot");
+  }
+
+  applyConfig(config);
+  return true;
+}
+
+bool parseConfig(ConfigSnapshot_t &config)
+{
+  File configFile = LittleFS.open(CONFIG_JSON_PATH, "r");
   if (!configFile)
   {
-    Serial.println("Failed to open config file");
+    LOG_ERROR("Failed to open config file");
     return false;
   }
 
@@ -231,60 +1207,159 @@ bool loadConfig()
   DeserializationError error = deserializeJson(doc, configFile);
   if (error)
   {
-    Serial.println("Failed to parse config file");
-    Serial.println(error.c_str());
+    LOG_ERROR("Failed to parse config file: %s", error.c_str());
     return false;
   }
 
-  const char *url = doc["influx_db"]["url"];
-  const char *token = doc["influx_db"]["token"];
-  const char *org = doc["influx_db"]["org"];
-  const char *bucket = doc["influx_db"]["bucket"];
+  memset(&config, 0, sizeof(config));
+  const char *deviceName = doc["device_name"] | "unknown_device";
+  bool truncated = strlcpy(config.deviceName, deviceName, sizeof(config.deviceName)) >= sizeof(config.deviceName);
+  truncated |= strlcpy(config.url, doc["influx_db"]["url"] | "", sizeof(config.url)) >= sizeof(config.url);
+  truncated |= strlcpy(config.org, doc["influx_db"]["org"] | "", sizeof(config.org)) >= sizeof(config.org);
+  truncated |= strlcpy(config.bucket, doc["influx_db"]["bucket"] | "", sizeof(config.bucket)) >= sizeof(config.bucket);
+  truncated |= strlcpy(config.token, doc["influx_db"]["token"] | "", sizeof(config.token)) >= sizeof(config.token);
+  if (truncated)
+    LOG_WARN("Config value too long, truncated");
+
+  config.batchSize = doc["influx_db"]["batch_size"] | DEFAULT_BATCH_SIZE;
+  config.bufferSize = doc["influx_db"]["buffer_size"] | DEFAULT_BUFFER_SIZE;
+  config.flushInterval = doc["influx_db"]["flush_interval"] | DEFAULT_FLUSH_INTERVAL_S;
+  config.gzip = doc["influx_db"]["gzip"] | DEFAULT_GZIP;
+  const char *transport = doc["influx_db"]["transport"];
+  if (transport != nullptr)
+    config.transport = strcmp(transport, "udp") == 0    ? TRANSPORT_UDP
+                       : strcmp(transport, "mqtt") == 0 ? TRANSPORT_MQTT
+                                                        : TRANSPORT_HTTP;
+  else
+    config.transport = DEFAULT_TRANSPORT;
+
+  // Topic and client id default to ones derived from the chip id in applyConfig()
+  JsonObject mqtt = doc["mqtt"];
+  truncated = strlcpy(config.mqttHost, mqtt["host"] | "", sizeof(config.mqttHost)) >= sizeof(config.mqttHost);
+  truncated |= strlcpy(config.mqttTopic, mqtt["topic"] | "", sizeof(config.mqttTopic)) >= sizeof(config.mqttTopic);
+  truncated |= strlcpy(config.mqttClientId, mqtt["client_id"] | "", sizeof(config.mqttClientId)) >=
+               sizeof(config.mqttClientId);
+  truncated |= strlcpy(config.mqttUsername, mqtt["username"] | "", sizeof(config.mqttUsername)) >=
+               sizeof(config.mqttUsername);
+  truncated |= strlcpy(config.mqttPassword, mqtt["password"] | "", sizeof(config.mqttPassword)) >=
+               sizeof(config.mqttPassword);
+  if (truncated)
+    LOG_WARN("MQTT config value too long, truncated");
+  config.mqttPort = mqtt["port"] | DEFAULT_MQTT_PORT;
+  config.mqttKeepAlive = mqtt["keep_alive"] | DEFAULT_MQTT_KEEP_ALIVE_S;
+  const char *mqttFormat = mqtt["format"];
+  config.mqttFormat =
+      mqttFormat != nullptr && strcmp(mqttFormat, "binary") == 0 ? MQTT_FORMAT_BINARY : MQTT_FORMAT_LINE;
+
+  config.metricsPort = doc["metrics_port"] | DEFAULT_METRICS_PORT;
+  config.healthInterval = doc["health_interval"] | DEFAULT_HEALTH_INTERVAL_S;
+  config.sampleDelay = doc["sample_delay"] | DEFAULT_SAMPLE_DELAY_MS;
+  config.aggregateWindow = doc["aggregate_window"] | DEFAULT_AGGREGATE_WINDOW_MS;
+  config.deepSleepFlushEvery = doc["deep_sleep_flush_every"] | DEFAULT_DEEP_SLEEP_FLUSH_EVERY;
 
+  const char *sleepMode = doc["sleep_mode"];
+  if (sleepMode != nullptr)
+    config.sleepMode = strcmp(sleepMode, "deep") == 0    ? SLEEP_MODE_DEEP
+                       : strcmp(sleepMode, "modem") == 0 ? SLEEP_MODE_MODEM
+                                                         : SLEEP_MODE_NONE;
+  else
+    config.sleepMode = DEFAULT_SLEEP_MODE;
+
+  const char *displayMode = doc["display_mode"];
+  if (displayMode != nullptr)
+    config.displayMode = strcmp(displayMode, "dashboard") == 0 ? DISPLAY_MODE_DASHBOARD : DISPLAY_MODE_PAGES;
+  else
+    config.displayMode = DEFAULT_DISPLAY_MODE;
+
+  LOG_INFO("Config parsed from json");
+  return true;
+}
+
+void applyConfig(const ConfigSnapshot_t &config)
+{
 #ifdef USE_IRSG_ROOT_CERT
-  client.setConnectionParams(url, org, bucket, token, InfluxDbCloud2CACert);
-  // Disables certificate verification
-  // const bool insecureMode = doc["influx_db"]["insecure_mode"];
-  client.setInsecure(insecureMode);
+  client.setConnectionParams(config.url, config.org, config.bucket, config.token, InfluxDbCloud2CACert);
 #else
-  client.setConnectionParams(url, org, bucket, token);
+  client.setConnectionParams(config.url, config.org, config.bucket, config.token);
   client.setInsecure(true);
 #endif
 
-#if ENABLE_CONNECTION_REUSE
+#ifdef ENABLE_CONNECTION_REUSE
   client.setHTTPOptions(HTTPOptions().connectionReuse(true));
 #endif
 
-  const char *deviceName = doc["device_name"];
-  deviceConfig.sampleDelay = doc["sample_delay"] | 10000;
-
-  if (deviceName != nullptr)
+  deviceConfig.batchSize = config.batchSize;
+  // Buffered points beyond what the mirror holds would be spilled while still pending
+  deviceConfig.bufferSize = min<uint16_t>(config.bufferSize, OFFLINE_PENDING_MAX);
+  if (deviceConfig.bufferSize < config.bufferSize)
+    LOG_WARN("Buffer size capped at %u points", deviceConfig.bufferSize);
+  deviceConfig.flushInterval = config.flushInterval;
+  deviceConfig.transport = config.transport;
+  // Datagrams and MQTT messages carry plain line protocol
+  deviceConfig.gzip = config.gzip && deviceConfig.transport == TRANSPORT_HTTP;
+  deviceConfig.directHttp =
+      deviceConfig.transport == TRANSPORT_HTTP && (deviceConfig.gzip || strncmp(config.url, "https:", 6) == 0);
+  if (deviceConfig.transport == TRANSPORT_UDP)
+  {
+    udpWriter.begin(config.url);
+    batchWriter.begin(&client, deviceConfig.batchSize, deviceConfig.bufferSize, deviceConfig.flushInterval, nullptr,
+                      &udpWriter);
+    LOG_INFO("Writing batches as UDP datagrams");
+  }
+  else if (deviceConfig.transport == TRANSPORT_MQTT)
   {
-    strlcpy(deviceConfig.deviceName, deviceName, 32);
+    char topic[MQTT_TOPIC_MAX];
+    char clientId[32];
+    if (config.mqttTopic[0] != '\0')
+      strlcpy(topic, config.mqttTopic, sizeof(topic));
+    else
+      snprintf(topic, sizeof(topic), "airgradient/%x", ESP.getChipId());
+    if (config.mqttClientId[0] != '\0')
+      strlcpy(clientId, config.mqttClientId, sizeof(clientId));
+    else
+      snprintf(clientId, sizeof(clientId), "airgradient-%x", ESP.getChipId());
+    mqttPublisher.begin(config.mqttHost, config.mqttPort, clientId, config.mqttUsername, config.mqttPassword,
+                        topic, config.mqttKeepAlive, config.mqttFormat, deviceConfig.batchSize,
+                        deviceConfig.flushInterval, &encoder);
+    LOG_INFO("Publishing %s batches to %s:%u, topic %s",
+             config.mqttFormat == MQTT_FORMAT_BINARY ? "binary" : "line protocol", config.mqttHost, config.mqttPort,
+             topic);
   }
   else
   {
-    strcpy(deviceConfig.deviceName, "unknown_device");
+    httpWriter.begin(config.url, config.org, config.bucket, config.token, deviceConfig.gzip);
+    batchWriter.begin(&client, deviceConfig.batchSize, deviceConfig.bufferSize, deviceConfig.flushInterval,
+                      deviceConfig.directHttp ? &httpWriter : nullptr);
+    if (deviceConfig.gzip)
+      LOG_INFO("Writing gzip-compressed batches");
   }
 
-  Serial.print("Device Name: ");
-  Serial.println(deviceConfig.deviceName);
+  deviceConfig.metricsPort = config.metricsPort;
+  deviceConfig.healthInterval = config.healthInterval;
+  deviceConfig.sampleDelay = config.sampleDelay;
+  deviceConfig.aggregateWindow = config.aggregateWindow;
+  deviceConfig.displayMode = config.displayMode;
+  deviceConfig.sleepMode = config.sleepMode;
+  // RTC memory can't hold more wakes than that between uploads
+  deviceConfig.deepSleepFlushEvery = constrain(config.deepSleepFlushEvery, 1, RTC_LOG_CAPACITY);
 
-  return true;
+  // One summary point per window, a window shorter than the sample period uploads every sample
+  uint32_t samplePeriod = deviceConfig.sampleDelay > 0 ? deviceConfig.sampleDelay : DEFAULT_SAMPLE_DELAY_MS;
+  aggregator.begin(max(1ul, (unsigned long)(deviceConfig.aggregateWindow / samplePeriod)));
+
+  LOG_INFO("Aggregating %u samples per point", aggregator.window());
+
+  strlcpy(deviceConfig.deviceName, config.deviceName, sizeof(deviceConfig.deviceName));
+  LOG_INFO("Device Name: %s", deviceConfig.deviceName);
 }
 
 // DISPLAY
-void showTextRectangle(String ln1, String ln2, boolean small)
+void showTextRectangle(const char *ln1, const char *ln2, boolean small)
 {
-  display.firstPage();
-  display.firstPage();
-  do
-  {
-    display.setFont(u8g2_font_t0_16_tf);
-    display.drawStr(1, 10, String(ln1).c_str());
-    display.drawStr(1, 30, String(ln2).c_str());
-    // display.drawStr(1, 50, String(ln3).c_str());
-  } while (display.nextPage());
+  // Only the lines that changed since the last call are redrawn and sent
+  renderer.setText(displayLines[0], ln1);
+  renderer.setText(displayLines[1], ln2);
+  renderer.render();
 }
 
 // Wifi Manager
@@ -292,12 +1367,14 @@ void connectToWifi()
 {
   WiFiManager wifiManager;
   // WiFi.disconnect(); //to delete previous saved hotspot
-  String HOTSPOT = "AIRGRADIENT-" + String(ESP.getChipId(), HEX);
+  char hotspot[24];
+  snprintf(hotspot, sizeof(hotspot), "AIRGRADIENT-%x", ESP.getChipId());
   wifiManager.setTimeout(120);
-  if (!wifiManager.autoConnect((const char *)HOTSPOT.c_str()))
+  if (!wifiManager.autoConnect(hotspot))
   {
-    Serial.println("failed to connect and hit timeout");
+    LOG_ERROR("failed to connect and hit timeout");
     delay(3000);
+    logger.flush();
     ESP.restart();
     delay(5000);
   }
@@ -0,0 +1,236 @@
+#include "metrics_server.h"
+#include "logger.h"
+#include "trace.h"
+
+#include <new>
+
+static const char notFoundResponse[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+#if TRACE_ENABLED
+// The dump's length isn't known up front, closing the connection ends it
+static const char traceHeader[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n";
+#endif
+
+// Hundredths as a decimal, e.g. -105 as -1.05
+static void formatCenti(char *out, size_t size, int32_t value)
+{
+  uint32_t magnitude = value < 0 ? -value : value;
+  snprintf(out, size, "%s%u.%02u", value < 0 ? "-" : "", magnitude / 100, magnitude % 100);
+}
+
+static size_t appendGauge(char *out, size_t size, const char *name, const char *help, const char *labels,
+                          const char *value)
+{
+  int n = snprintf(out, size, "# HELP airgradient_%s %s\n# TYPE airgradient_%s gauge\nairgradient_%s%s %s\n", name,
+                   help, name, name, labels, value);
+  return n > 0 && (size_t)n < size ? n : 0;
+}
+
+MetricsServer::MetricsServer()
+    : server(DEFAULT_METRICS_PORT), port(0), active(false), acceptedMs(0), requestLineLength(0),
+      requestLineDone(false), lineEmpty(false), page(nullptr), pageStart(0), pageLength(0)
+{
+  labels[0] = '\0';
+  memset(&metricsStats, 0, sizeof(metricsStats));
+}
+
+void MetricsServer::begin(uint16_t port, const char *id, const char *name)
+{
+  this->port = port;
+  if (port == 0)
+    return;
+
+  if (page == nullptr)
+  {
+    page = new (std::nothrow) char[METRICS_HEADER_MAX + METRICS_PAGE_MAX];
+    if (page == nullptr)
+    {
+      LOG_ERROR("No memory for the metrics page, not serving metrics");
+      this->port = 0;
+      return;
+    }
+  }
+
+  // Label values escape backslash, double quote and newline
+  size_t n = snprintf(labels, sizeof(labels), "{id=\"%s\",name=\"", id);
+  for (const char *c = name; *c != '\0' && n + 4 < sizeof(labels); c++)
+  {
+    if (*c == '\\' || *c == '"' || *c == '\n')
+      labels[n++] = '\\';
+    labels[n++] = *c == '\n' ? 'n' : *c;
+  }
+  labels[n++] = '"';
+  labels[n++] = '}';
+  labels[n] = '\0';
+
+  // Scrapes before the first sample get an empty page
+  render(page + METRICS_HEADER_MAX, 0);
+  server.begin(port);
+  LOG_INFO("Serving Prometheus metrics on port %u", port);
+}
+
+void MetricsServer::update(const SampleRecord_t &record)
+{
+  if (!enabled())
+    return;
+
+  // A reading that isn't valid is left out, Prometheus then marks the series stale
+  char *body = page + METRICS_HEADER_MAX;
+  size_t length = 0;
+  char value[16];
+  if (record.pms[PMS_PM25] != SAMPLE_PMS_INVALID)
+  {
+    snprintf(value, sizeof(value), "%u", record.pms[PMS_PM25]);
+    length += appendGauge(body + length, METRICS_PAGE_MAX - length, "pm2_5_ugm3", "PM2.5 concentration in ug/m3",
+                          labels, value);
+  }
+  if (record.co2 != SAMPLE_CO2_INVALID)
+  {
+    snprintf(value, sizeof(value), "%d", record.co2);
+    length += appendGauge(body + length, METRICS_PAGE_MAX - length, "co2_ppm", "CO2 concentration in ppm", labels,
+                          value);
+  }
+  if (record.tempC != SAMPLE_TEMP_INVALID)
+  {
+    formatCenti(value, sizeof(value), record.tempC);
+    length += appendGauge(body + length, METRICS_PAGE_MAX - length, "temperature_celsius",
+                          "Temperature in degrees Celsius", labels, value);
+  }
+  if (record.humidity != SAMPLE_HUMIDITY_INVALID)
+  {
+    formatCenti(value, sizeof(value), record.humidity);
+    length += appendGauge(body + length, METRICS_PAGE_MAX - length, "humidity_percent", "Relative humidity in percent",
+                          labels, value);
+  }
+  if (record.rssi != SAMPLE_RSSI_INVALID)
+  {
+    snprintf(value, sizeof(value), "%d", record.rssi);
+    length += appendGauge(body + length, METRICS_PAGE_MAX - length, "wifi_rssi_dbm", "WiFi signal strength in dBm",
+                          labels, value);
+  }
+
+  render(body, length);
+  metricsStats.updates++;
+}
+
+void MetricsServer::render(const char *body, size_t length)
+{
+  // The headers go right in front of the body so the response is sent with one write
+  char header[METRICS_HEADER_MAX];
+  int n = snprintf(header, sizeof(header),
+                   "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %u\r\n"
+                   "Connection: close\r\n\r\n",
+                   (unsigned)length);
+  pageStart = body - page - n;
+  memcpy(page + pageStart, header, n);
+  pageLength = n + length;
+}
+
+void MetricsServer::poll()
+{
+  if (!enabled())
+    return;
+
+  if (!active)
+  {
+    if (!server.hasClient())
+      return;
+    client = server.accept();
+    active = true;
+    acceptedMs = millis();
+    requestLineLength = 0;
+    requestLineDone = false;
+    lineEmpty = false;
+  }
+
+  if (!client.connected())
+  {
+    metricsStats.failed++;
+    close();
+    return;
+  }
+
+  for (uint16_t i = 0; i < METRICS_READ_PER_POLL && client.available() > 0; i++)
+  {
+    int c = client.read();
+    if (c < 0)
+      break;
+
+    if (!requestLineDone)
+    {
+      if (c == '\r' || c == '\n')
+        requestLineDone = true;
+      else if (requestLineLength < sizeof(requestLine) - 1)
+        requestLine[requestLineLength++] = c;
+    }
+
+    if (c == '\n')
+    {
+      if (lineEmpty)
+      {
+        respond();
+        return;
+      }
+      lineEmpty = true;
+    }
+    else if (c != '\r')
+    {
+      lineEmpty = false;
+    }
+  }
+
+  if (millis() - acceptedMs >= METRICS_REQUEST_TIMEOUT_MS)
+  {
+    metricsStats.timeouts++;
+    close();
+  }
+}
+
+void MetricsServer::respond()
+{
+  uint32_t start = micros();
+  requestLine[requestLineLength] = '\0';
+  // The path may carry a query, Prometheus adds none by default
+  bool metrics = strncmp(requestLine, "GET /metrics", 12) == 0 &&
+                 (requestLine[12] == '\0' || requestLine[12] == ' ' || requestLine[12] == '?');
+
+  if (metrics)
+  {
+    size_t written = client.write((const uint8_t *)page + pageStart, pageLength);
+    metricsStats.bytes += written;
+    if (written == pageLength)
+      metricsStats.scrapes++;
+    else
+      metricsStats.failed++;
+  }
+#if TRACE_ENABLED
+  else if (strncmp(requestLine, "GET /trace", 10) == 0 && (requestLine[10] == '\0' || requestLine[10] == ' '))
+  {
+    metricsStats.bytes += client.write((const uint8_t *)traceHeader, sizeof(traceHeader) - 1);
+    metricsStats.bytes += trace.dump(client);
+  }
+#endif
+  else
+  {
+    client.write((const uint8_t *)notFoundResponse, sizeof(notFoundResponse) - 1);
+    metricsStats.notFound++;
+  }
+  close();
+
+  metricsStats.lastServeUs = micros() - start;
+  metricsStats.maxServeUs = max(metricsStats.maxServeUs, metricsStats.lastServeUs);
+}
+
+void MetricsServer::close()
+{
+  client.stop();
+  active = false;
+}
+
+void MetricsServer::printStats(Print &out) const
+{
+  out.printf("metrics port %u updates %u scrapes %u not found %u timeouts %u failed %u bytes %llu serve last %u us "
+             "max %u us\n",
+             port, metricsStats.updates, metricsStats.scrapes, metricsStats.notFound, metricsStats.timeouts,
+             metricsStats.failed, (unsigned long long)metricsStats.bytes, metricsStats.lastServeUs,
+             metricsStats.maxServeUs);
+}
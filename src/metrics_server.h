@@ -0,0 +1,75 @@
+#ifndef __METRICS_SERVER_H__
+#define __METRICS_SERVER_H__
+
+#include <Arduino.h>
+#include <WiFiServer.h>
+#include "config.h"
+#include "sample_record.h"
+
+// Status line and headers of the response, written in front of the page body
+#define METRICS_HEADER_MAX 128
+#define METRICS_LABELS_MAX 96
+#define METRICS_REQUEST_LINE_MAX 32
+// Bytes of a request read per poll(), whatever is left waits for the next loop()
+#define METRICS_READ_PER_POLL 256
+
+typedef struct
+{
+  uint32_t updates;
+  uint32_t scrapes;
+  uint32_t notFound;
+  uint32_t timeouts;
+  uint32_t failed;
+  uint32_t lastServeUs;
+  uint32_t maxServeUs;
+  uint64_t bytes;
+} MetricsStats_t;
+
+//
+// Serves the last sample in the Prometheus text format on GET /metrics. update() renders the
+// whole response, headers included, into a page allocated by begin() once per sample; poll() runs
+// from loop() and only moves bytes: it accepts one connection at a time, reads the request a few
+// bytes per call without waiting for more, answers with a single write of the page and closes.
+// Nothing is allocated after begin() and the sensors are never waited on. Built with TRACE_ENABLED, GET /trace dumps the
+// event trace instead.
+//
+class MetricsServer
+{
+public:
+  MetricsServer();
+
+  // `id` and `name` label every sample
+  void begin(uint16_t port, const char *id, const char *name);
+  void update(const SampleRecord_t &record);
+  void poll();
+
+  bool enabled() const { return port != 0; }
+  const MetricsStats_t &stats() const { return metricsStats; }
+  void printStats(Print &out) const;
+
+private:
+  void render(const char *body, size_t length);
+  void respond();
+  void close();
+
+  WiFiServer server;
+  uint16_t port;
+  char labels[METRICS_LABELS_MAX];
+
+  WiFiClient client;
+  bool active;
+  uint32_t acceptedMs;
+  // Start of the request line; the request ends with the first empty line after it
+  char requestLine[METRICS_REQUEST_LINE_MAX];
+  uint8_t requestLineLength;
+  bool requestLineDone;
+  bool lineEmpty;
+
+  // Response headers end right where the body starts, page + pageStart is the whole response
+  char *page;
+  size_t pageStart;
+  size_t pageLength;
+  MetricsStats_t metricsStats;
+};
+
+#endif //__METRICS_SERVER_H__
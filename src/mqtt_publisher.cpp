@@ -0,0 +1,604 @@
+#include "mqtt_publisher.h"
+#include "logger.h"
+
+#include <ESP8266WiFi.h>
+#include <new>
+
+// Remaining length of a control packet, 1 to 4 bytes of 7 bits
+static uint8_t encodeLength(uint32_t length, uint8_t *out)
+{
+  uint8_t n = 0;
+  do
+  {
+    uint8_t byte = length & 0x7f;
+    length >>= 7;
+    out[n++] = byte | (length > 0 ? 0x80 : 0);
+  } while (length > 0);
+  return n;
+}
+
+static uint8_t *putString(uint8_t *out, const char *value)
+{
+  size_t length = strlen(value);
+  *out++ = length >> 8;
+  *out++ = length & 0xff;
+  memcpy(out, value, length);
+  return out + length;
+}
+
+MqttPublisher::MqttPublisher()
+    : encoder(nullptr), port(DEFAULT_MQTT_PORT), keepAliveS(DEFAULT_MQTT_KEEP_ALIVE_S), format(MQTT_FORMAT_LINE),
+      batchSize(1), flushIntervalMs(0), state(MQTT_DISCONNECTED), attempted(false), lastAttemptMs(0),
+      reconnectMs(MQTT_RECONNECT_MS), connectStartedMs(0), lastSendMs(0), pingPending(false), pingSentMs(0), nextPacketId(1), nextSeq(0), rxStage(0),
+      rxHeader(0), rxRemaining(0), rxShift(0), rxLength(0), messages(nullptr)
+{
+  host[0] = clientId[0] = username[0] = password[0] = topic[0] = '\0';
+  memset(&publisherStats, 0, sizeof(publisherStats));
+}
+
+void MqttPublisher::begin(const char *host, uint16_t port, const char *clientId, const char *username,
+                          const char *password, const char *topic, uint16_t keepAliveS, uint8_t format,
+                          uint16_t batchSize, uint16_t flushIntervalSec, const LineProtocolEncoder *encoder)
+{
+  strlcpy(this->host, host, sizeof(this->host));
+  strlcpy(this->clientId, clientId, sizeof(this->clientId));
+  strlcpy(this->username, username, sizeof(this->username));
+  strlcpy(this->password, password, sizeof(this->password));
+  strlcpy(this->topic, topic, sizeof(this->topic));
+  this->port = port;
+  this->keepAliveS = keepAliveS;
+  this->format = format;
+  this->batchSize = batchSize > 0 ? batchSize : 1;
+  this->flushIntervalMs = (uint32_t)flushIntervalSec * 1000;
+  this->encoder = encoder;
+  // MQTT 3.1.1 only allows a password along with a user name
+  if (username[0] == '\0' && password[0] != '\0')
+    LOG_WARN("MQTT password without a user name, not sent");
+
+  if (messages == nullptr)
+  {
+    messages = new (std::nothrow) MqttMessage_t[MQTT_INFLIGHT_MAX]();
+    if (messages == nullptr)
+    {
+      LOG_ERROR("No memory for %u MQTT messages, not publishing", MQTT_INFLIGHT_MAX);
+      this->host[0] = '\0';
+      return;
+    }
+  }
+
+  if (state != MQTT_DISCONNECTED)
+    drop("reconfigured");
+  attempted = false;
+  reconnectMs = MQTT_RECONNECT_MS;
+}
+
+MqttMessage_t *MqttPublisher::openMessage()
+{
+  if (messages == nullptr)
+    return nullptr;
+
+  MqttMessage_t *free = nullptr;
+  for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; i++)
+  {
+    MqttMessage_t &message = messages[i];
+    if (message.state == MQTT_MSG_OPEN)
+      return &message;
+    if (message.state == MQTT_MSG_FREE && free == nullptr)
+      free = &message;
+  }
+  if (free == nullptr)
+    return nullptr;
+
+  free->state = MQTT_MSG_OPEN;
+  free->records = 0;
+  free->length = 0;
+  free->seq = nextSeq++;
+  if (format == MQTT_FORMAT_BINARY)
+  {
+    MqttBinaryHeader_t header = {{'A', 'G'}, MQTT_BINARY_VERSION, 0};
+    memcpy(free->packet + MQTT_PUBLISH_HEADROOM, &header, sizeof(header));
+    free->length = sizeof(header);
+  }
+  return free;
+}
+
+MqttMessage_t *MqttPublisher::oldest(MqttMessageState_t state)
+{
+  MqttMessage_t *found = nullptr;
+  for (uint8_t i = 0; messages != nullptr && i < MQTT_INFLIGHT_MAX; i++)
+  {
+    if (messages[i].state == state && (found == nullptr || (int32_t)(messages[i].seq - found->seq) < 0))
+      found = &messages[i];
+  }
+  return found;
+}
+
+const MqttMessage_t *MqttPublisher::find(MqttMessageState_t state) const
+{
+  for (uint8_t i = 0; messages != nullptr && i < MQTT_INFLIGHT_MAX; i++)
+  {
+    if (messages[i].state == state)
+      return &messages[i];
+  }
+  return nullptr;
+}
+
+bool MqttPublisher::append(MqttMessage_t &message, const SampleRecord_t &record)
+{
+  uint8_t *payload = message.packet + MQTT_PUBLISH_HEADROOM;
+  if (format == MQTT_FORMAT_BINARY)
+  {
+    if (message.length + sizeof(record) > MQTT_PAYLOAD_MAX || message.records == UINT8_MAX)
+      return false;
+    memcpy(payload + message.length, &record, sizeof(record));
+    message.length += sizeof(record);
+  }
+  else
+  {
+    // One line per record, like the body of an InfluxDB write
+    size_t separator = message.length > 0 ? 1 : 0;
+    size_t written = encoder->encode(record, (char *)payload + message.length + separator,
+                                     MQTT_PAYLOAD_MAX - message.length - separator);
+    if (written == 0)
+      return false;
+    if (separator)
+      payload[message.length] = '\n';
+    message.length += separator + written;
+  }
+
+  if (message.records++ == 0)
+    message.openedMs = millis();
+  return true;
+}
+
+void MqttPublisher::close(MqttMessage_t &message)
+{
+  if (message.records == 0)
+  {
+    message.state = MQTT_MSG_FREE;
+    return;
+  }
+  if (format == MQTT_FORMAT_BINARY)
+    message.packet[MQTT_PUBLISH_HEADROOM + offsetof(MqttBinaryHeader_t, count)] = message.records;
+  message.state = MQTT_MSG_QUEUED;
+}
+
+bool MqttPublisher::add(const SampleRecord_t &record)
+{
+  for (uint8_t attempt = 0; attempt < 2; attempt++)
+  {
+    MqttMessage_t *message = openMessage();
+    if (message == nullptr)
+      break;
+    if (append(*message, record))
+    {
+      publisherStats.records++;
+      if (message->records >= batchSize)
+        close(*message);
+      return true;
+    }
+    // What doesn't fit an empty message has nothing to report
+    if (message->records == 0)
+      return true;
+    // Full, the record starts the next one
+    close(*message);
+  }
+  publisherStats.refused++;
+  return false;
+}
+
+bool MqttPublisher::addLine(const char *line)
+{
+  if (format == MQTT_FORMAT_BINARY)
+    return true;
+
+  size_t length = strlen(line);
+  for (uint8_t attempt = 0; attempt < 2; attempt++)
+  {
+    MqttMessage_t *message = openMessage();
+    if (message == nullptr)
+      break;
+    size_t separator = message->length > 0 ? 1 : 0;
+    if (message->length + separator + length <= MQTT_PAYLOAD_MAX)
+    {
+      uint8_t *payload = message->packet + MQTT_PUBLISH_HEADROOM;
+      if (separator)
+        payload[message->length] = '\n';
+      memcpy(payload + message->length + separator, line, length);
+      message->length += separator + length;
+      if (message->records++ == 0)
+        message->openedMs = millis();
+      return true;
+    }
+    if (message->records == 0)
+      return true;
+    close(*message);
+  }
+  publisherStats.refused++;
+  return false;
+}
+
+bool MqttPublisher::addBatch(const SampleRecord_t *records, uint16_t count)
+{
+  bool ok = true;
+  for (uint16_t i = 0; i < count && ok; i++)
+    ok = add(records[i]);
+
+  MqttMessage_t *open = oldest(MQTT_MSG_OPEN);
+  if (open != nullptr)
+    close(*open);
+  poll();
+  return ok;
+}
+
+bool MqttPublisher::idle() const
+{
+  for (uint8_t i = 0; messages != nullptr && i < MQTT_INFLIGHT_MAX; i++)
+  {
+    const MqttMessage_t &message = messages[i];
+    if (message.state == MQTT_MSG_QUEUED || message.state == MQTT_MSG_INFLIGHT ||
+        (message.state == MQTT_MSG_OPEN && message.records > 0))
+      return false;
+  }
+  return true;
+}
+
+bool MqttPublisher::acknowledged(uint32_t mark) const
+{
+  // Messages only leave the pool through their PUBACK
+  for (uint8_t i = 0; messages != nullptr && i < MQTT_INFLIGHT_MAX; i++)
+  {
+    const MqttMessage_t &message = messages[i];
+    if (message.state != MQTT_MSG_FREE && message.records > 0 && (int32_t)(message.seq - mark) < 0)
+      return false;
+  }
+  return true;
+}
+
+bool MqttPublisher::batchDue(uint32_t atMs, uint16_t newRecords) const
+{
+  if (find(MQTT_MSG_QUEUED) != nullptr || find(MQTT_MSG_INFLIGHT) != nullptr)
+    return true;
+
+  const MqttMessage_t *open = find(MQTT_MSG_OPEN);
+  uint16_t records = (open != nullptr ? open->records : 0) + newRecords;
+  if (records == 0)
+    return false;
+
+  uint32_t oldest = open != nullptr && open->records > 0 ? open->openedMs : atMs;
+  return records >= batchSize || (flushIntervalMs > 0 && atMs - oldest >= flushIntervalMs);
+}
+
+void MqttPublisher::connect(uint32_t now)
+{
+  // Connecting blocks, an unreachable broker costs the timeout on every attempt: each attempt
+  // doubles the wait for the next one until a CONNACK resets it
+  if (attempted)
+    reconnectMs = min(2 * reconnectMs, (uint32_t)MQTT_RECONNECT_MAX_MS);
+  attempted = true;
+  lastAttemptMs = now;
+  uint32_t started = millis();
+  client.setTimeout(MQTT_CONNECT_TIMEOUT_MS);
+  if (!client.connect(host, port))
+  {
+    LOG_WARN("MQTT connection to %s:%u failed after %u ms, next attempt in %u s", host, port, millis() - started,
+             reconnectMs / 1000);
+    return;
+  }
+  client.setNoDelay(true);
+
+  // Protocol level 4 (3.1.1) without clean session, so the broker keeps ours
+  bool withUsername = username[0] != '\0';
+  bool withPassword = withUsername && password[0] != '\0';
+  uint8_t flags = (withUsername ? 0x80 : 0) | (withPassword ? 0x40 : 0);
+  uint32_t remaining = 10 + 2 + strlen(clientId);
+  if (withUsername)
+    remaining += 2 + strlen(username);
+  if (withPassword)
+    remaining += 2 + strlen(password);
+
+  uint8_t packet[5 + 10 + 2 + sizeof(clientId) + 2 + sizeof(username) + 2 + sizeof(password)];
+  uint8_t *out = packet;
+  *out++ = 0x10;
+  out += encodeLength(remaining, out);
+  out = putString(out, "MQTT");
+  *out++ = 4;
+  *out++ = flags;
+  *out++ = keepAliveS >> 8;
+  *out++ = keepAliveS & 0xff;
+  out = putString(out, clientId);
+  if (withUsername)
+    out = putString(out, username);
+  if (withPassword)
+    out = putString(out, password);
+
+  if (client.write(packet, out - packet) != (size_t)(out - packet))
+  {
+    drop("CONNECT not sent");
+    return;
+  }
+  state = MQTT_CONNECTING;
+  connectStartedMs = lastSendMs = now;
+  pingPending = false;
+  rxStage = 0;
+  publisherStats.connects++;
+}
+
+bool MqttPublisher::sendPublish(MqttMessage_t &message, bool dup, uint32_t now)
+{
+  if (message.packetId == 0 || !dup)
+  {
+    message.packetId = nextPacketId++;
+    if (nextPacketId == 0)
+      nextPacketId = 1;
+  }
+
+  // Variable header right in front of the payload, then the fixed header in front of that
+  size_t topicLength = strlen(topic);
+  uint8_t *start = message.packet + MQTT_PUBLISH_HEADROOM - (2 + topicLength + 2);
+  uint8_t *out = putString(start, topic);
+  *out++ = message.packetId >> 8;
+  *out++ = message.packetId & 0xff;
+
+  uint32_t remaining = 2 + topicLength + 2 + message.length;
+  uint8_t fixed[5];
+  fixed[0] = 0x32 | (dup ? 0x08 : 0);
+  uint8_t fixedLength = 1 + encodeLength(remaining, fixed + 1);
+  start -= fixedLength;
+  memcpy(start, fixed, fixedLength);
+
+  size_t total = fixedLength + remaining;
+  if (client.write(start, total) != total)
+    return false;
+
+  message.state = MQTT_MSG_INFLIGHT;
+  message.sentMs = lastSendMs = now;
+  publisherStats.published++;
+  publisherStats.payloadBytes += message.length;
+  if (dup)
+    publisherStats.retransmits++;
+
+  uint8_t inflight = 0;
+  for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    inflight += messages[i].state == MQTT_MSG_INFLIGHT;
+  publisherStats.maxInflight = max(publisherStats.maxInflight, inflight);
+  return true;
+}
+
+void MqttPublisher::readPackets(uint32_t now)
+{
+  while (client.available() > 0)
+  {
+    int c = client.read();
+    if (c < 0)
+      break;
+
+    if (rxStage == 0)
+    {
+      rxHeader = c;
+      rxRemaining = 0;
+      rxShift = 0;
+      rxLength = 0;
+      rxStage = 1;
+    }
+    else if (rxStage == 1)
+    {
+      rxRemaining |= (uint32_t)(c & 0x7f) << rxShift;
+      rxShift += 7;
+      if (c & 0x80)
+        continue;
+      rxStage = 2;
+      if (rxRemaining == 0)
+        handlePacket(now);
+    }
+    else
+    {
+      // Anything longer than an acknowledgement is skipped past
+      if (rxLength < sizeof(rxBuf))
+        rxBuf[rxLength] = c;
+      if (++rxLength == rxRemaining)
+        handlePacket(now);
+    }
+  }
+}
+
+void MqttPublisher::handlePacket(uint32_t now)
+{
+  rxStage = 0;
+  switch (rxHeader >> 4)
+  {
+  case 2:
+  {
+    // CONNACK: session present flag and return code
+    if (rxLength < 2 || rxBuf[1] != 0)
+    {
+      LOG_WARN("MQTT connection refused, code %u", rxLength >= 2 ? rxBuf[1] : 0xff);
+      drop("refused");
+      return;
+    }
+    bool resumed = rxBuf[0] & 1;
+    state = MQTT_CONNECTED;
+    reconnectMs = MQTT_RECONNECT_MS;
+    if (resumed)
+      publisherStats.sessionsResumed++;
+    LOG_INFO("MQTT connected to %s:%u, session %s", host, port, resumed ? "resumed" : "new");
+
+    // Messages the broker may not have acknowledged go again, in their original order
+    for (MqttMessage_t *message = oldest(MQTT_MSG_INFLIGHT); message != nullptr;)
+    {
+      uint32_t seq = message->seq;
+      if (!sendPublish(*message, true, now))
+      {
+        drop("resend failed");
+        return;
+      }
+      message = nullptr;
+      for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; i++)
+      {
+        MqttMessage_t &m = messages[i];
+        if (m.state == MQTT_MSG_INFLIGHT && (int32_t)(m.seq - seq) > 0 &&
+            (message == nullptr || (int32_t)(m.seq - message->seq) < 0))
+          message = &m;
+      }
+    }
+    break;
+  }
+  case 4:
+  {
+    // PUBACK
+    uint16_t packetId = rxLength >= 2 ? (rxBuf[0] << 8) | rxBuf[1] : 0;
+    for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+      MqttMessage_t &message = messages[i];
+      if (message.state != MQTT_MSG_INFLIGHT || message.packetId != packetId)
+        continue;
+      uint32_t elapsed = now - message.sentMs;
+      publisherStats.acked++;
+      publisherStats.lastAckMs = elapsed;
+      publisherStats.maxAckMs = max(publisherStats.maxAckMs, elapsed);
+      publisherStats.totalAckMs += elapsed;
+      message.state = MQTT_MSG_FREE;
+      message.packetId = 0;
+      break;
+    }
+    break;
+  }
+  case 13:
+    // PINGRESP
+    pingPending = false;
+    break;
+  default:
+    break;
+  }
+}
+
+void MqttPublisher::drop(const char *reason)
+{
+  if (state != MQTT_DISCONNECTED)
+  {
+    LOG_WARN("MQTT connection dropped: %s", reason);
+    publisherStats.drops++;
+  }
+  client.stop();
+  state = MQTT_DISCONNECTED;
+  pingPending = false;
+}
+
+void MqttPublisher::poll()
+{
+  if (host[0] == '\0' || messages == nullptr)
+    return;
+
+  uint32_t now = millis();
+
+  // A batch that got old enough goes out with what it has
+  MqttMessage_t *open = oldest(MQTT_MSG_OPEN);
+  if (open != nullptr && open->records > 0 && flushIntervalMs > 0 && now - open->openedMs >= flushIntervalMs)
+    close(*open);
+
+  if (state != MQTT_DISCONNECTED && (WiFi.status() != WL_CONNECTED || !client.connected()))
+    drop("connection lost");
+
+  if (state == MQTT_DISCONNECTED)
+  {
+    if (WiFi.status() == WL_CONNECTED && (!attempted || now - lastAttemptMs >= reconnectMs))
+      connect(now);
+    return;
+  }
+
+  readPackets(now);
+  if (state == MQTT_CONNECTING)
+  {
+    if (now - connectStartedMs >= MQTT_ACK_TIMEOUT_MS)
+      drop("no CONNACK");
+    return;
+  }
+  if (state != MQTT_CONNECTED)
+    return;
+
+  // Pipelined: queued messages go out without waiting for the PUBACKs of those before them
+  for (MqttMessage_t *message = oldest(MQTT_MSG_QUEUED); message != nullptr; message = oldest(MQTT_MSG_QUEUED))
+  {
+    if (!sendPublish(*message, false, now))
+    {
+      drop("PUBLISH not sent");
+      return;
+    }
+  }
+
+  // A missing acknowledgement means a broken connection, the reconnect resends
+  MqttMessage_t *inflight = oldest(MQTT_MSG_INFLIGHT);
+  if (inflight != nullptr && now - inflight->sentMs >= MQTT_ACK_TIMEOUT_MS)
+  {
+    drop("PUBACK timeout");
+    return;
+  }
+
+  if (keepAliveS == 0)
+    return;
+  if (pingPending && now - pingSentMs >= (uint32_t)keepAliveS * 1000)
+  {
+    drop("PINGRESP timeout");
+    return;
+  }
+  // Ping a bit before the broker's keep-alive runs out
+  if (!pingPending && now - lastSendMs >= (uint32_t)keepAliveS * 750)
+  {
+    static const uint8_t pingreq[] = {0xc0, 0x00};
+    if (client.write(pingreq, sizeof(pingreq)) != sizeof(pingreq))
+    {
+      drop("PINGREQ not sent");
+      return;
+    }
+    pingPending = true;
+    pingSentMs = lastSendMs = now;
+    publisherStats.pings++;
+  }
+}
+
+bool MqttPublisher::flush(uint32_t timeoutMs)
+{
+  MqttMessage_t *open = oldest(MQTT_MSG_OPEN);
+  if (open != nullptr)
+    close(*open);
+
+  uint32_t start = millis();
+  while (!idle() && millis() - start < timeoutMs)
+  {
+    poll();
+    delay(10);
+  }
+  return idle();
+}
+
+void MqttPublisher::disconnect()
+{
+  if (state == MQTT_CONNECTED)
+  {
+    static const uint8_t packet[] = {0xe0, 0x00};
+    client.write(packet, sizeof(packet));
+  }
+  client.stop();
+  state = MQTT_DISCONNECTED;
+}
+
+void MqttPublisher::printStats(Print &out) const
+{
+  uint8_t inflight = 0;
+  uint16_t waiting = 0;
+  for (uint8_t i = 0; messages != nullptr && i < MQTT_INFLIGHT_MAX; i++)
+  {
+    const MqttMessage_t &message = messages[i];
+    inflight += message.state == MQTT_MSG_INFLIGHT;
+    if (message.state != MQTT_MSG_FREE)
+      waiting += message.records;
+  }
+  out.printf("mqtt %s connects %u resumed %u drops %u published %u acked %u resent %u records %u refused %u "
+             "waiting %u in flight %u max %u ack last %u ms max %u ms avg %u ms pings %u\n",
+             state == MQTT_CONNECTED ? "up" : "down", publisherStats.connects, publisherStats.sessionsResumed,
+             publisherStats.drops, publisherStats.published, publisherStats.acked, publisherStats.retransmits,
+             publisherStats.records, publisherStats.refused, waiting, inflight, publisherStats.maxInflight,
+             publisherStats.lastAckMs, publisherStats.maxAckMs,
+             publisherStats.acked > 0 ? (uint32_t)(publisherStats.totalAckMs / publisherStats.acked) : 0,
+             publisherStats.pings);
+}
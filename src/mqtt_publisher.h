@@ -0,0 +1,164 @@
+#ifndef __MQTT_PUBLISHER_H__
+#define __MQTT_PUBLISHER_H__
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include "config.h"
+#include "line_protocol.h"
+#include "sample_record.h"
+
+//
+// Binary payloads start with this header, followed by `count` SampleRecord_t exactly as the offline
+// log stores them: packed, little-endian, each sealed with its own CRC-8
+//
+#define MQTT_BINARY_VERSION 1
+
+typedef struct __attribute__((packed))
+{
+  char magic[2]; // "AG"
+  uint8_t version;
+  uint8_t count;
+} MqttBinaryHeader_t;
+
+// Fixed header, topic and packet id of a PUBLISH are written in front of the payload
+#define MQTT_TOPIC_MAX 64
+#define MQTT_PUBLISH_HEADROOM (5 + 2 + MQTT_TOPIC_MAX + 2)
+
+typedef enum
+{
+  MQTT_MSG_FREE = 0,
+  MQTT_MSG_OPEN,
+  MQTT_MSG_QUEUED,
+  MQTT_MSG_INFLIGHT
+} MqttMessageState_t;
+
+typedef struct
+{
+  uint8_t state;
+  uint8_t records;
+  uint16_t packetId;
+  uint16_t length;
+  uint32_t seq;
+  uint32_t openedMs;
+  uint32_t sentMs;
+  uint8_t packet[MQTT_PUBLISH_HEADROOM + MQTT_PAYLOAD_MAX];
+} MqttMessage_t;
+
+typedef enum
+{
+  MQTT_DISCONNECTED = 0,
+  MQTT_CONNECTING,
+  MQTT_CONNECTED
+} MqttState_t;
+
+typedef struct
+{
+  uint32_t connects;
+  uint32_t sessionsResumed;
+  uint32_t drops;
+  uint32_t published;
+  uint32_t acked;
+  uint32_t retransmits;
+  uint32_t records;
+  uint32_t refused;
+  uint64_t payloadBytes;
+  uint8_t maxInflight;
+  uint32_t lastAckMs;
+  uint32_t maxAckMs;
+  uint64_t totalAckMs;
+  uint32_t pings;
+} MqttStats_t;
+
+//
+// Publishes batches of sample records to one MQTT 3.1.1 topic with QoS 1, as line protocol or
+// binary records. The connection is kept open with keep-alive pings, on a persistent session
+// (clean session off) so the broker keeps the session state across reconnects. Every batch is a
+// message in a fixed pool; queued messages are sent back to back without waiting for the PUBACKs
+// of the earlier ones, so up to MQTT_INFLIGHT_MAX acknowledgements are pipelined. A message stays in
+// the pool until acknowledged and is resent with the DUP flag after a reconnect. The pool takes
+// about 5 KB and is only allocated by begin(), devices writing over HTTP or UDP never pay for it.
+//
+class MqttPublisher
+{
+public:
+  MqttPublisher();
+
+  void begin(const char *host, uint16_t port, const char *clientId, const char *username, const char *password,
+             const char *topic, uint16_t keepAliveS, uint8_t format, uint16_t batchSize, uint16_t flushIntervalSec,
+             const LineProtocolEncoder *encoder);
+
+  // False when all messages are taken, the record is then the caller's to keep
+  bool add(const SampleRecord_t &record);
+  // A line protocol line of another measurement; binary messages only carry records and leave it out
+  bool addLine(const char *line);
+  // Adds `count` records and sends them as soon as possible
+  bool addBatch(const SampleRecord_t *records, uint16_t count);
+  // Marks everything added so far, acknowledged() tells when the broker has all of it
+  uint32_t mark() const { return nextSeq; }
+  bool acknowledged(uint32_t mark) const;
+
+  // Connects, reads acknowledgements, sends due batches and keeps the connection alive
+  void poll();
+  // Polls until every message is acknowledged or `timeoutMs` passed
+  bool flush(uint32_t timeoutMs);
+  void disconnect();
+
+  bool connected() const { return state == MQTT_CONNECTED; }
+  // No message waiting to be sent or acknowledged
+  bool idle() const;
+  // Whether adding `newRecords` more at `atMs` has a message to send
+  bool batchDue(uint32_t atMs, uint16_t newRecords) const;
+
+  const MqttStats_t &stats() const { return publisherStats; }
+  void printStats(Print &out) const;
+
+private:
+  MqttMessage_t *openMessage();
+  MqttMessage_t *oldest(MqttMessageState_t state);
+  const MqttMessage_t *find(MqttMessageState_t state) const;
+  bool append(MqttMessage_t &message, const SampleRecord_t &record);
+  void close(MqttMessage_t &message);
+
+  void connect(uint32_t now);
+  bool sendPublish(MqttMessage_t &message, bool dup, uint32_t now);
+  void readPackets(uint32_t now);
+  void handlePacket(uint32_t now);
+  void drop(const char *reason);
+
+  WiFiClient client;
+  const LineProtocolEncoder *encoder;
+  char host[64];
+  char clientId[32];
+  char username[32];
+  char password[64];
+  char topic[MQTT_TOPIC_MAX];
+  uint16_t port;
+  uint16_t keepAliveS;
+  uint8_t format;
+  uint16_t batchSize;
+  uint32_t flushIntervalMs;
+
+  MqttState_t state;
+  bool attempted;
+  uint32_t lastAttemptMs;
+  uint32_t reconnectMs;
+  uint32_t connectStartedMs;
+  uint32_t lastSendMs;
+  bool pingPending;
+  uint32_t pingSentMs;
+  uint16_t nextPacketId;
+  uint32_t nextSeq;
+
+  // Incoming packet being parsed; the broker only ever sends us a few bytes per packet
+  uint8_t rxStage;
+  uint8_t rxHeader;
+  uint32_t rxRemaining;
+  uint8_t rxShift;
+  uint32_t rxLength;
+  uint8_t rxBuf[4];
+
+  MqttMessage_t *messages;
+  MqttStats_t publisherStats;
+};
+
+#endif //__MQTT_PUBLISHER_H__
@@ -0,0 +1,797 @@
+/**
+ * Host runner for `pio run -e native`.
+ *
+ * Runs the firmware's setup()/loop() against the mocks in lib/NativeMocks on a virtual clock and
+ * reports, per sample period, the host CPU time spent in loop(), the heap allocations made and the
+ * bytes sent over HTTP.
+ *
+ * With `"sleep_mode": "deep"` setup() ends in ESP.deepSleep(), which the mock turns into an exception
+ * after advancing the clock by the sleep time. Every sample period is then one wake, setup() running
+ * again from reset, and the runner also reports how long each wake kept the device awake.
+ *
+ * The firmware's heap allocations are placed on a model of the ESP8266 heap (lib/NativeMocks/src/MockHeap.h),
+ * which is what ESP.getFreeHeap() and ESP.getHeapStats() report, and the runner reports its largest free
+ * block and fragmentation at the end and, for --days, once per simulated day. The modelled heap is what
+ * the original sketch had free on a D1 mini less the static RAM the firmware has added since
+ * (FIRMWARE_STATIC_BYTES), or --heap-bytes.
+ *
+ * Usage: .pio/build/native/program [--cycles N | --days N] [--config PATH] [--outage START:LEN] [--corrupt-pms N]
+ *                                   [--drop-s8 N] [--tick MS] [--state DIR] [--scrape MS] [--forward]
+ *                                   [--trace PATH] [--max-loop-allocs N] [--heap-bytes N] [--verbose]
+ *                                   [--bench-gzip N] [--bench-line N]
+ *
+ *   --cycles N         sample periods to simulate (default 360, one hour at a 10 s period)
+ *   --days N           simulate N days of virtual time instead, e.g. 30 with --tick 1000 to check that the
+ *                      largest free block stays put over weeks of uptime
+ *   --config PATH      config.json to load (default data/config.json, then data/config.json.sample)
+ *   --outage START:LEN take WiFi down for LEN sample periods (or wakes) starting at period START
+ *   --corrupt-pms N    corrupt every Nth PMS5003 frame
+ *   --drop-s8 N        drop every Nth SenseAir S8 reply
+ *   --tick MS          longest virtual time between two loop() calls (default 10), like the
+ *                      device spinning loop() while the serial peripherals stream data
+ *   --state DIR        keep the files the firmware caches across reboots (config snapshot, WiFi
+ *                      lease, TLS session) in DIR between runs, to compare a first boot with the following ones
+ *   --scrape MS        scrape the `metrics_port` endpoint every MS of virtual time, like Prometheus
+ *   --forward          send requests for real to the http:// url from the config, and datagrams
+ *                      to the udp:// one, e.g. tools/influx_standin.py [--udp-port]; MQTT goes to
+ *                      the configured broker, e.g. mosquitto or tools/mqtt_standin.py, and the
+ *                      metrics endpoint listens on its port on localhost instead
+ *   --trace PATH       write the event trace to PATH at the end, for tools/trace_to_chrome.py; needs
+ *                      TRACE_ENABLED, which env:native builds with
+ *   --max-loop-allocs N exit with status 2 if a loop() after the boot sequence made more than N heap
+ *                      allocations, e.g. 0 to hold the steady state at none; needs ALLOC_TRACKING, which
+ *                      env:native_alloc builds with. Call sites print as addresses, for
+ *                      `addr2line -i -e program ADDRESS`
+ *   --heap-bytes N     size of the modelled heap, e.g. ESP.getFreeHeap() of a device at the start of
+ *                      setup() less what the SDK takes for WiFi (about 4 KB)
+ *   --verbose          show the firmware's Serial output
+ *   --bench-gzip N     only compress N batches of each size from 1 to 32 lines like the firmware's and
+ *                      report the compression ratio and host CPU time per batch
+ *   --bench-line N     only encode N records through LineProtocolEncoder and through the Point and
+ *                      toLineProtocol() path it replaced, and report bytes, heap allocations and host
+ *                      CPU time per point for each
+ **/
+
+#ifdef NATIVE
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <HttpSink.h>
+#include <LittleFS.h>
+#include <SensorSim.h>
+#include <SoftwareSerial.h>
+#include <U8g2lib.h>
+#include <WiFiClientSecure.h>
+#include <WiFiUdp.h>
+#include <MockHeap.h>
+#include <MqttBrokerSim.h>
+#include <Point.h>
+#include <ScrapeSim.h>
+
+#include <chrono>
+#if ALLOC_TRACKING && defined(__linux__)
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
+#include <new>
+#include <string>
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "gzip_deflate.h"
+#include "http_writer.h"
+#include "line_protocol.h"
+#include "scheduler.h"
+#include "trace.h"
+
+//
+// Static RAM the firmware has added to the original sketch, out of the DRAM the heap would otherwise
+// get: the .bss and .data of src/ in a d1_mini build without tracing, 12.6 KB in the native objects
+// (`nm -S`) less what only the mocks hold there (the SoftwareSerial RX buffers the device allocates
+// on the heap) and the objects the sketch already had. The buffers of optional features are
+// allocated when configured and land on the modelled heap instead. Tracing and allocation tracking
+// add their tables on top
+//
+#define FIRMWARE_STATIC_BYTES 10240
+
+extern Scheduler scheduler;
+extern SoftwareSerial pmsSerial;
+extern SoftwareSerial co2Serial;
+extern U8G2_SH1106_128X64_NONAME_F_HW_I2C display;
+
+static Pms5003Sim pmsSim;
+static S8Sim s8Sim;
+
+void setup();
+void loop();
+
+// How long the boot sequence may take to start sampling
+#define BOOT_LIMIT_MS 120000
+
+// Files the firmware keeps across reboots, besides the offline log
+static const char *stateFiles[] = {"/config.bin", "/wifi.bin", "/tls.bin"};
+
+static uint64_t allocations = 0;
+static uint64_t allocatedBytes = 0;
+
+#if ALLOC_TRACKING && defined(__linux__)
+extern "C" char __executable_start;
+extern "C" char etext;
+
+// Whether the code at `address` is the standard library's, e.g. std::string behind the mocked String,
+// which allocates on behalf of its caller. Needs the symbols exported (-rdynamic), otherwise every
+// address counts as the program's own; looked up once per address
+static bool inStandardLibrary(uintptr_t address)
+{
+  static struct
+  {
+    uintptr_t address;
+    bool standard;
+  } cache[512];
+  auto &entry = cache[(address >> 2) % 512];
+  if (entry.address != address)
+  {
+    Dl_info info;
+    const char *name = dladdr((void *)address, &info) && info.dli_sname != nullptr ? info.dli_sname : "";
+    entry.address = address;
+    entry.standard = strncmp(name, "_ZNSt", 5) == 0 || strncmp(name, "_ZNKSt", 6) == 0 || strncmp(name, "_ZSt", 4) == 0;
+  }
+  return entry.standard;
+}
+
+// The first return address above operator new in the program's own code. Relative to where the
+// program was loaded, as addr2line -e program wants it
+__attribute__((noinline)) static const void *allocationSite()
+{
+  void *frames[12];
+  int n = backtrace(frames, 12);
+  uintptr_t start = (uintptr_t)&__executable_start;
+  for (int i = 2; i < n; i++)
+  {
+    uintptr_t address = (uintptr_t)frames[i];
+    if (address < start || address >= (uintptr_t)&etext || inStandardLibrary(address))
+      continue;
+#ifdef __PIE__
+    address -= start;
+#endif
+    return (const void *)address;
+  }
+  return nullptr;
+}
+#define ALLOCATION_SITE() allocationSite()
+#else
+#define ALLOCATION_SITE() __builtin_return_address(0)
+#endif
+
+static void *allocate(size_t size, const void *site)
+{
+  allocations++;
+  allocatedBytes += size;
+  void *ptr = mockHeap.malloc(size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+#if ALLOC_TRACKING
+  // Like the heap model, only what the firmware allocates
+  if (mockHeap.isTracking())
+    allocTracker.allocated(ptr, size, site);
+#else
+  (void)site;
+#endif
+  return ptr;
+}
+
+// The site is looked up here, where the caller is the next frame up
+void *operator new(size_t size)
+{
+  return allocate(size, ALLOC_TRACKING ? ALLOCATION_SITE() : nullptr);
+}
+
+void *operator new[](size_t size)
+{
+  return allocate(size, ALLOC_TRACKING ? ALLOCATION_SITE() : nullptr);
+}
+
+static void release(void *ptr)
+{
+#if ALLOC_TRACKING
+  if (mockHeap.isTracking())
+    allocTracker.freed(ptr);
+#endif
+  mockHeap.free(ptr);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  release(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+  release(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  release(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+  release(ptr);
+}
+
+typedef struct
+{
+  uint64_t cpuUs;
+  uint64_t allocations;
+  uint64_t bytesSent;
+  uint64_t awakeMs;
+} CycleStats_t;
+
+static void printSummary(const char *label, const std::vector<CycleStats_t> &cycles, uint64_t CycleStats_t::*field)
+{
+  uint64_t total = 0;
+  uint64_t worst = 0;
+  for (const CycleStats_t &cycle : cycles)
+  {
+    total += cycle.*field;
+    worst = max(worst, cycle.*field);
+  }
+
+  printf("%-22s avg %10.1f  max %10llu  total %12llu\n", label,
+         cycles.empty() ? 0.0 : (double)total / cycles.size(),
+         (unsigned long long)worst, (unsigned long long)total);
+}
+
+static void printTotals(const char *stateDir, const char *tracePath);
+
+static void printHeap(const char *label, const MockHeapStats_t &lows)
+{
+  printf("%s free %u B largest block %u B fragmentation %u%%, lowest free %u B smallest largest block %u B "
+         "worst fragmentation %u%% allocations %llu didn't fit %u\n",
+         label, mockHeap.freeBytes(), mockHeap.maxFreeBlock(), mockHeap.fragmentation(), lows.lowestFree,
+         lows.lowestMaxBlock, lows.maxFragmentation, (unsigned long long)lows.allocations, lows.outOfMemory);
+}
+
+// Print onto a host file, for the trace dump and the allocation report
+class FilePrint : public Print
+{
+public:
+  explicit FilePrint(FILE *file) : file(file) {}
+
+  size_t write(uint8_t c) override { return fputc(c, file) == EOF ? 0 : 1; }
+  size_t write(const uint8_t *buffer, size_t size) override { return fwrite(buffer, 1, size, file); }
+  using Print::write;
+
+private:
+  FILE *file;
+};
+
+static void writeTrace(const char *path)
+{
+#if TRACE_ENABLED
+  FILE *file = fopen(path, "w");
+  if (file == nullptr)
+  {
+    fprintf(stderr, "can't write the trace to %s\n", path);
+    return;
+  }
+  FilePrint out(file);
+  trace.dump(out);
+  fclose(file);
+  printf("trace %u events written to %s\n", trace.recorded(), path);
+#else
+  fprintf(stderr, "--trace needs a build with -DTRACE_ENABLED=1, no trace written to %s\n", path);
+#endif
+}
+
+// Exit status of a run with --max-loop-allocs: fails once a steady-state loop() allocated more than `limit`
+static int checkLoopAllocations(int32_t limit)
+{
+  if (limit < 0)
+    return 0;
+#if ALLOC_TRACKING
+  const AllocStats_t &alloc = allocTracker.stats();
+  if (alloc.maxLoopAllocations > (uint32_t)limit)
+  {
+    fprintf(stderr, "a steady-state loop() made %u allocations, more than the %d allowed\n",
+            alloc.maxLoopAllocations, limit);
+    return 2;
+  }
+  return 0;
+#else
+  fprintf(stderr, "--max-loop-allocs needs a build with -DALLOC_TRACKING=1\n");
+  return 2;
+#endif
+}
+
+static uint64_t httpBytes()
+{
+  return httpSink.stats().bodyBytes + httpSink.stats().headerBytes;
+}
+
+// Deep sleep: runs setup() once per wake until `cycles` wakes have been recorded in `stats`. `mode`
+// is what the last sleep asked the radio to wake up with
+static bool simulateWakes(uint32_t cycles, uint64_t endUs, uint32_t outageStart, uint32_t outageLength,
+                          std::vector<CycleStats_t> &stats, RFMode mode, uint32_t &radioWakes)
+{
+  while (endUs > 0 ? mockClockMicros() < endUs : stats.size() < cycles)
+  {
+    uint32_t wake = stats.size();
+    if (mode != RF_DISABLED)
+      radioWakes++;
+    WiFi.setAvailable(!(outageLength > 0 && wake >= outageStart && wake < outageStart + outageLength));
+
+    uint64_t clockBefore = mockClockMicros();
+    uint64_t allocationsBefore = allocations;
+    uint64_t bytesBefore = httpBytes();
+    MockDeepSleep sleep = {};
+    auto start = std::chrono::steady_clock::now();
+    mockHeap.setTracking(true);
+    try
+    {
+      setup();
+    }
+    catch (const MockDeepSleep &slept)
+    {
+      sleep = slept;
+    }
+    mockHeap.setTracking(false);
+    if (sleep.sleepUs == 0)
+    {
+      fprintf(stderr, "wake %u returned from setup() without going back to sleep\n", wake);
+      return false;
+    }
+
+    CycleStats_t cycle;
+    cycle.cpuUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    cycle.allocations = allocations - allocationsBefore;
+    cycle.bytesSent = httpBytes() - bytesBefore;
+    cycle.awakeMs = (mockClockMicros() - clockBefore - sleep.sleepUs) / 1000;
+    stats.push_back(cycle);
+    mode = sleep.mode;
+  }
+  return true;
+}
+
+// The measurement and tags of the firmware's points, for the benchmarks
+static void beginBenchEncoder(LineProtocolEncoder &encoder)
+{
+  encoder.begin("airgradient");
+  encoder.addTag("device", "native");
+  encoder.addTag("id", "c0ffee");
+  encoder.addTag("deviceName", "Office");
+}
+
+static void beginBenchRecord(SampleRecord_t &record)
+{
+  record = {};
+  record.timestamp = 1700000000;
+  record.samples = 1;
+  record.s8AbcHours = 180;
+  record.rssi = -62;
+  srand(1);
+}
+
+// Readings drift like the sensor simulations, so consecutive lines differ in their values only
+static void nextBenchRecord(SampleRecord_t &record)
+{
+  record.timestamp += 10;
+  uint16_t pm = 5 + rand() % 20;
+  for (uint8_t w = 0; w < PMS_DATA_WORDS; w++)
+    record.pms[w] = pm * (w + 1) + rand() % 8;
+  record.co2 = 550 + rand() % 100;
+  record.tempC = 2150 + rand() % 100;
+  record.humidity = 4300 + rand() % 300;
+  sampleRecordSeal(record);
+}
+
+static void benchGzip(uint32_t batches)
+{
+  static const uint8_t batchSizes[] = {1, 2, 4, 6, 8, 16, 32};
+  static char body[32 * LINE_PROTOCOL_MAX];
+  static uint8_t compressed[sizeof(body) + GZIP_OVERHEAD + sizeof(body) / 8];
+  static DeflateTables_t tables;
+
+  LineProtocolEncoder encoder;
+  beginBenchEncoder(encoder);
+  SampleRecord_t record;
+  beginBenchRecord(record);
+
+  printf("%6s %10s %10s %7s %10s %s\n", "lines", "raw B", "gzip B", "ratio", "host us", "per batch");
+  for (uint8_t size : batchSizes)
+  {
+    uint64_t rawBytes = 0;
+    uint64_t compressedBytes = 0;
+    uint64_t cpuUs = 0;
+    uint32_t oversized = 0;
+    for (uint32_t batch = 0; batch < batches; batch++)
+    {
+      size_t length = 0;
+      for (uint8_t i = 0; i < size; i++)
+      {
+        nextBenchRecord(record);
+        if (length > 0)
+          body[length++] = '\n';
+        length += encoder.encode(record, body + length, sizeof(body) - length);
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      size_t n = gzipCompress((const uint8_t *)body, length, compressed, sizeof(compressed), tables);
+      cpuUs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+      rawBytes += length;
+      compressedBytes += n;
+      if (n > GZIP_BODY_MAX)
+        oversized++;
+    }
+    printf("%6u %10.1f %10.1f %6.2fx %10.2f%s\n", size, (double)rawBytes / batches, (double)compressedBytes / batches,
+           compressedBytes > 0 ? (double)rawBytes / compressedBytes : 0.0, cpuUs / 1000.0 / batches,
+           oversized > 0 ? "  over GZIP_BODY_MAX, sent uncompressed" : "");
+  }
+}
+
+// One point of the benchmark's record written through the Point the firmware used before
+// LineProtocolEncoder: global, tags set once, fields cleared and added again for every sample
+static String pointLine(Point &point, const SampleRecord_t &record)
+{
+  static const char *const pmsNames[PMS_DATA_WORDS] = {
+      "pm1.0_cf1", "pm2.5_cf1", "pm10_cf1", "pm1.0", "pm2.5", "pm10", "pc0.3",
+      "pc0.5",     "pc1.0",     "pc2.5",    "pc5.0", "pc10",  "pms_status"};
+
+  point.clearFields();
+  for (uint8_t w = 0; w < PMS_DATA_WORDS; w++)
+    point.addField(pmsNames[w], (int)record.pms[w]);
+  point.addField("co2", (int)record.co2);
+  point.addField("s8_status", (int)record.s8Status);
+  point.addField("s8_abc_hours", (int)record.s8AbcHours);
+  float tempC = record.tempC / 100.0f;
+  point.addField("temp_c", tempC);
+  point.addField("temp_f", tempC * 1.8f + 32);
+  point.addField("humidity", record.humidity / 100.0f);
+  point.addField("rssi", (int)record.rssi);
+  point.setTime((unsigned long)record.timestamp);
+  return point.toLineProtocol();
+}
+
+static void benchLine(uint32_t points)
+{
+  static char line[LINE_PROTOCOL_MAX];
+  SampleRecord_t record;
+
+  // Both paths run with the heap model tracking, so their allocations count like the firmware's
+  LineProtocolEncoder encoder;
+  beginBenchEncoder(encoder);
+  beginBenchRecord(record);
+  uint64_t encoderBytes = 0;
+  uint64_t encoderNs = 0;
+  uint64_t allocationsBefore = mockHeap.stats().allocations;
+  mockHeap.setTracking(true);
+  for (uint32_t i = 0; i < points; i++)
+  {
+    nextBenchRecord(record);
+    auto start = std::chrono::steady_clock::now();
+    encoderBytes += encoder.encode(record, line, sizeof(line));
+    encoderNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+  mockHeap.setTracking(false);
+  uint64_t encoderAllocations = mockHeap.stats().allocations - allocationsBefore;
+
+  beginBenchRecord(record);
+  uint64_t pointBytes = 0;
+  uint64_t pointNs = 0;
+  uint32_t mismatches = 0;
+  allocationsBefore = mockHeap.stats().allocations;
+  mockHeap.setTracking(true);
+  {
+    Point point("airgradient");
+    point.addTag("device", "native");
+    point.addTag("id", "c0ffee");
+    point.addTag("deviceName", "Office");
+    for (uint32_t i = 0; i < points; i++)
+    {
+      nextBenchRecord(record);
+      auto start = std::chrono::steady_clock::now();
+      String text = pointLine(point, record);
+      pointNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+      pointBytes += text.length();
+
+      // float arithmetic may round the last digit of temp_f differently
+      encoder.encode(record, line, sizeof(line));
+      if (text != line)
+        mismatches++;
+    }
+  }
+  mockHeap.setTracking(false);
+  uint64_t pointAllocations = mockHeap.stats().allocations - allocationsBefore;
+
+  printf("%-8s %12s %12s %12s\n", "path", "B/point", "allocs/point", "host us/point");
+  printf("%-8s %12.1f %12.2f %12.3f\n", "encoder", (double)encoderBytes / points,
+         (double)encoderAllocations / points, encoderNs / 1000.0 / points);
+  printf("%-8s %12.1f %12.2f %12.3f\n", "Point", (double)pointBytes / points, (double)pointAllocations / points,
+         pointNs / 1000.0 / points);
+  printf("%u of %u lines differ between the two\n", mismatches, points);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t cycles = 360;
+  uint32_t days = 0;
+  const char *configPath = nullptr;
+  const char *stateDir = nullptr;
+  const char *tracePath = nullptr;
+  int32_t maxLoopAllocations = -1;
+  uint32_t outageStart = 0;
+  uint32_t outageLength = 0;
+  uint32_t tickMs = 10;
+  bool verbose = false;
+  uint32_t benchBatches = 0;
+  uint32_t benchPoints = 0;
+  uint32_t heapBytes = MOCK_HEAP_BYTES - FIRMWARE_STATIC_BYTES;
+#if TRACE_ENABLED
+  heapBytes -= sizeof(trace);
+#endif
+#if ALLOC_TRACKING
+  heapBytes -= sizeof(allocTracker);
+#endif
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+      cycles = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--days") == 0 && i + 1 < argc)
+      days = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc)
+      configPath = argv[++i];
+    else if (strcmp(argv[i], "--outage") == 0 && i + 1 < argc)
+      sscanf(argv[++i], "%u:%u", &outageStart, &outageLength);
+    else if (strcmp(argv[i], "--corrupt-pms") == 0 && i + 1 < argc)
+      pmsSim.setCorruptEvery(strtoul(argv[++i], nullptr, 10));
+    else if (strcmp(argv[i], "--drop-s8") == 0 && i + 1 < argc)
+      s8Sim.setDropEvery(strtoul(argv[++i], nullptr, 10));
+    else if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc)
+      tickMs = max(1ul, strtoul(argv[++i], nullptr, 10));
+    else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc)
+      stateDir = argv[++i];
+    else if (strcmp(argv[i], "--scrape") == 0 && i + 1 < argc)
+      scrapeSim.setInterval(strtoul(argv[++i], nullptr, 10));
+    else if (strcmp(argv[i], "--forward") == 0)
+    {
+      httpSink.setForwarding(true);
+      udpSink.setForwarding(true);
+      mqttBroker.setForwarding(true);
+      scrapeSim.setForwarding(true);
+    }
+    else if (strcmp(argv[i], "--max-loop-allocs") == 0 && i + 1 < argc)
+      maxLoopAllocations = strtol(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+      tracePath = argv[++i];
+    else if (strcmp(argv[i], "--heap-bytes") == 0 && i + 1 < argc)
+      heapBytes = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--verbose") == 0)
+      verbose = true;
+    else if (strcmp(argv[i], "--bench-gzip") == 0 && i + 1 < argc)
+      benchBatches = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--bench-line") == 0 && i + 1 < argc)
+      benchPoints = strtoul(argv[++i], nullptr, 10);
+    else
+    {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  mockHeap.setSize(heapBytes);
+
+  if (benchBatches > 0)
+  {
+    benchGzip(benchBatches);
+    return 0;
+  }
+  if (benchPoints > 0)
+  {
+    benchLine(benchPoints);
+    return 0;
+  }
+
+  printf("heap model %u B\n", mockHeap.size());
+  Serial.setQuiet(!verbose);
+  pmsSerial.attach(&pmsSim);
+  co2Serial.attach(&s8Sim);
+
+  LittleFS.begin();
+  bool loaded = configPath != nullptr ? LittleFS.loadFile("/config.json", configPath)
+                                      : LittleFS.loadFile("/config.json", "data/config.json") ||
+                                            LittleFS.loadFile("/config.json", "data/config.json.sample");
+  if (!loaded)
+  {
+    fprintf(stderr, "could not load a config.json\n");
+    return 2;
+  }
+  if (stateDir != nullptr)
+  {
+    for (const char *file : stateFiles)
+      LittleFS.loadFile(file, (std::string(stateDir) + file).c_str());
+  }
+
+  auto bootStart = std::chrono::steady_clock::now();
+  uint32_t bootClock = millis();
+  uint64_t bootClockUs = mockClockMicros();
+  uint64_t bootAllocations = allocations;
+  uint64_t bootBytes = allocatedBytes;
+  uint64_t bootHttpBytes = httpBytes();
+  MockDeepSleep sleep = {};
+  mockHeap.setTracking(true);
+  try
+  {
+    setup();
+  }
+  catch (const MockDeepSleep &slept)
+  {
+    sleep = slept;
+  }
+  mockHeap.setTracking(false);
+  uint64_t bootUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootStart).count();
+  uint64_t bootMs = (mockClockMicros() - bootClockUs - sleep.sleepUs) / 1000;
+  printf("setup: %llu ms virtual, %llu us host, %llu allocations of %llu bytes\n", (unsigned long long)bootMs,
+         (unsigned long long)bootUs, (unsigned long long)(allocations - bootAllocations),
+         (unsigned long long)(allocatedBytes - bootBytes));
+
+  uint64_t endUs = days > 0 ? bootClockUs + days * 86400000000ull : 0;
+  if (sleep.sleepUs > 0)
+  {
+    // The first wake was the setup() above
+    std::vector<CycleStats_t> wakes;
+    wakes.reserve(cycles);
+    wakes.push_back({bootUs, allocations - bootAllocations, httpBytes() - bootHttpBytes, bootMs});
+    uint32_t radioWakes = 1;
+    if (!simulateWakes(cycles, endUs, outageStart, outageLength, wakes, sleep.mode, radioWakes))
+      return 1;
+
+    uint64_t awakeMs = 0;
+    for (const CycleStats_t &wake : wakes)
+      awakeMs += wake.awakeMs;
+    printf("simulated %u deep-sleep wakes, %llu s virtual, awake %.2f%% of the time, %u wakes with the radio on\n",
+           (uint32_t)wakes.size(), (unsigned long long)(mockClockMicros() / 1000000),
+           100.0 * awakeMs / (mockClockMicros() / 1000), radioWakes);
+    printSummary("awake ms/wake", wakes, &CycleStats_t::awakeMs);
+    printSummary("setup cpu us/wake", wakes, &CycleStats_t::cpuUs);
+    printSummary("allocations/wake", wakes, &CycleStats_t::allocations);
+    printSummary("bytes sent/wake", wakes, &CycleStats_t::bytesSent);
+    printTotals(stateDir, tracePath);
+    return checkLoopAllocations(maxLoopAllocations);
+  }
+
+  // The network task is only registered once the boot sequence has the sensors running
+  const Task_t *network = nullptr;
+  bool wifiUp = true;
+
+  std::vector<CycleStats_t> stats;
+  stats.reserve(cycles);
+  CycleStats_t current = {};
+  uint32_t lastRuns = 0;
+  uint64_t lastBytes = httpBytes();
+  uint32_t firstSampleMs = 0;
+  uint64_t firstSampleUs = 0;
+
+  uint32_t day = 0;
+  while (endUs > 0 ? mockClockMicros() < endUs : network == nullptr || network->runs < cycles)
+  {
+    if (network == nullptr)
+    {
+      network = scheduler.findTask("network");
+      if (network == nullptr && millis() - bootClock > BOOT_LIMIT_MS)
+      {
+        fprintf(stderr, "no network task registered after %u ms, boot failed\n", BOOT_LIMIT_MS);
+        return 1;
+      }
+    }
+
+    uint32_t wait = scheduler.msUntilNextTask();
+    if (wait == UINT32_MAX)
+      break;
+    mockClockAdvance(min(wait, tickMs));
+
+    // Only touch the link on outage edges, so the firmware's own association isn't overridden
+    uint32_t period = network != nullptr ? network->runs : 0;
+    bool up = !(outageLength > 0 && period >= outageStart && period < outageStart + outageLength);
+    if (up != wifiUp)
+    {
+      WiFi.setAvailable(up);
+      WiFi.setConnected(up);
+      wifiUp = up;
+    }
+
+    uint64_t allocationsBefore = allocations;
+    auto start = std::chrono::steady_clock::now();
+    mockHeap.setTracking(true);
+    loop();
+    mockHeap.setTracking(false);
+    current.cpuUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    current.allocations += allocations - allocationsBefore;
+
+    if (network != nullptr && network->runs != lastRuns)
+    {
+      if (lastRuns == 0)
+      {
+        firstSampleMs = millis() - bootClock;
+        firstSampleUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootStart).count();
+      }
+      uint64_t bytes = httpBytes();
+      current.bytesSent = bytes - lastBytes;
+      lastBytes = bytes;
+      lastRuns = network->runs;
+      stats.push_back(current);
+      current = {};
+    }
+
+    if (days > 0 && mockClockMicros() - bootClockUs >= (day + 1) * 86400000000ull)
+    {
+      char label[32];
+      snprintf(label, sizeof(label), "day %3u heap", ++day);
+      printHeap(label, mockHeap.windowStats());
+      mockHeap.clearWindow();
+    }
+  }
+
+  printf("boot to first sample: %u ms virtual, %llu us host\n", firstSampleMs, (unsigned long long)firstSampleUs);
+  printf("simulated %u sample periods, %u s virtual\n", (uint32_t)stats.size(), millis() / 1000);
+  printSummary("loop cpu us/period", stats, &CycleStats_t::cpuUs);
+  printSummary("allocations/period", stats, &CycleStats_t::allocations);
+  printSummary("bytes sent/period", stats, &CycleStats_t::bytesSent);
+  printTotals(stateDir, tracePath);
+
+  return checkLoopAllocations(maxLoopAllocations);
+}
+
+static void printTotals(const char *stateDir, const char *tracePath)
+{
+  const HttpSinkStats_t &http = httpSink.stats();
+  const FsStats_t &fs = LittleFS.stats();
+  const DisplayStats_t &oled = display.stats();
+
+  if (stateDir != nullptr)
+  {
+    for (const char *file : stateFiles)
+      LittleFS.saveFile(file, (std::string(stateDir) + file).c_str());
+  }
+  if (tracePath != nullptr)
+    writeTrace(tracePath);
+
+  printf("http requests %u failed %u lines %u body %llu B headers %llu B\n", http.requests, http.failed, http.lines,
+         (unsigned long long)http.bodyBytes, (unsigned long long)http.headerBytes);
+  printf("littlefs writes %u bytes written %llu bytes read %llu\n", fs.writes,
+         (unsigned long long)fs.bytesWritten, (unsigned long long)fs.bytesRead);
+  printf("display frames %u partial updates %u tiles %u i2c %u B\n", oled.frames, oled.partialUpdates, oled.tiles,
+         oled.bytesSent);
+  if (http.gzipBodies > 0)
+    printf("gzip bodies %u inflated to %llu B\n", http.gzipBodies, (unsigned long long)http.inflatedBytes);
+  const UdpSinkStats_t &udp = udpSink.stats();
+  if (udp.datagrams + udp.failed > 0)
+    printf("udp datagrams %u lost %u fragmented %u lines %u bytes %llu largest %u B\n", udp.datagrams, udp.failed,
+           udp.fragmented, udp.lines, (unsigned long long)udp.bytes, udp.largest);
+  const MqttBrokerStats_t &mqtt = mqttBroker.stats();
+  if (mqtt.connects > 0)
+    printf("mqtt connects %u sessions present %u messages %u duplicates %u lines %u records %u payload %llu B\n",
+           mqtt.connects, mqtt.sessionsPresent, mqtt.messages, mqtt.duplicates, mqtt.lines, mqtt.records,
+           (unsigned long long)mqtt.payloadBytes);
+  const ScrapeStats_t &scrapes = scrapeSim.stats();
+  if (scrapes.scrapes + scrapes.missed > 0)
+    printf("metrics scrapes %u ok %u failed %u missed %u samples %u bytes %llu max latency %u ms\n",
+           scrapes.scrapes, scrapes.ok, scrapes.failed, scrapes.missed, scrapes.samples,
+           (unsigned long long)scrapes.bytes, scrapes.maxLatencyMs);
+  if (mockTls.fullHandshakes + mockTls.resumedHandshakes > 0)
+    printf("tls handshakes full %u resumed %u, %llu ms\n", mockTls.fullHandshakes, mockTls.resumedHandshakes,
+           (unsigned long long)mockTls.handshakeMs);
+  const MockUartStats_t &uart = Serial.stats();
+  printf("serial %llu B, %u writes waited for the FIFO, %llu ms in all, longest %u us\n", (unsigned long long)uart.bytes,
+         uart.stalls, (unsigned long long)(uart.stallUs / 1000), uart.maxStallUs);
+  printf("radio on %llu ms, %.1f%% of the time\n", (unsigned long long)WiFi.radioOnMs(),
+         100.0 * WiFi.radioOnMs() / max(1ull, (unsigned long long)(mockClockMicros() / 1000)));
+  printf("heap allocations %llu, %llu bytes total\n", (unsigned long long)allocations, (unsigned long long)allocatedBytes);
+  printHeap("heap model", mockHeap.stats());
+#if ALLOC_TRACKING
+  FilePrint out(stdout);
+  allocTracker.printStats(out);
+#endif
+}
+
+#endif // NATIVE
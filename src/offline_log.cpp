@@ -0,0 +1,276 @@
+#include "offline_log.h"
+#include "logger.h"
+#include "trace.h"
+
+#include <LittleFS.h>
+
+// Bumped whenever SampleRecord_t changes, segments with another magic are discarded on boot
+#define OFFLINE_LOG_MAGIC 0x34574741 // "AGW4"
+#define OFFLINE_CURSOR_PATH OFFLINE_LOG_DIR "/cursor"
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t seq;
+} SegmentHeader_t;
+
+typedef struct
+{
+  uint32_t seq;
+  uint32_t offset;
+} Cursor_t;
+
+static const uint32_t SEGMENT_DATA_START = sizeof(SegmentHeader_t);
+
+static String segmentPath(uint32_t seq)
+{
+  return String(OFFLINE_LOG_DIR "/") + String(seq % OFFLINE_LOG_SEGMENTS) + ".bin";
+}
+
+OfflineLog::OfflineLog()
+    : ready(false), rotateHead(false), tailSeq(0), tailOffset(SEGMENT_DATA_START), headSeq(0), headRecords(0), recordCount(0)
+{
+  memset(&logStats, 0, sizeof(logStats));
+}
+
+bool OfflineLog::begin()
+{
+  if (!LittleFS.exists(OFFLINE_LOG_DIR) && !LittleFS.mkdir(OFFLINE_LOG_DIR))
+  {
+    LOG_ERROR("Offline log: failed to create " OFFLINE_LOG_DIR);
+    return false;
+  }
+
+  bool found = false;
+  uint32_t sizes[OFFLINE_LOG_SEGMENTS];
+
+  for (uint8_t slot = 0; slot < OFFLINE_LOG_SEGMENTS; slot++)
+  {
+    sizes[slot] = 0;
+    String path = segmentPath(slot);
+    File file = LittleFS.open(path, "r");
+    if (!file)
+      continue;
+
+    SegmentHeader_t header;
+    if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != OFFLINE_LOG_MAGIC ||
+        header.seq % OFFLINE_LOG_SEGMENTS != slot)
+    {
+      file.close();
+      LittleFS.remove(path);
+      continue;
+    }
+
+    sizes[slot] = file.size();
+    file.close();
+
+    if (!found || (int32_t)(header.seq - tailSeq) < 0)
+      tailSeq = header.seq;
+    if (!found || (int32_t)(header.seq - headSeq) > 0)
+      headSeq = header.seq;
+    found = true;
+  }
+
+  if (found)
+  {
+    for (uint8_t slot = 0; slot < OFFLINE_LOG_SEGMENTS; slot++)
+    {
+      if (sizes[slot] > 0)
+        recordCount += (sizes[slot] - SEGMENT_DATA_START) / sizeof(SampleRecord_t);
+    }
+
+    uint32_t headSize = sizes[headSeq % OFFLINE_LOG_SEGMENTS];
+    headRecords = (headSize - SEGMENT_DATA_START) / sizeof(SampleRecord_t);
+
+    // A torn append leaves a partial record, start a fresh segment rather than misalign the next ones
+    rotateHead = (headSize - SEGMENT_DATA_START) % sizeof(SampleRecord_t) != 0;
+
+    File file = LittleFS.open(OFFLINE_CURSOR_PATH, "r");
+    Cursor_t cursor;
+    if (file && file.read((uint8_t *)&cursor, sizeof(cursor)) == sizeof(cursor) && cursor.seq == tailSeq &&
+        cursor.offset >= SEGMENT_DATA_START && cursor.offset <= sizes[tailSeq % OFFLINE_LOG_SEGMENTS])
+    {
+      tailOffset = cursor.offset;
+      recordCount -= (tailOffset - SEGMENT_DATA_START) / sizeof(SampleRecord_t);
+    }
+    if (file)
+      file.close();
+  }
+
+  ready = true;
+
+  LOG_INFO("Offline log: %u records backlog in segments %u..%u", recordCount, tailSeq, headSeq);
+  return true;
+}
+
+bool OfflineLog::openSegment(uint32_t seq)
+{
+  File file = LittleFS.open(segmentPath(seq), "w");
+  if (!file)
+    return false;
+
+  SegmentHeader_t header = {OFFLINE_LOG_MAGIC, seq};
+  bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+  file.close();
+
+  headSeq = seq;
+  headRecords = 0;
+  rotateHead = false;
+  return ok;
+}
+
+uint32_t OfflineLog::tailRecords() const
+{
+  if (tailSeq == headSeq)
+    return headRecords - (tailOffset - SEGMENT_DATA_START) / sizeof(SampleRecord_t);
+
+  File file = LittleFS.open(segmentPath(tailSeq), "r");
+  if (!file)
+    return 0;
+
+  uint32_t size = file.size();
+  file.close();
+  return size > tailOffset ? (size - tailOffset) / sizeof(SampleRecord_t) : 0;
+}
+
+void OfflineLog::dropTail()
+{
+  uint32_t lost = tailRecords();
+  recordCount -= lost;
+  logStats.dropped += lost;
+
+  LittleFS.remove(segmentPath(tailSeq));
+  tailSeq++;
+  tailOffset = SEGMENT_DATA_START;
+}
+
+bool OfflineLog::append(const SampleRecord_t *records, uint16_t count)
+{
+  if (!ready)
+    return false;
+
+  TRACE_SCOPE(TRACE_FS_WRITE);
+  uint16_t written = 0;
+  while (written < count)
+  {
+    if (recordCount == 0)
+    {
+      // Backlog fully drained, restart the ring on a fresh segment
+      if (!openSegment(headSeq + 1))
+        return false;
+      tailSeq = headSeq;
+      tailOffset = SEGMENT_DATA_START;
+    }
+    else if (headRecords >= OFFLINE_SEGMENT_RECORDS || rotateHead)
+    {
+      if (headSeq + 1 - tailSeq >= OFFLINE_LOG_SEGMENTS)
+        dropTail();
+      if (!openSegment(headSeq + 1))
+        return false;
+    }
+
+    uint16_t chunk = min<uint32_t>(count - written, OFFLINE_SEGMENT_RECORDS - headRecords);
+    File file = LittleFS.open(segmentPath(headSeq), "a");
+    if (!file)
+      return false;
+
+    size_t bytes = file.write((const uint8_t *)&records[written], chunk * sizeof(SampleRecord_t));
+    file.close();
+
+    uint16_t stored = bytes / sizeof(SampleRecord_t);
+    headRecords += stored;
+    recordCount += stored;
+    logStats.appended += stored;
+    written += stored;
+
+    if (stored != chunk)
+      return false;
+  }
+
+  return true;
+}
+
+uint16_t OfflineLog::read(SampleRecord_t *records, uint16_t max, uint16_t *scanned, uint16_t *positions)
+{
+  *scanned = 0;
+  if (!ready || recordCount == 0)
+    return 0;
+
+  TRACE_SCOPE(TRACE_FS_READ);
+  File file = LittleFS.open(segmentPath(tailSeq), "r");
+  if (!file)
+  {
+    // Segment vanished underneath us, skip it
+    *scanned = tailRecords();
+    return 0;
+  }
+
+  file.seek(tailOffset, SeekSet);
+
+  uint16_t valid = 0;
+  SampleRecord_t record;
+  while (*scanned < max && file.read((uint8_t *)&record, sizeof(record)) == sizeof(record))
+  {
+    if (sampleRecordValid(record))
+    {
+      if (positions != nullptr)
+        positions[valid] = *scanned;
+      records[valid++] = record;
+    }
+    else
+    {
+      logStats.corrupt++;
+    }
+    (*scanned)++;
+  }
+  file.close();
+
+  return valid;
+}
+
+void OfflineLog::consume(uint16_t scanned, uint16_t replayed, uint32_t elapsedMs)
+{
+  if (!ready || recordCount == 0)
+    return;
+
+  TRACE_SCOPE(TRACE_FS_WRITE);
+  tailOffset += scanned * sizeof(SampleRecord_t);
+  recordCount -= min<uint32_t>(scanned, recordCount);
+
+  logStats.replayed += replayed;
+  logStats.replayBatches++;
+  logStats.replayMs += elapsedMs;
+
+  if (tailRecords() == 0 && tailSeq != headSeq)
+  {
+    LittleFS.remove(segmentPath(tailSeq));
+    tailSeq++;
+    tailOffset = SEGMENT_DATA_START;
+  }
+  else if (recordCount == 0)
+  {
+    LittleFS.remove(segmentPath(tailSeq));
+    LittleFS.remove(OFFLINE_CURSOR_PATH);
+    return;
+  }
+
+  saveCursor();
+}
+
+void OfflineLog::saveCursor()
+{
+  File file = LittleFS.open(OFFLINE_CURSOR_PATH, "w");
+  if (!file)
+    return;
+
+  Cursor_t cursor = {tailSeq, tailOffset};
+  file.write((const uint8_t *)&cursor, sizeof(cursor));
+  file.close();
+}
+
+void OfflineLog::printStats(Print &out) const
+{
+  out.printf("offline backlog %u appended %u dropped %u corrupt %u replayed %u in %u batches, %u records/s\n",
+             recordCount, logStats.appended, logStats.dropped, logStats.corrupt, logStats.replayed,
+             logStats.replayBatches, logStats.replayMs > 0 ? (uint32_t)(logStats.replayed * 1000ULL / logStats.replayMs) : 0);
+}
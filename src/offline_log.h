@@ -0,0 +1,71 @@
+#ifndef __OFFLINE_LOG_H__
+#define __OFFLINE_LOG_H__
+
+#include <Arduino.h>
+#include "sample_record.h"
+
+//
+// Flash budget of the offline log: OFFLINE_LOG_SEGMENTS files of OFFLINE_SEGMENT_RECORDS records each.
+// Defaults give 8 x 256 x 62 bytes = ~124 KB, about 5.5 hours of samples at a 10 s period and
+// proportionally longer when samples are aggregated
+//
+#ifndef OFFLINE_LOG_SEGMENTS
+#define OFFLINE_LOG_SEGMENTS 8
+#endif
+
+#ifndef OFFLINE_SEGMENT_RECORDS
+#define OFFLINE_SEGMENT_RECORDS 256
+#endif
+
+#define OFFLINE_LOG_DIR "/wal"
+
+typedef struct
+{
+  uint32_t appended;
+  uint32_t dropped;
+  uint32_t corrupt;
+  uint32_t replayed;
+  uint32_t replayBatches;
+  uint32_t replayMs;
+} OfflineLogStats_t;
+
+//
+// Append-only ring of fixed-size sample records on LittleFS. Records go into
+// numbered segment files that are recycled round-robin, so writes are spread
+// over the whole budget and the oldest segment is discarded once it's full.
+// The read position is kept in a small cursor file that is only rewritten
+// after a replayed batch has been acknowledged.
+//
+class OfflineLog
+{
+public:
+  OfflineLog();
+
+  bool begin();
+
+  bool append(const SampleRecord_t *records, uint16_t count);
+  // `positions[i]`, if given, counts the records scanned before records[i], for consuming part of a read
+  uint16_t read(SampleRecord_t *records, uint16_t max, uint16_t *scanned, uint16_t *positions = nullptr);
+  void consume(uint16_t scanned, uint16_t replayed, uint32_t elapsedMs);
+
+  uint32_t size() const { return recordCount; }
+  const OfflineLogStats_t &stats() const { return logStats; }
+  void printStats(Print &out) const;
+
+private:
+  bool openSegment(uint32_t seq);
+  void dropTail();
+  uint32_t tailRecords() const;
+  void saveCursor();
+
+  bool ready;
+  bool rotateHead;
+  uint32_t tailSeq;
+  uint32_t tailOffset;
+  uint32_t headSeq;
+  uint32_t headRecords;
+  uint32_t recordCount;
+  OfflineLogStats_t logStats;
+};
+
+#endif //__OFFLINE_LOG_H__
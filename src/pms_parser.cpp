@@ -0,0 +1,110 @@
+#include "pms_parser.h"
+
+#define PMS_START_1 0x42
+#define PMS_START_2 0x4d
+#define PMS_PAYLOAD_LENGTH (PMS_FRAME_LENGTH - 4)
+
+PmsParser::PmsParser() : index(0), valid(false), lastFrameMs(0)
+{
+  memset(data, 0, sizeof(data));
+  memset(&pmsStats, 0, sizeof(pmsStats));
+}
+
+void PmsParser::resync(uint8_t c)
+{
+  // Skip the bytes before this one, which may itself start the next frame
+  pmsStats.skippedBytes += index;
+  index = 0;
+  if (c == PMS_START_1)
+    frame[index++] = c;
+  else
+    pmsStats.skippedBytes++;
+}
+
+bool PmsParser::feed(uint8_t c)
+{
+  if (index == 0)
+  {
+    resync(c);
+    return false;
+  }
+
+  if (index == 1 && c != PMS_START_2)
+  {
+    resync(c);
+    return false;
+  }
+
+  frame[index++] = c;
+
+  if (index == 4 && ((frame[2] << 8) | frame[3]) != PMS_PAYLOAD_LENGTH)
+  {
+    pmsStats.lengthErrors++;
+    index = 0;
+    return false;
+  }
+
+  if (index < PMS_FRAME_LENGTH)
+    return false;
+
+  index = 0;
+
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < PMS_FRAME_LENGTH - 2; i++)
+    sum += frame[i];
+
+  if (sum != ((frame[PMS_FRAME_LENGTH - 2] << 8) | frame[PMS_FRAME_LENGTH - 1]))
+  {
+    pmsStats.checksumErrors++;
+    return false;
+  }
+
+  for (uint8_t i = 0; i < PMS_DATA_WORDS; i++)
+    data[i] = (frame[4 + 2 * i] << 8) | frame[5 + 2 * i];
+
+  valid = true;
+  lastFrameMs = millis();
+  pmsStats.frames++;
+  return true;
+}
+
+uint16_t PmsParser::poll(Stream &in)
+{
+  uint16_t frames = 0;
+  while (in.available() > 0)
+  {
+    int c = in.read();
+    if (c < 0)
+      break;
+    if (feed(c))
+      frames++;
+  }
+  return frames;
+}
+
+void PmsParser::setActiveMode(Stream &out)
+{
+  static const uint8_t command[] = {PMS_START_1, PMS_START_2, 0xe1, 0x00, 0x01, 0x01, 0x71};
+  out.write(command, sizeof(command));
+}
+
+void PmsParser::setSleep(Stream &out, bool sleep)
+{
+  static const uint8_t sleepCommand[] = {PMS_START_1, PMS_START_2, 0xe4, 0x00, 0x00, 0x01, 0x73};
+  static const uint8_t wakeCommand[] = {PMS_START_1, PMS_START_2, 0xe4, 0x00, 0x01, 0x01, 0x74};
+  out.write(sleep ? sleepCommand : wakeCommand, sizeof(sleepCommand));
+  // Frames from before the sleep must not pass for fresh ones after the wake
+  valid = false;
+}
+
+bool PmsParser::hasFrame(uint32_t maxAgeMs) const
+{
+  return valid && millis() - lastFrameMs <= maxAgeMs;
+}
+
+void PmsParser::printStats(Print &out) const
+{
+  out.printf("pms frames %u checksum errors %u length errors %u skipped bytes %u overflows %u\n",
+             pmsStats.frames, pmsStats.checksumErrors, pmsStats.lengthErrors, pmsStats.skippedBytes,
+             pmsStats.overflows);
+}
@@ -0,0 +1,71 @@
+#ifndef __PMS_PARSER_H__
+#define __PMS_PARSER_H__
+
+#include <Arduino.h>
+
+#define PMS_DATA_WORDS 13
+#define PMS_FRAME_LENGTH 32
+
+// Data words of a PMS5003 frame, in transmission order
+enum PmsWord
+{
+  PMS_PM1_CF1 = 0,
+  PMS_PM25_CF1,
+  PMS_PM10_CF1,
+  PMS_PM1,
+  PMS_PM25,
+  PMS_PM10,
+  PMS_COUNT_03,
+  PMS_COUNT_05,
+  PMS_COUNT_1,
+  PMS_COUNT_25,
+  PMS_COUNT_5,
+  PMS_COUNT_10,
+  PMS_STATUS
+};
+
+typedef struct
+{
+  uint32_t frames;
+  uint32_t checksumErrors;
+  uint32_t lengthErrors;
+  uint32_t skippedBytes;
+  uint32_t overflows;
+} PmsStats_t;
+
+//
+// Incremental PMS5003 frame parser. Bytes are fed as they arrive from the UART, a frame is
+// accepted once its length and checksum check out, anything else is skipped until the next
+// 0x42 0x4D start sequence.
+//
+class PmsParser
+{
+public:
+  PmsParser();
+
+  bool feed(uint8_t c);
+  uint16_t poll(Stream &in);
+
+  void setActiveMode(Stream &out);
+  // A sleeping PMS5003 stops its fan and laser, after waking it streams again once the fan is up to speed
+  void setSleep(Stream &out, bool sleep);
+  void countOverflow() { pmsStats.overflows++; }
+
+  bool hasFrame(uint32_t maxAgeMs) const;
+  const uint16_t *words() const { return data; }
+
+  const PmsStats_t &stats() const { return pmsStats; }
+  void printStats(Print &out) const;
+
+private:
+  void resync(uint8_t c);
+
+  uint8_t frame[PMS_FRAME_LENGTH];
+  uint8_t index;
+  uint16_t data[PMS_DATA_WORDS];
+  bool valid;
+  uint32_t lastFrameMs;
+  PmsStats_t pmsStats;
+};
+
+#endif //__PMS_PARSER_H__
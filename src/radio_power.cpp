@@ -0,0 +1,85 @@
+#include "radio_power.h"
+#include "logger.h"
+
+#include <ESP8266WiFi.h>
+
+RadioPower::RadioPower()
+    : managed(false), on(true), onSinceMs(0), hourStartMs(0), hourOnMs(0), hourStartPoints(0), lastPoints(0)
+{
+  memset(&radioStats, 0, sizeof(radioStats));
+}
+
+void RadioPower::begin(bool modemSleep)
+{
+  managed = modemSleep;
+  on = true;
+  onSinceMs = hourStartMs = millis();
+}
+
+uint32_t RadioPower::onMs(uint32_t now) const
+{
+  return hourOnMs + (on ? now - onSinceMs : 0);
+}
+
+void RadioPower::sleep()
+{
+  if (!on)
+    return;
+
+  uint32_t now = millis();
+  hourOnMs += now - onSinceMs;
+  radioStats.totalOnMs += now - onSinceMs;
+  on = false;
+
+  WiFi.disconnect();
+  WiFi.mode(WIFI_OFF);
+  WiFi.forceSleepBegin();
+  delay(1);
+}
+
+void RadioPower::wake()
+{
+  if (on)
+    return;
+
+  WiFi.forceSleepWake();
+  delay(1);
+  on = true;
+  onSinceMs = millis();
+  radioStats.wakes++;
+}
+
+void RadioPower::tick(uint32_t uploadedPoints)
+{
+  lastPoints = uploadedPoints;
+
+  uint32_t now = millis();
+  if (now - hourStartMs < RADIO_REPORT_MS)
+    return;
+
+  // Time still running in an open period counts for the hour it was spent in
+  uint32_t hourMs = onMs(now);
+  if (on)
+  {
+    radioStats.totalOnMs += now - onSinceMs;
+    onSinceMs = now;
+  }
+  radioStats.hourOnMs = hourMs;
+  radioStats.hourPoints = uploadedPoints - hourStartPoints;
+
+  LOG_INFO("radio on %u ms in the last hour (%u.%u%%), %u points uploaded, %u ms per point", hourMs,
+           hourMs / (RADIO_REPORT_MS / 100), hourMs / (RADIO_REPORT_MS / 1000) % 10, radioStats.hourPoints,
+           radioStats.hourPoints > 0 ? hourMs / radioStats.hourPoints : 0);
+
+  hourStartMs = now;
+  hourOnMs = 0;
+  hourStartPoints = uploadedPoints;
+}
+
+void RadioPower::printStats(Print &out) const
+{
+  uint32_t now = millis();
+  out.printf("radio %s wakes %u on %u ms this hour %u points, last hour %u ms %u points\n",
+             managed ? "modem-sleep" : "always-on", radioStats.wakes, onMs(now), lastPoints - hourStartPoints,
+             radioStats.hourOnMs, radioStats.hourPoints);
+}
@@ -0,0 +1,54 @@
+#ifndef __RADIO_POWER_H__
+#define __RADIO_POWER_H__
+
+#include <Arduino.h>
+
+#define RADIO_REPORT_MS 3600000
+
+typedef struct
+{
+  uint32_t wakes;
+  uint32_t totalOnMs;
+  // The last complete hour
+  uint32_t hourOnMs;
+  uint32_t hourPoints;
+} RadioStats_t;
+
+//
+// Keeps track of when the WiFi radio is powered and, in modem-sleep mode, switches it off between
+// uploads. Radio-on time is totalled per hour together with the points uploaded in that hour, which
+// gives the radio time (and so the energy) spent per uploaded point.
+//
+class RadioPower
+{
+public:
+  RadioPower();
+
+  void begin(bool modemSleep);
+  bool modemSleep() const { return managed; }
+  bool awake() const { return on; }
+
+  // The caller reconnects after a wake, e.g. with WifiConnector
+  void sleep();
+  void wake();
+
+  // `uploadedPoints` is a running total; logs and rolls the hourly figures over once an hour has passed
+  void tick(uint32_t uploadedPoints);
+
+  const RadioStats_t &stats() const { return radioStats; }
+  void printStats(Print &out) const;
+
+private:
+  uint32_t onMs(uint32_t now) const;
+
+  bool managed;
+  bool on;
+  uint32_t onSinceMs;
+  uint32_t hourStartMs;
+  uint32_t hourOnMs;
+  uint32_t hourStartPoints;
+  uint32_t lastPoints;
+  RadioStats_t radioStats;
+};
+
+#endif //__RADIO_POWER_H__
@@ -0,0 +1,94 @@
+#include "rtc_log.h"
+#include "crc32.h"
+
+static_assert(sizeof(RtcLogHeader_t) + RTC_LOG_CAPACITY * sizeof(RtcSample_t) <= RTC_LOG_BYTES, "RTC log overflows RTC memory");
+
+RtcLog::RtcLog()
+{
+  clear();
+}
+
+uint32_t RtcLog::checksum() const
+{
+  // Everything after the crc field that is in use
+  size_t length = sizeof(RtcLogHeader_t) - offsetof(RtcLogHeader_t, wakeTime) + image.header.count * sizeof(RtcSample_t);
+  return crc32Update(0, (const uint8_t *)&image.header.wakeTime, length);
+}
+
+bool RtcLog::load()
+{
+  if (!ESP.rtcUserMemoryRead(0, words, sizeof(words)) || image.header.magic != RTC_LOG_MAGIC ||
+      image.header.count > RTC_LOG_CAPACITY || image.header.crc != checksum())
+  {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+void RtcLog::save()
+{
+  image.header.magic = RTC_LOG_MAGIC;
+  image.header.crc = checksum();
+  ESP.rtcUserMemoryWrite(0, words, sizeof(words));
+}
+
+void RtcLog::clear()
+{
+  memset(words, 0, sizeof(words));
+}
+
+void RtcLog::discard()
+{
+  image.header.count = 0;
+  image.header.wakes = 0;
+}
+
+bool RtcLog::append(const SampleRecord_t &sample)
+{
+  if (full())
+    return false;
+
+  if (image.header.count == 0)
+    image.header.baseTime = sample.timestamp;
+  // Offsets are 16 bits, about 18 hours
+  uint32_t offset = sample.timestamp - image.header.baseTime;
+  if (sample.timestamp < image.header.baseTime || offset > UINT16_MAX)
+    return false;
+
+  RtcSample_t &compact = image.samples[image.header.count++];
+  compact.offset = offset;
+  compact.pm[0] = sample.pms[PMS_PM1];
+  compact.pm[1] = sample.pms[PMS_PM25];
+  compact.pm[2] = sample.pms[PMS_PM10];
+  compact.co2 = sample.co2;
+  // The S8 meter status flags all live in the low byte
+  compact.s8Status = sample.s8Status & 0xff;
+  compact.tempC = sample.tempC;
+  compact.humidity = sample.humidity;
+  return true;
+}
+
+void RtcLog::expand(uint8_t index, SampleRecord_t &record) const
+{
+  const RtcSample_t &compact = image.samples[index];
+
+  memset(&record, 0, sizeof(record));
+  record.timestamp = image.header.baseTime + compact.offset;
+  for (uint8_t i = 0; i < PMS_DATA_WORDS; i++)
+    record.pms[i] = SAMPLE_PMS_INVALID;
+  if (compact.pm[1] != SAMPLE_PMS_INVALID)
+  {
+    record.pms[PMS_PM1] = compact.pm[0];
+    record.pms[PMS_PM25] = compact.pm[1];
+    record.pms[PMS_PM10] = compact.pm[2];
+  }
+  record.co2 = compact.co2;
+  record.s8Status = compact.s8Status;
+  record.s8AbcHours = SAMPLE_ABC_INVALID;
+  record.tempC = compact.tempC;
+  record.humidity = compact.humidity;
+  record.rssi = SAMPLE_RSSI_INVALID;
+  record.samples = 1;
+  sampleRecordSeal(record);
+}
@@ -0,0 +1,79 @@
+#ifndef __RTC_LOG_H__
+#define __RTC_LOG_H__
+
+#include <Arduino.h>
+#include "sample_record.h"
+
+#define RTC_LOG_MAGIC 0x31435452 // "RTC1"
+// RTC user memory survives deep sleep: 512 bytes, addressed in 4-byte blocks
+#define RTC_LOG_BYTES 512
+
+//
+// What a deep-sleep wake keeps of a sample: the atmospheric PM values, CO2 with its status flags,
+// temperature and humidity, timed relative to the first sample of the batch
+//
+typedef struct __attribute__((packed))
+{
+  uint16_t offset;
+  uint16_t pm[3];
+  int16_t co2;
+  uint8_t s8Status;
+  int16_t tempC;
+  uint16_t humidity;
+} RtcSample_t;
+
+typedef struct __attribute__((packed))
+{
+  uint32_t magic;
+  uint32_t crc;
+  // Wall clock expected at the next wake, 0 until NTP has set the clock once
+  uint32_t wakeTime;
+  uint32_t baseTime;
+  uint16_t wakes;
+  uint8_t count;
+  uint8_t reserved;
+} RtcLogHeader_t;
+
+#define RTC_LOG_CAPACITY ((RTC_LOG_BYTES - sizeof(RtcLogHeader_t)) / sizeof(RtcSample_t))
+
+//
+// Samples of a deep-sleep duty cycle, accumulated in RTC user memory between uploads.
+// The whole image is read once per wake and written back just before sleeping.
+//
+class RtcLog
+{
+public:
+  RtcLog();
+
+  // load() starts over with an empty log, without a clock, when RTC memory holds no valid image
+  bool load();
+  void save();
+  void clear();
+
+  bool append(const SampleRecord_t &sample);
+  uint8_t size() const { return image.header.count; }
+  bool full() const { return image.header.count >= RTC_LOG_CAPACITY; }
+  void expand(uint8_t index, SampleRecord_t &record) const;
+  // Drops the samples, keeping the clock
+  void discard();
+
+  uint16_t wakes() const { return image.header.wakes; }
+  void countWake() { image.header.wakes++; }
+  uint32_t wakeTime() const { return image.header.wakeTime; }
+  void setWakeTime(uint32_t time) { image.header.wakeTime = time; }
+
+private:
+  uint32_t checksum() const;
+
+  union
+  {
+    struct __attribute__((packed))
+    {
+      RtcLogHeader_t header;
+      RtcSample_t samples[RTC_LOG_CAPACITY];
+    } image;
+    uint32_t words[RTC_LOG_BYTES / 4];
+  };
+};
+
+#endif //__RTC_LOG_H__
@@ -0,0 +1,170 @@
+#include "s8_modbus.h"
+
+#define S8_ADDRESS 0xfe
+#define MODBUS_EXCEPTION 0x80
+
+// Upper bounds of the latency buckets in ms, the last bucket is open ended
+static const uint16_t S8_LATENCY_LIMITS_MS[S8_LATENCY_BUCKETS - 1] = {25, 50, 100, 200, 500};
+
+uint16_t modbusCrc(const uint8_t *data, size_t len)
+{
+  uint16_t crc = 0xffff;
+  while (len--)
+  {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+  }
+  return crc;
+}
+
+S8Modbus::S8Modbus()
+    : port(nullptr), timeoutMs(0), maxRetries(0), state(S8_IDLE), requestFunction(0), requestAddress(0),
+      requestCount(0), attempt(0), startMs(0), sentMs(0), responseLength(0)
+{
+  memset(registers, 0, sizeof(registers));
+  memset(&s8Stats, 0, sizeof(s8Stats));
+}
+
+void S8Modbus::begin(Stream *port, uint16_t timeoutMs, uint8_t retries)
+{
+  this->port = port;
+  this->timeoutMs = timeoutMs;
+  this->maxRetries = retries;
+}
+
+bool S8Modbus::request(uint8_t function, uint16_t address, uint8_t count)
+{
+  if (port == nullptr || state == S8_WAITING || count == 0 || count > S8_MAX_REGISTERS)
+    return false;
+
+  requestFunction = function;
+  requestAddress = address;
+  requestCount = count;
+  attempt = 0;
+  startMs = millis();
+  s8Stats.transactions++;
+
+  send();
+  return true;
+}
+
+void S8Modbus::send()
+{
+  // Whatever is still buffered belongs to an earlier, abandoned reply
+  while (port->available() > 0)
+    port->read();
+
+  uint8_t frame[8] = {S8_ADDRESS, requestFunction, (uint8_t)(requestAddress >> 8), (uint8_t)requestAddress, 0,
+                      requestCount};
+  uint16_t crc = modbusCrc(frame, 6);
+  frame[6] = crc & 0xff;
+  frame[7] = crc >> 8;
+
+  port->write(frame, sizeof(frame));
+  responseLength = 0;
+  sentMs = millis();
+  state = S8_WAITING;
+}
+
+void S8Modbus::retryOrFail()
+{
+  if (attempt < maxRetries)
+  {
+    attempt++;
+    s8Stats.retries++;
+    send();
+    return;
+  }
+
+  s8Stats.failed++;
+  state = S8_FAILED;
+}
+
+void S8Modbus::complete()
+{
+  for (uint8_t i = 0; i < requestCount; i++)
+    registers[i] = (response[3 + 2 * i] << 8) | response[4 + 2 * i];
+
+  uint32_t latency = millis() - startMs;
+  uint8_t bucket = 0;
+  while (bucket < S8_LATENCY_BUCKETS - 1 && latency >= S8_LATENCY_LIMITS_MS[bucket])
+    bucket++;
+  s8Stats.latency[bucket]++;
+  if (latency > s8Stats.maxLatencyMs)
+    s8Stats.maxLatencyMs = latency;
+
+  s8Stats.completed++;
+  state = S8_DONE;
+}
+
+S8State_t S8Modbus::poll()
+{
+  if (state != S8_WAITING)
+    return state;
+
+  while (port->available() > 0)
+  {
+    int c = port->read();
+    if (c < 0)
+      break;
+
+    // Skip line noise until the reply's address byte
+    if (responseLength == 0 && c != S8_ADDRESS)
+      continue;
+    if (responseLength < sizeof(response))
+      response[responseLength++] = c;
+
+    if (responseLength < 3)
+      continue;
+
+    bool exception = response[1] & MODBUS_EXCEPTION;
+    uint8_t expected = exception ? 5 : 5 + response[2];
+    if (!exception && (response[1] != requestFunction || response[2] != 2 * requestCount))
+    {
+      s8Stats.badReplies++;
+      retryOrFail();
+      return state;
+    }
+    if (responseLength < expected)
+      continue;
+
+    uint16_t crc = response[expected - 2] | (response[expected - 1] << 8);
+    if (crc != modbusCrc(response, expected - 2))
+    {
+      s8Stats.badReplies++;
+      retryOrFail();
+      return state;
+    }
+
+    if (exception)
+    {
+      s8Stats.exceptions++;
+      s8Stats.failed++;
+      state = S8_FAILED;
+      return state;
+    }
+
+    complete();
+    return state;
+  }
+
+  if (millis() - sentMs >= timeoutMs)
+  {
+    s8Stats.timeouts++;
+    retryOrFail();
+  }
+
+  return state;
+}
+
+void S8Modbus::printStats(Print &out) const
+{
+  out.printf("s8 transactions %u ok %u failed %u retries %u timeouts %u bad replies %u exceptions %u latency",
+             s8Stats.transactions, s8Stats.completed, s8Stats.failed, s8Stats.retries, s8Stats.timeouts,
+             s8Stats.badReplies, s8Stats.exceptions);
+  for (uint8_t i = 0; i < S8_LATENCY_BUCKETS - 1; i++)
+    out.printf(" <%u:%u", S8_LATENCY_LIMITS_MS[i], s8Stats.latency[i]);
+  out.printf(" >=%u:%u max %u ms\n", S8_LATENCY_LIMITS_MS[S8_LATENCY_BUCKETS - 2],
+             s8Stats.latency[S8_LATENCY_BUCKETS - 1], s8Stats.maxLatencyMs);
+}
@@ -0,0 +1,98 @@
+#ifndef __S8_MODBUS_H__
+#define __S8_MODBUS_H__
+
+#include <Arduino.h>
+
+#define S8_MAX_REGISTERS 4
+
+// Meter status flags from input register IR1
+#define S8_STATUS_FATAL 0x0001
+#define S8_STATUS_OFFSET_REGULATION 0x0002
+#define S8_STATUS_ALGORITHM 0x0004
+#define S8_STATUS_OUTPUT 0x0008
+#define S8_STATUS_SELF_DIAGNOSTICS 0x0010
+#define S8_STATUS_OUT_OF_RANGE 0x0020
+#define S8_STATUS_MEMORY 0x0040
+
+#define S8_READ_HOLDING 0x03
+#define S8_READ_INPUT 0x04
+
+// Input registers IR1..IR4 are read in one transaction starting at IR1
+#define S8_IR_METER_STATUS 0x0000
+#define S8_IR_SPACE_CO2 0x0003
+#define S8_HR_ABC_PERIOD 0x001f
+
+// Transaction latency histogram, bucket limits are in s8_modbus.cpp
+#define S8_LATENCY_BUCKETS 6
+
+typedef enum
+{
+  S8_IDLE,
+  S8_WAITING,
+  S8_DONE,
+  S8_FAILED
+} S8State_t;
+
+typedef struct
+{
+  uint32_t transactions;
+  uint32_t completed;
+  uint32_t failed;
+  uint32_t retries;
+  uint32_t timeouts;
+  uint32_t badReplies;
+  uint32_t exceptions;
+  uint32_t latency[S8_LATENCY_BUCKETS];
+  uint32_t maxLatencyMs;
+} S8Stats_t;
+
+//
+// Request/response engine for the SenseAir S8 Modbus interface. A transaction is sent by
+// `request()` and completed by `poll()` from loop(), which assembles the reply byte by byte,
+// checks its CRC and retries on timeout or corruption without ever blocking.
+//
+class S8Modbus
+{
+public:
+  S8Modbus();
+
+  void begin(Stream *port, uint16_t timeoutMs, uint8_t retries);
+
+  bool request(uint8_t function, uint16_t address, uint8_t count);
+  S8State_t poll();
+  void acknowledge() { state = S8_IDLE; }
+
+  bool busy() const { return state == S8_WAITING; }
+  uint16_t reg(uint8_t index) const { return registers[index]; }
+  uint8_t function() const { return requestFunction; }
+  uint16_t address() const { return requestAddress; }
+
+  const S8Stats_t &stats() const { return s8Stats; }
+  void printStats(Print &out) const;
+
+private:
+  void send();
+  void retryOrFail();
+  void complete();
+
+  Stream *port;
+  uint16_t timeoutMs;
+  uint8_t maxRetries;
+
+  S8State_t state;
+  uint8_t requestFunction;
+  uint16_t requestAddress;
+  uint8_t requestCount;
+  uint8_t attempt;
+  uint32_t startMs;
+  uint32_t sentMs;
+
+  uint8_t response[5 + 2 * S8_MAX_REGISTERS];
+  uint8_t responseLength;
+  uint16_t registers[S8_MAX_REGISTERS];
+  S8Stats_t s8Stats;
+};
+
+uint16_t modbusCrc(const uint8_t *data, size_t len);
+
+#endif //__S8_MODBUS_H__
@@ -0,0 +1,23 @@
+#include "sample_record.h"
+
+static uint8_t crc8(const uint8_t *data, size_t len)
+{
+  uint8_t crc = 0xff;
+  while (len--)
+  {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+  }
+  return crc;
+}
+
+void sampleRecordSeal(SampleRecord_t &record)
+{
+  record.crc = crc8((const uint8_t *)&record, offsetof(SampleRecord_t, crc));
+}
+
+bool sampleRecordValid(const SampleRecord_t &record)
+{
+  return record.timestamp != 0 && record.crc == crc8((const uint8_t *)&record, offsetof(SampleRecord_t, crc));
+}
@@ -0,0 +1,63 @@
+#ifndef __SAMPLE_RECORD_H__
+#define __SAMPLE_RECORD_H__
+
+#include <Arduino.h>
+#include "pms_parser.h"
+
+#define SAMPLE_PMS_INVALID UINT16_MAX
+#define SAMPLE_CO2_INVALID -1
+#define SAMPLE_ABC_INVALID UINT16_MAX
+#define SAMPLE_TEMP_INVALID INT16_MIN
+#define SAMPLE_HUMIDITY_INVALID UINT16_MAX
+#define SAMPLE_RSSI_INVALID INT8_MIN
+
+// Channels that carry min/max/stddev when a record summarizes a window of samples
+enum SampleChannel
+{
+  SAMPLE_CH_PM25 = 0,
+  SAMPLE_CH_CO2,
+  SAMPLE_CH_TEMP,
+  SAMPLE_CH_HUMIDITY,
+  SAMPLE_CHANNELS
+};
+
+// Min and max in the unit the channel is stored in, standard deviation in 1/100 of the reported unit
+// (so temperature and humidity use centi units for all three)
+typedef struct __attribute__((packed))
+{
+  int16_t min;
+  int16_t max;
+  uint16_t stddev;
+} ChannelStats_t;
+
+//
+// Compact fixed-size form of one sample, used wherever samples are persisted.
+// `pms` holds all data words of the last PMS5003 frame and is invalid when
+// pms[PMS_PM25] is SAMPLE_PMS_INVALID; other words set to SAMPLE_PMS_INVALID
+// were not kept and are left out on their own. `s8Status` is only meaningful with a
+// valid `co2`, `s8AbcHours` is read much less often and has its own marker.
+// Temperature is stored in 1/100 °C and humidity in 1/100 %, which matches the
+// two decimals the InfluxDB point carries.
+//
+// A record with `samples` > 1 summarizes a window: the value fields hold the
+// window means and `stats` the per-channel spread.
+//
+typedef struct __attribute__((packed))
+{
+  uint32_t timestamp;
+  uint16_t pms[PMS_DATA_WORDS];
+  int16_t co2;
+  uint16_t s8Status;
+  uint16_t s8AbcHours;
+  int16_t tempC;
+  uint16_t humidity;
+  int8_t rssi;
+  uint16_t samples;
+  ChannelStats_t stats[SAMPLE_CHANNELS];
+  uint8_t crc;
+} SampleRecord_t;
+
+void sampleRecordSeal(SampleRecord_t &record);
+bool sampleRecordValid(const SampleRecord_t &record);
+
+#endif //__SAMPLE_RECORD_H__
@@ -0,0 +1,163 @@
+#include "scheduler.h"
+#include "alloc_tracker.h"
+#include "logger.h"
+
+Scheduler::Scheduler() : taskCount(0)
+{
+  memset(tasks, 0, sizeof(tasks));
+}
+
+Task_t *Scheduler::addTask(const char *name, TaskCallback_t callback, uint32_t intervalMs, uint32_t startDelayMs)
+{
+  if (taskCount >= SCHEDULER_MAX_TASKS)
+  {
+    LOG_ERROR("Scheduler full, task %s not added", name);
+    return nullptr;
+  }
+
+  Task_t *task = &tasks[taskCount++];
+  task->name = name;
+  task->callback = callback;
+  task->intervalMs = intervalMs;
+  task->nextRunMs = millis() + startDelayMs;
+  task->enabled = true;
+  return task;
+}
+
+void Scheduler::setInterval(Task_t *task, uint32_t intervalMs)
+{
+  if (task == nullptr)
+    return;
+
+  // Re-anchor on the previous run so a shorter interval takes effect immediately
+  task->nextRunMs = (task->runs > 0 ? task->lastRunMs : millis()) + intervalMs;
+  task->intervalMs = intervalMs;
+}
+
+void Scheduler::runNow(Task_t *task)
+{
+  if (task != nullptr)
+    task->nextRunMs = millis();
+}
+
+const Task_t *Scheduler::findTask(const char *name) const
+{
+  for (uint8_t i = 0; i < taskCount; i++)
+  {
+    if (strcmp(tasks[i].name, name) == 0)
+      return &tasks[i];
+  }
+  return nullptr;
+}
+
+void Scheduler::run()
+{
+  uint32_t now = millis();
+  Task_t *due = nullptr;
+  int32_t mostLate = -1;
+
+  for (uint8_t i = 0; i < taskCount; i++)
+  {
+    Task_t &task = tasks[i];
+    if (!task.enabled)
+      continue;
+
+    int32_t late = (int32_t)(now - task.nextRunMs);
+    if (late > mostLate)
+    {
+      mostLate = late;
+      due = &task;
+    }
+  }
+
+  if (due == nullptr)
+    return;
+
+  uint32_t jitter = (uint32_t)mostLate;
+  due->lastJitterMs = jitter;
+  if (jitter > due->maxJitterMs)
+    due->maxJitterMs = jitter;
+
+  // Fixed-rate: keep the deadline grid unless we've fallen a whole period behind
+  due->nextRunMs += due->intervalMs;
+  if ((int32_t)(now - due->nextRunMs) >= 0)
+  {
+    due->overruns++;
+    due->nextRunMs = now + due->intervalMs;
+  }
+
+  due->lastRunMs = now;
+  due->runs++;
+  uint32_t startUs = micros();
+  {
+    ALLOC_TAG(due->name);
+    due->callback();
+  }
+
+  uint32_t elapsedUs = micros() - startUs;
+  due->totalRunUs += elapsedUs;
+  if (elapsedUs > due->peakRunUs)
+    due->peakRunUs = elapsedUs;
+  uint32_t elapsed = millis() - now;
+  if (elapsed > due->maxRunMs)
+    due->maxRunMs = elapsed;
+}
+
+uint32_t Scheduler::msUntilNextTask() const
+{
+  uint32_t now = millis();
+  uint32_t wait = UINT32_MAX;
+
+  for (uint8_t i = 0; i < taskCount; i++)
+  {
+    const Task_t &task = tasks[i];
+    if (!task.enabled)
+      continue;
+
+    int32_t remaining = (int32_t)(task.nextRunMs - now);
+    if (remaining <= 0)
+      return 0;
+    if ((uint32_t)remaining < wait)
+      wait = remaining;
+  }
+
+  return wait;
+}
+
+uint32_t Scheduler::totalOverruns() const
+{
+  uint32_t overruns = 0;
+  for (uint8_t i = 0; i < taskCount; i++)
+    overruns += tasks[i].overruns;
+  return overruns;
+}
+
+void Scheduler::clearPeaks()
+{
+  for (uint8_t i = 0; i < taskCount; i++)
+    tasks[i].peakRunUs = 0;
+}
+
+void Scheduler::resetStats()
+{
+  for (uint8_t i = 0; i < taskCount; i++)
+  {
+    tasks[i].runs = 0;
+    tasks[i].overruns = 0;
+    tasks[i].maxJitterMs = 0;
+    tasks[i].maxRunMs = 0;
+    tasks[i].totalRunUs = 0;
+    tasks[i].peakRunUs = 0;
+  }
+}
+
+void Scheduler::printStats(Print &out) const
+{
+  for (uint8_t i = 0; i < taskCount; i++)
+  {
+    const Task_t &task = tasks[i];
+    out.printf("task %-8s every %6ums runs %6u overruns %4u jitter %4u/%4ums run max %5ums\n",
+               task.name, task.intervalMs, task.runs, task.overruns,
+               task.lastJitterMs, task.maxJitterMs, task.maxRunMs);
+  }
+}
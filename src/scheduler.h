@@ -0,0 +1,62 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <Arduino.h>
+
+//
+// Maximum number of tasks the cooperative scheduler can hold: setup() and startSampling() add up to
+// 11 with every sensor, modem sleep, MQTT and health enabled, the rest is headroom
+//
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 14
+#endif
+
+typedef void (*TaskCallback_t)();
+
+typedef struct
+{
+  const char *name;
+  TaskCallback_t callback;
+  uint32_t intervalMs;
+  uint32_t nextRunMs;
+  uint32_t lastRunMs;
+  uint32_t runs;
+  uint32_t overruns;
+  uint32_t lastJitterMs;
+  uint32_t maxJitterMs;
+  uint32_t maxRunMs;
+  // Time spent in the callback overall, and the longest run since the last clearPeaks()
+  uint64_t totalRunUs;
+  uint32_t peakRunUs;
+  bool enabled;
+} Task_t;
+
+//
+// millis() based cooperative scheduler. Tasks run at a fixed rate; each call to
+// run() executes at most one due task (the one with the oldest deadline) so that
+// long tasks can't starve the others and loop() keeps returning to the core.
+//
+class Scheduler
+{
+public:
+  Scheduler();
+
+  Task_t *addTask(const char *name, TaskCallback_t callback, uint32_t intervalMs, uint32_t startDelayMs = 0);
+  void setInterval(Task_t *task, uint32_t intervalMs);
+  void runNow(Task_t *task);
+  const Task_t *findTask(const char *name) const;
+
+  void run();
+  uint32_t msUntilNextTask() const;
+
+  uint32_t totalOverruns() const;
+  void clearPeaks();
+  void resetStats();
+  void printStats(Print &out) const;
+
+private:
+  Task_t tasks[SCHEDULER_MAX_TASKS];
+  uint8_t taskCount;
+};
+
+#endif //__SCHEDULER_H__
@@ -0,0 +1,129 @@
+#include "tls_session.h"
+#include "crc32.h"
+#include "logger.h"
+#include "trace.h"
+
+#include <LittleFS.h>
+
+// An all-zero session was never filled in by a handshake
+static bool isEmpty(const uint8_t *bytes, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    if (bytes[i] != 0)
+      return false;
+  }
+  return true;
+}
+
+TlsSession::TlsSession() : client(nullptr), hostCrc(0), cacheValid(false), wasConnected(false), requestStartMs(0)
+{
+  memset(offered, 0, sizeof(offered));
+  memset(&tlsStats, 0, sizeof(tlsStats));
+}
+
+bool TlsSession::loadCache()
+{
+  TRACE_SCOPE(TRACE_FS_READ);
+  File file = LittleFS.open(TLS_SESSION_PATH, "r");
+  if (!file)
+    return false;
+
+  TlsSessionCache_t cache;
+  size_t n = file.read((uint8_t *)&cache, sizeof(cache));
+  file.close();
+  if (n != sizeof(cache) || cache.magic != TLS_SESSION_MAGIC || cache.hostCrc != hostCrc ||
+      cache.crc != crc32Update(0, (const uint8_t *)&cache, offsetof(TlsSessionCache_t, crc)))
+    return false;
+
+  // The session is opaque, but plain data: BearSSL's session parameters
+  memcpy((void *)&session, cache.session, sizeof(session));
+  return true;
+}
+
+void TlsSession::saveCache()
+{
+  TRACE_SCOPE(TRACE_FS_WRITE);
+  TlsSessionCache_t cache;
+  cache.magic = TLS_SESSION_MAGIC;
+  cache.hostCrc = hostCrc;
+  memcpy(cache.session, (const void *)&session, sizeof(cache.session));
+  cache.crc = crc32Update(0, (const uint8_t *)&cache, offsetof(TlsSessionCache_t, crc));
+
+  File file = LittleFS.open(TLS_SESSION_PATH, "w");
+  if (!file)
+    return;
+  file.write((const uint8_t *)&cache, sizeof(cache));
+  file.close();
+  tlsStats.saves++;
+}
+
+void TlsSession::begin(WiFiClientSecure &client, const char *host)
+{
+  this->client = &client;
+  uint32_t crc = crc32Update(0, (const uint8_t *)host, strlen(host));
+  // A session is only worth offering to the server that issued it
+  if (!cacheValid || crc != hostCrc)
+  {
+    hostCrc = crc;
+    memset((void *)&session, 0, sizeof(session));
+    cacheValid = loadCache();
+    if (cacheValid)
+      LOG_INFO("TLS session loaded from flash");
+  }
+  client.setSession(&session);
+}
+
+void TlsSession::beforeRequest()
+{
+  wasConnected = client->connected();
+  memcpy(offered, (const void *)&session, sizeof(offered));
+  requestStartMs = millis();
+  // HTTPClient connects from within the request, the span is the whole request that did the handshake
+  if (!wasConnected)
+    TRACE_BEGIN(TRACE_TLS_CONNECT);
+}
+
+void TlsSession::afterRequest(bool ok)
+{
+  uint32_t elapsed = millis() - requestStartMs;
+  if (!wasConnected)
+    TRACE_END(TRACE_TLS_CONNECT);
+  if (!ok)
+    return;
+
+  if (wasConnected)
+  {
+    tlsStats.reused++;
+    tlsStats.reusedMs += elapsed;
+    return;
+  }
+
+  // A resumed handshake hands back the session it was offered, a full one a new session
+  bool resumed = !isEmpty(offered, sizeof(offered)) && memcmp(offered, (const void *)&session, sizeof(offered)) == 0;
+  tlsStats.handshakes++;
+  tlsStats.lastHandshakeMs = elapsed;
+  tlsStats.maxHandshakeMs = max(tlsStats.maxHandshakeMs, elapsed);
+  if (resumed)
+  {
+    tlsStats.resumed++;
+    tlsStats.resumedMs += elapsed;
+  }
+  else
+  {
+    tlsStats.fullMs += elapsed;
+    saveCache();
+    cacheValid = true;
+  }
+}
+
+void TlsSession::printStats(Print &out) const
+{
+  uint32_t full = tlsStats.handshakes - tlsStats.resumed;
+  out.printf("tls handshakes %u resumed %u last %u ms max %u ms avg full %u ms resumed %u ms, reused connection %u "
+             "avg %u ms, sessions saved %u\n",
+             tlsStats.handshakes, tlsStats.resumed, tlsStats.lastHandshakeMs, tlsStats.maxHandshakeMs,
+             full > 0 ? (uint32_t)(tlsStats.fullMs / full) : 0,
+             tlsStats.resumed > 0 ? (uint32_t)(tlsStats.resumedMs / tlsStats.resumed) : 0, tlsStats.reused,
+             tlsStats.reused > 0 ? (uint32_t)(tlsStats.reusedMs / tlsStats.reused) : 0, tlsStats.saves);
+}
@@ -0,0 +1,71 @@
+#ifndef __TLS_SESSION_H__
+#define __TLS_SESSION_H__
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+#define TLS_SESSION_PATH "/tls.bin"
+#define TLS_SESSION_MAGIC 0x31534c54 // "TLS1"
+
+//
+// The BearSSL session of the last full handshake and the server it was made with, kept in flash
+// so the first connection after a reboot or deep sleep can resume it
+//
+typedef struct __attribute__((packed))
+{
+  uint32_t magic;
+  uint32_t hostCrc;
+  uint8_t session[sizeof(BearSSL::Session)];
+  uint32_t crc;
+} TlsSessionCache_t;
+
+typedef struct
+{
+  // New connections, each one a handshake, and how many of them resumed the cached session
+  uint32_t handshakes;
+  uint32_t resumed;
+  // Requests sent on a connection that was already open
+  uint32_t reused;
+  uint32_t lastHandshakeMs;
+  uint32_t maxHandshakeMs;
+  uint64_t fullMs;
+  uint64_t resumedMs;
+  uint64_t reusedMs;
+  uint32_t saves;
+} TlsStats_t;
+
+//
+// Session resumption for a WiFiClientSecure. The client is given a BearSSL session, which it
+// offers to the server on every connect and refreshes after each full handshake. HTTPClient opens
+// the connection from within the request, so a request that starts on a closed connection is timed
+// as a handshake: full or resumed depending on whether the session came back unchanged.
+//
+class TlsSession
+{
+public:
+  TlsSession();
+
+  void begin(WiFiClientSecure &client, const char *host);
+
+  // Around every request made through the client, `ok` when the server answered
+  void beforeRequest();
+  void afterRequest(bool ok);
+
+  const TlsStats_t &stats() const { return tlsStats; }
+  void printStats(Print &out) const;
+
+private:
+  bool loadCache();
+  void saveCache();
+
+  WiFiClientSecure *client;
+  BearSSL::Session session;
+  uint8_t offered[sizeof(BearSSL::Session)];
+  uint32_t hostCrc;
+  bool cacheValid;
+  bool wasConnected;
+  uint32_t requestStartMs;
+  TlsStats_t tlsStats;
+};
+
+#endif //__TLS_SESSION_H__
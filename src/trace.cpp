@@ -0,0 +1,48 @@
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+Trace trace;
+
+static const char *const traceNames[TRACE_IDS] = {"pm",    "co2",         "sht",     "display",
+                                                  "write", "tls_connect", "fs_read", "fs_write"};
+
+// Output goes out a chunk at a time, a WiFiClient would otherwise send a segment per line
+#define TRACE_DUMP_CHUNK 256
+#define TRACE_DUMP_LINE_MAX 48
+
+Trace::Trace() : head(0)
+{
+  memset(ring, 0, sizeof(ring));
+}
+
+size_t Trace::dump(Print &out) const
+{
+  char chunk[TRACE_DUMP_CHUNK];
+  size_t length = 0;
+  size_t written = 0;
+
+  // Events recorded while dumping may overwrite the oldest ones, the ring isn't paused for this
+  uint32_t end = head;
+  uint32_t kept = min(end, (uint32_t)TRACE_EVENTS);
+  length += snprintf(chunk, sizeof(chunk), "trace %u MHz %u events %u kept\n", ESP.getCpuFreqMHz(), end, kept);
+  for (uint8_t id = 0; id < TRACE_IDS; id++)
+    length += snprintf(chunk + length, sizeof(chunk) - length, "name %u %s\n", id, traceNames[id]);
+
+  for (uint32_t i = end - kept; i != end; i++)
+  {
+    if (sizeof(chunk) - length < TRACE_DUMP_LINE_MAX)
+    {
+      written += out.write((const uint8_t *)chunk, length);
+      length = 0;
+    }
+    const TraceEvent_t &event = ring[i & (TRACE_EVENTS - 1)];
+    length += snprintf(chunk + length, sizeof(chunk) - length, "%c %u %08x\n",
+                       event.tag & TRACE_PHASE_END ? 'E' : 'B', event.tag & ~TRACE_PHASE_END, event.cycles);
+  }
+  length += snprintf(chunk + length, sizeof(chunk) - length, "end\n");
+  written += out.write((const uint8_t *)chunk, length);
+  return written;
+}
+
+#endif // TRACE_ENABLED
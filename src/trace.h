@@ -0,0 +1,90 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <Arduino.h>
+#include "config.h"
+
+#if TRACE_ENABLED
+
+static_assert((TRACE_EVENTS & (TRACE_EVENTS - 1)) == 0, "TRACE_EVENTS must be a power of two");
+
+// What a span covers, the dump names them for the converter
+typedef enum
+{
+  TRACE_PM = 0,
+  TRACE_CO2,
+  TRACE_SHT,
+  TRACE_DISPLAY,
+  TRACE_WRITE,
+  TRACE_TLS_CONNECT,
+  TRACE_FS_READ,
+  TRACE_FS_WRITE,
+  TRACE_IDS
+} TraceId_t;
+
+#define TRACE_PHASE_END 0x80
+
+typedef struct
+{
+  uint32_t cycles;
+  // TraceId_t, with TRACE_PHASE_END set on the end of a span
+  uint8_t tag;
+} TraceEvent_t;
+
+//
+// Begin and end events stamped with the CPU cycle counter, in a ring that keeps the last TRACE_EVENTS.
+// Recording one is a read of CCOUNT and two stores, no branch and no call, so spans can go around
+// anything that takes a few microseconds. dump() writes the ring as text, oldest event first, for
+// tools/trace_to_chrome.py to turn into a Chrome trace. The counter wraps every 53 s at 80 MHz, the
+// converter unwraps it from one event to the next, so a dump only spans gaps shorter than that.
+//
+class Trace
+{
+public:
+  Trace();
+
+  void begin(TraceId_t id) { record(id); }
+  void end(TraceId_t id) { record(id | TRACE_PHASE_END); }
+
+  uint32_t recorded() const { return head; }
+  // Blocking, about 14 bytes per event
+  size_t dump(Print &out) const;
+
+private:
+  void record(uint8_t tag)
+  {
+    TraceEvent_t &event = ring[head++ & (TRACE_EVENTS - 1)];
+    event.cycles = ESP.getCycleCount();
+    event.tag = tag;
+  }
+
+  TraceEvent_t ring[TRACE_EVENTS];
+  uint32_t head;
+};
+
+extern Trace trace;
+
+// Ends the span when the scope is left, whichever return that is
+class TraceScope
+{
+public:
+  explicit TraceScope(TraceId_t id) : id(id) { trace.begin(id); }
+  ~TraceScope() { trace.end(id); }
+
+private:
+  TraceId_t id;
+};
+
+#define TRACE_BEGIN(id) trace.begin(id)
+#define TRACE_END(id) trace.end(id)
+#define TRACE_SCOPE(id) TraceScope traceScope(id)
+
+#else
+
+#define TRACE_BEGIN(id) ((void)0)
+#define TRACE_END(id) ((void)0)
+#define TRACE_SCOPE(id) ((void)0)
+
+#endif // TRACE_ENABLED
+
+#endif //__TRACE_H__
@@ -0,0 +1,110 @@
+#include "udp_writer.h"
+#include "config.h"
+
+#include <ESP8266WiFi.h>
+
+UdpWriter::UdpWriter() : port(DEFAULT_UDP_PORT), resolved(false), lastErrorText("")
+{
+  host[0] = '\0';
+  memset(&udpStats, 0, sizeof(udpStats));
+}
+
+void UdpWriter::begin(const char *url)
+{
+  const char *start = strstr(url, "://");
+  start = start != nullptr ? start + 3 : url;
+  size_t length = strcspn(start, ":/");
+  if (length >= sizeof(host))
+    length = sizeof(host) - 1;
+  memcpy(host, start, length);
+  host[length] = '\0';
+  port = start[length] == ':' ? atoi(start + length + 1) : DEFAULT_UDP_PORT;
+  resolved = false;
+}
+
+bool UdpWriter::resolve()
+{
+  // An address needs no lookup, a name is looked up once WiFi is up and then kept
+  if (!address.fromString(host) && WiFi.hostByName(host, address) != 1)
+    return false;
+  resolved = true;
+  return true;
+}
+
+bool UdpWriter::send(const char *body, size_t length)
+{
+  uint32_t start = micros();
+  udpStats.sends++;
+
+  if (WiFi.status() != WL_CONNECTED)
+  {
+    lastErrorText = "WiFi not connected";
+    udpStats.failed++;
+    return false;
+  }
+  if (!resolved && !resolve())
+  {
+    lastErrorText = "host lookup failed";
+    udpStats.failed++;
+    return false;
+  }
+
+  bool ok = true;
+  size_t pos = 0;
+  while (pos < length)
+  {
+    // As many whole lines as fit, without the newline after the last one
+    size_t end = pos;
+    size_t next = pos;
+    while (next < length)
+    {
+      const char *newline = (const char *)memchr(body + next, '\n', length - next);
+      size_t lineEnd = newline != nullptr ? newline - body : length;
+      if (lineEnd - pos > UDP_PAYLOAD_MAX)
+        break;
+      end = lineEnd;
+      next = lineEnd + 1;
+    }
+
+    if (next == pos)
+    {
+      // A single line longer than a datagram can't be sent
+      const char *newline = (const char *)memchr(body + pos, '\n', length - pos);
+      next = newline != nullptr ? newline - body + 1 : length;
+      udpStats.oversized++;
+    }
+    else if (end > pos)
+    {
+      if (udp.beginPacket(address, port) == 1 && udp.write((const uint8_t *)body + pos, end - pos) == end - pos &&
+          udp.endPacket() == 1)
+      {
+        udpStats.datagrams++;
+        udpStats.bytes += end - pos;
+      }
+      else
+      {
+        ok = false;
+      }
+    }
+    pos = next;
+  }
+
+  uint32_t elapsed = micros() - start;
+  udpStats.lastSendUs = elapsed;
+  udpStats.maxSendUs = max(udpStats.maxSendUs, elapsed);
+  udpStats.totalSendUs += elapsed;
+  if (!ok)
+  {
+    lastErrorText = "datagram not sent";
+    udpStats.failed++;
+  }
+  return ok;
+}
+
+void UdpWriter::printStats(Print &out) const
+{
+  out.printf("udp sends %u failed %u datagrams %u oversized lines %u bytes %u send last %u us max %u us avg %u us\n",
+             udpStats.sends, udpStats.failed, udpStats.datagrams, udpStats.oversized, (uint32_t)udpStats.bytes,
+             udpStats.lastSendUs, udpStats.maxSendUs,
+             udpStats.sends > 0 ? (uint32_t)(udpStats.totalSendUs / udpStats.sends) : 0);
+}
@@ -0,0 +1,51 @@
+#ifndef __UDP_WRITER_H__
+#define __UDP_WRITER_H__
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+typedef struct
+{
+  uint32_t sends;
+  uint32_t failed;
+  uint32_t datagrams;
+  uint32_t oversized;
+  uint64_t bytes;
+  uint32_t lastSendUs;
+  uint32_t maxSendUs;
+  uint64_t totalSendUs;
+} UdpStats_t;
+
+//
+// Sends line protocol fire-and-forget to a UDP listener (InfluxDB 1.x `[[udp]]`, Telegraf's
+// socket_listener). A body is cut into datagrams of whole lines straight from the caller's buffer,
+// so nothing is copied or allocated, and none exceeds UDP_PAYLOAD_MAX to stay unfragmented. There is
+// no acknowledgement: a send only fails when there is no network to send on.
+//
+class UdpWriter
+{
+public:
+  UdpWriter();
+
+  // `url` is udp://host[:port]
+  void begin(const char *url);
+  bool send(const char *body, size_t length);
+
+  const char *lastError() const { return lastErrorText; }
+
+  const UdpStats_t &stats() const { return udpStats; }
+  void printStats(Print &out) const;
+
+private:
+  bool resolve();
+
+  char host[64];
+  uint16_t port;
+  IPAddress address;
+  bool resolved;
+  WiFiUDP udp;
+  const char *lastErrorText;
+  UdpStats_t udpStats;
+};
+
+#endif //__UDP_WRITER_H__
@@ -0,0 +1,212 @@
+#include "wifi_connector.h"
+#include "config.h"
+#include "crc32.h"
+#include "logger.h"
+
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#ifndef NATIVE
+#include <lwip/dhcp.h>
+#include <lwip/netif.h>
+#endif
+
+// Lease time the DHCP server granted the station
+static uint32_t dhcpLeaseSeconds()
+{
+#ifndef NATIVE
+  struct dhcp *dhcp = netif_default != nullptr ? netif_dhcp_data(netif_default) : nullptr;
+  if (dhcp != nullptr && dhcp->offered_t0_lease > 0)
+    return dhcp->offered_t0_lease;
+#endif
+  return WIFI_LEASE_DEFAULT_S;
+}
+
+WifiConnector::WifiConnector()
+    : cacheValid(false), leaseTimedMs(false), leaseGrantedMs(0), fastStatic(false), staticLease(false), attempt(WIFI_IDLE), startedMs(0),
+      attemptStartedMs(0), fastTimeoutMs(0), timeoutMs(0)
+{
+  memset(&cache, 0, sizeof(cache));
+  memset(&wifiStats, 0, sizeof(wifiStats));
+}
+
+bool WifiConnector::loadCache()
+{
+  File file = LittleFS.open(WIFI_CACHE_PATH, "r");
+  if (!file)
+    return false;
+
+  size_t n = file.read((uint8_t *)&cache, sizeof(cache));
+  file.close();
+  return n == sizeof(cache) && cache.magic == WIFI_CACHE_MAGIC &&
+         cache.crc == crc32Update(0, (const uint8_t *)&cache, offsetof(WifiCache_t, crc));
+}
+
+void WifiConnector::saveCache(bool leased)
+{
+  WifiCache_t current;
+  memset(&current, 0, sizeof(current));
+  current.magic = WIFI_CACHE_MAGIC;
+  memcpy(current.bssid, WiFi.BSSID(), sizeof(current.bssid));
+  current.channel = WiFi.channel();
+  current.ip = WiFi.localIP();
+  current.gateway = WiFi.gatewayIP();
+  current.subnet = WiFi.subnetMask();
+  current.dns = WiFi.dnsIP();
+  if (leased)
+  {
+    time_t now = time(nullptr);
+    current.leaseSeconds = dhcpLeaseSeconds();
+    current.leaseStart = now >= CLOCK_VALID_EPOCH ? (uint32_t)now : 0;
+    leaseTimedMs = current.leaseStart == 0;
+    leaseGrantedMs = millis();
+  }
+  else
+  {
+    current.leaseSeconds = cache.leaseSeconds;
+    current.leaseStart = cache.leaseStart;
+  }
+  current.crc = crc32Update(0, (const uint8_t *)&current, offsetof(WifiCache_t, crc));
+
+  // Only write flash when something changed
+  if (cacheValid && memcmp(&current, &cache, sizeof(cache)) == 0)
+    return;
+
+  File file = LittleFS.open(WIFI_CACHE_PATH, "w");
+  if (!file)
+    return;
+  file.write((const uint8_t *)&current, sizeof(current));
+  file.close();
+  cache = current;
+  cacheValid = true;
+}
+
+void WifiConnector::dropCache()
+{
+  cacheValid = false;
+  leaseTimedMs = false;
+  LittleFS.remove(WIFI_CACHE_PATH);
+}
+
+bool WifiConnector::leaseValid() const
+{
+  uint32_t renewSeconds = cache.leaseSeconds / 2;
+  if (cache.leaseStart != 0)
+  {
+    // Before NTP or the RTC sets the clock it reads earlier than any lease start
+    time_t now = time(nullptr);
+    return now >= (time_t)cache.leaseStart && (uint32_t)(now - cache.leaseStart) < renewSeconds;
+  }
+  return leaseTimedMs && (uint64_t)(millis() - leaseGrantedMs) < (uint64_t)renewSeconds * 1000;
+}
+
+void WifiConnector::begin(uint32_t fastTimeoutMs, uint32_t timeoutMs)
+{
+  this->fastTimeoutMs = fastTimeoutMs;
+  this->timeoutMs = timeoutMs;
+  startedMs = attemptStartedMs = millis();
+  // Flash is only read once, reconnects after a radio sleep use the cache in RAM
+  if (!cacheValid)
+    cacheValid = loadCache();
+
+  // Credentials stay in the SDK config WiFiManager wrote, don't rewrite it on every boot
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+
+  String ssid = WiFi.SSID();
+  if (ssid.length() == 0)
+  {
+    // Nothing saved yet, only the portal can help
+    attempt = WIFI_FAILED;
+    return;
+  }
+  if (!cacheValid)
+  {
+    startScan();
+    return;
+  }
+
+  bool leased = leaseValid();
+  if (!leased)
+    wifiStats.leaseRenewals++;
+  startFast(leased);
+}
+
+void WifiConnector::startFast(bool staticIp)
+{
+  attempt = WIFI_FAST;
+  attemptStartedMs = millis();
+  fastStatic = staticIp;
+  wifiStats.fastAttempts++;
+  if (staticIp)
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+  else
+    WiFi.config(IPAddress(0u), IPAddress(0u), IPAddress(0u));
+  WiFi.begin(WiFi.SSID().c_str(), WiFi.psk().c_str(), cache.channel, cache.bssid);
+}
+
+void WifiConnector::startScan()
+{
+  // Back to DHCP and a scan for whichever access point of the saved network is around. A begin()
+  // without arguments would keep the channel and BSSID of the direct attempt in the SDK's config
+  attempt = WIFI_SCAN;
+  attemptStartedMs = millis();
+  WiFi.config(IPAddress(0u), IPAddress(0u), IPAddress(0u));
+  WiFi.begin(WiFi.SSID().c_str(), WiFi.psk().c_str());
+}
+
+bool WifiConnector::poll()
+{
+  if (attempt == WIFI_CONNECTED)
+  {
+    if (!staticLease || leaseValid())
+      return true;
+    // The address is still the cached lease's, the DHCP server may hand it out again
+    LOG_INFO("Cached IP lease due for renewal, rejoining over DHCP");
+    wifiStats.leaseRenewals++;
+    startedMs = millis();
+    startFast(false);
+    return false;
+  }
+  if (attempt == WIFI_IDLE || attempt == WIFI_FAILED)
+    return false;
+
+  if (WiFi.status() == WL_CONNECTED)
+  {
+    if (attempt == WIFI_FAST)
+      wifiStats.fastConnects++;
+    else
+      wifiStats.scanConnects++;
+    connected();
+    return true;
+  }
+
+  uint32_t now = millis();
+  if (attempt == WIFI_FAST && now - attemptStartedMs >= fastTimeoutMs + (fastStatic ? 0 : WIFI_FAST_DHCP_MS))
+  {
+    LOG_WARN("Cached access point didn't answer, scanning");
+    dropCache();
+    startScan();
+  }
+  else if (attempt == WIFI_SCAN && now - startedMs >= timeoutMs)
+  {
+    attempt = WIFI_FAILED;
+  }
+  return false;
+}
+
+void WifiConnector::connected()
+{
+  // Everything but a direct attempt on the cached lease went through DHCP, the portal included
+  staticLease = attempt == WIFI_FAST && fastStatic;
+  attempt = WIFI_CONNECTED;
+  wifiStats.lastAssociationMs = millis() - startedMs;
+  wifiStats.maxAssociationMs = max(wifiStats.maxAssociationMs, wifiStats.lastAssociationMs);
+  saveCache(!staticLease);
+}
+
+void WifiConnector::printStats(Print &out) const
+{
+  out.printf("wifi fast attempts %u fast connects %u scan connects %u lease renewals %u association last %u max %u ms\n",
+             wifiStats.fastAttempts, wifiStats.fastConnects, wifiStats.scanConnects, wifiStats.leaseRenewals,
+             wifiStats.lastAssociationMs, wifiStats.maxAssociationMs);
+}
@@ -0,0 +1,98 @@
+#ifndef __WIFI_CONNECTOR_H__
+#define __WIFI_CONNECTOR_H__
+
+#include <Arduino.h>
+
+#define WIFI_CACHE_PATH "/wifi.bin"
+#define WIFI_CACHE_MAGIC 0x32495741 // "AWI2"
+
+//
+// Where the last association ended up: access point, channel and the DHCP lease, so the
+// next boot can skip the scan and DHCP while the lease lasts
+//
+typedef struct __attribute__((packed))
+{
+  uint32_t magic;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint32_t leaseSeconds;
+  // Wall clock when DHCP granted the lease, 0 when the clock wasn't set yet
+  uint32_t leaseStart;
+  uint32_t crc;
+} WifiCache_t;
+
+typedef enum
+{
+  WIFI_IDLE = 0,
+  WIFI_FAST,
+  WIFI_SCAN,
+  WIFI_CONNECTED,
+  WIFI_FAILED
+} WifiAttempt_t;
+
+typedef struct
+{
+  uint32_t fastAttempts;
+  uint32_t fastConnects;
+  uint32_t scanConnects;
+  uint32_t leaseRenewals;
+  uint32_t lastAssociationMs;
+  uint32_t maxAssociationMs;
+} WifiStats_t;
+
+//
+// Joins the network WiFiManager saved without blocking. With a cached access point it first
+// associates directly on the known channel with the previous lease as a static IP, then falls
+// back to a regular scan + DHCP and forgets the cache. Each successful association refreshes the
+// cache. Like a DHCP client the lease is renewed once half of it has passed: the direct attempt
+// asks DHCP for the address instead, and poll() rejoins that way when the static address outlives
+// it. A power-on has no clock to tell how old the lease is, it skips the scan but not DHCP.
+//
+class WifiConnector
+{
+public:
+  WifiConnector();
+
+  void begin(uint32_t fastTimeoutMs, uint32_t timeoutMs);
+  // Polled while connected, it also renews a cached lease that outlived its time
+  bool poll();
+  // No saved network, or none reachable within `timeoutMs`
+  bool failed() const { return attempt == WIFI_FAILED; }
+
+  // Records an association made elsewhere, e.g. by the config portal
+  void connected();
+
+  const WifiStats_t &stats() const { return wifiStats; }
+  void printStats(Print &out) const;
+
+private:
+  bool loadCache();
+  void saveCache(bool leased);
+  void dropCache();
+  bool leaseValid() const;
+  // On the cached access point and channel, with the cached lease or over DHCP
+  void startFast(bool staticIp);
+  void startScan();
+
+  WifiCache_t cache;
+  bool cacheValid;
+  // A lease granted before the clock was set is timed with millis() until the next boot
+  bool leaseTimedMs;
+  uint32_t leaseGrantedMs;
+  // The direct attempt reuses the cached lease, and whether the connection runs on it
+  bool fastStatic;
+  bool staticLease;
+  WifiAttempt_t attempt;
+  uint32_t startedMs;
+  uint32_t attemptStartedMs;
+  uint32_t fastTimeoutMs;
+  uint32_t timeoutMs;
+  WifiStats_t wifiStats;
+};
+
+#endif //__WIFI_CONNECTOR_H__
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+Local stand-in for the InfluxDB v2 HTTP API, for end-to-end runs of the native build:
+
+    python3 tools/influx_standin.py --port 8086
+    .pio/build/native/program --config my-config.json --forward
+
+with "url": "http://127.0.0.1:8086" in my-config.json. Accepts /api/v2/write, answers /health and
+prints request, line and byte counts when stopped. gzip-encoded writes are decompressed.
+
+With --udp-port it also listens for line protocol datagrams, like an InfluxDB 1.x UDP listener, for
+configs with "transport": "udp" and "url": "udp://127.0.0.1:8089".
+"""
+
+import argparse
+import gzip
+import http.server
+import signal
+import socket
+import sys
+import threading
+
+
+class Stats:
+    requests = 0
+    lines = 0
+    body_bytes = 0
+    gzip_requests = 0
+    inflated_bytes = 0
+    datagrams = 0
+    udp_lines = 0
+    udp_bytes = 0
+
+
+class StandinHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def do_GET(self):
+        if self.path.startswith("/health") or self.path.startswith("/ping"):
+            self.reply(200, b'{"status":"pass"}')
+        else:
+            self.reply(404)
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        body = self.rfile.read(length)
+        if not self.path.startswith("/api/v2/write"):
+            self.reply(404)
+            return
+        if self.headers.get("Content-Encoding") == "gzip":
+            try:
+                body = gzip.decompress(body)
+            except (OSError, EOFError):
+                self.reply(400, b'{"code":"invalid","message":"bad gzip body"}')
+                return
+            Stats.gzip_requests += 1
+            Stats.inflated_bytes += len(body)
+
+        lines = [line for line in body.split(b"\n") if line.strip()]
+        Stats.requests += 1
+        Stats.lines += len(lines)
+        Stats.body_bytes += length
+        if self.server.verbose:
+            for line in lines:
+                print(line.decode(errors="replace"))
+        self.reply(204)
+
+    def reply(self, status, body=b""):
+        self.send_response(status)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        if self.server.verbose:
+            super().log_message(format, *args)
+
+
+def serve_udp(port, verbose):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("127.0.0.1", port))
+    while True:
+        data = sock.recv(65535)
+        lines = [line for line in data.split(b"\n") if line.strip()]
+        Stats.datagrams += 1
+        Stats.udp_lines += len(lines)
+        Stats.udp_bytes += len(data)
+        if verbose:
+            for line in lines:
+                print(line.decode(errors="replace"))
+
+
+def interrupt(signum, frame):
+    raise KeyboardInterrupt
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=8086)
+    parser.add_argument("--udp-port", type=int, help="also accept line protocol datagrams on this port")
+    parser.add_argument("--verbose", action="store_true", help="print every received line")
+    args = parser.parse_args()
+
+    if args.udp_port:
+        threading.Thread(target=serve_udp, args=(args.udp_port, args.verbose), daemon=True).start()
+
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", args.port), StandinHandler)
+    server.verbose = args.verbose
+    signal.signal(signal.SIGTERM, interrupt)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print(f"requests {Stats.requests} lines {Stats.lines} body {Stats.body_bytes} B "
+          f"gzip requests {Stats.gzip_requests} inflated {Stats.inflated_bytes} B", file=sys.stderr)
+    if args.udp_port:
+        print(f"udp datagrams {Stats.datagrams} lines {Stats.udp_lines} bytes {Stats.udp_bytes} B", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+Minimal local MQTT 3.1.1 broker for end-to-end runs of the native build with "transport": "mqtt":
+
+    python3 tools/mqtt_standin.py --port 1883
+    .pio/build/native/program --config my-config.json --forward
+
+with "mqtt": {"host": "127.0.0.1", "port": 1883} in my-config.json. Accepts CONNECT (keeping persistent
+sessions across connections), QoS 0 and 1 PUBLISH, PINGREQ and DISCONNECT, and prints message, line,
+record and duplicate counts when stopped. Nothing is forwarded to subscribers; point the firmware at
+mosquitto instead to consume the messages with e.g. Telegraf's mqtt_consumer.
+
+Binary payloads ("format": "binary") are the "AG" header followed by packed SampleRecord_t, which
+--verbose prints decoded.
+"""
+
+import argparse
+import signal
+import socketserver
+import struct
+import sys
+import threading
+
+# sample_record.h, with PMS_DATA_WORDS 13 and SAMPLE_CHANNELS 4
+RECORD = struct.Struct("<I13HhHHhHbH" + "hhH" * 4 + "B")
+BINARY_HEADER = struct.Struct("<2sBB")
+
+
+class Stats:
+    connects = 0
+    sessions_present = 0
+    messages = 0
+    duplicates = 0
+    lines = 0
+    records = 0
+    payload_bytes = 0
+
+
+lock = threading.Lock()
+# Packet ids already delivered, by client id of the persistent sessions
+sessions = {}
+
+
+def read_packet(stream):
+    header = stream.read(1)
+    if not header:
+        return None, None
+    remaining = 0
+    for shift in range(0, 28, 7):
+        byte = stream.read(1)
+        if not byte:
+            return None, None
+        remaining |= (byte[0] & 0x7F) << shift
+        if not byte[0] & 0x80:
+            break
+    body = stream.read(remaining)
+    if len(body) < remaining:
+        return None, None
+    return header[0], body
+
+
+def read_string(body, pos):
+    length = struct.unpack_from(">H", body, pos)[0]
+    return body[pos + 2:pos + 2 + length].decode(errors="replace"), pos + 2 + length
+
+
+def print_payload(payload):
+    if payload[:2] != b"AG":
+        print(payload.decode(errors="replace"))
+        return
+    _, version, count = BINARY_HEADER.unpack_from(payload)
+    for i in range(count):
+        fields = RECORD.unpack_from(payload, BINARY_HEADER.size + i * RECORD.size)
+        timestamp, pms = fields[0], fields[1:14]
+        co2, temp, humidity, samples = fields[14], fields[17], fields[18], fields[20]
+        print(f"v{version} {timestamp} pm2.5 {pms[4]} co2 {co2} temp {temp / 100:.2f} "
+              f"humidity {humidity / 100:.2f} samples {samples}")
+
+
+class BrokerHandler(socketserver.StreamRequestHandler):
+    def handle(self):
+        delivered = None
+        while True:
+            header, body = read_packet(self.rfile)
+            if header is None:
+                return
+            kind = header >> 4
+            if kind == 1:
+                client_id, _ = read_string(body, 10)
+                clean = body[7] & 0x02
+                with lock:
+                    present = not clean and client_id in sessions
+                    if clean or client_id not in sessions:
+                        sessions[client_id] = set()
+                    delivered = sessions[client_id]
+                    Stats.connects += 1
+                    Stats.sessions_present += present
+                self.wfile.write(bytes([0x20, 2, 1 if present else 0, 0]))
+            elif kind == 3:
+                qos = (header >> 1) & 3
+                _, pos = read_string(body, 0)
+                packet_id = None
+                if qos > 0:
+                    packet_id = struct.unpack_from(">H", body, pos)[0]
+                    pos += 2
+                payload = body[pos:]
+                with lock:
+                    if header & 0x08 and packet_id in delivered:
+                        Stats.duplicates += 1
+                    else:
+                        Stats.messages += 1
+                        Stats.payload_bytes += len(payload)
+                        if payload[:2] == b"AG":
+                            Stats.records += payload[3]
+                        else:
+                            Stats.lines += len([line for line in payload.split(b"\n") if line.strip()])
+                        if packet_id is not None:
+                            delivered.add(packet_id)
+                if self.server.verbose:
+                    print_payload(payload)
+                if qos == 1:
+                    self.wfile.write(bytes([0x40, 2]) + struct.pack(">H", packet_id))
+            elif kind == 12:
+                self.wfile.write(bytes([0xD0, 0]))
+            elif kind == 14:
+                return
+
+
+class Broker(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+def interrupt(signum, frame):
+    raise KeyboardInterrupt
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--verbose", action="store_true", help="print every received message")
+    args = parser.parse_args()
+
+    server = Broker(("127.0.0.1", args.port), BrokerHandler)
+    server.verbose = args.verbose
+    signal.signal(signal.SIGTERM, interrupt)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print(f"connects {Stats.connects} sessions present {Stats.sessions_present} messages {Stats.messages} "
+          f"duplicates {Stats.duplicates} lines {Stats.lines} records {Stats.records} "
+          f"payload {Stats.payload_bytes} B", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+Turns the firmware's event trace into Chrome trace JSON, for chrome://tracing or https://ui.perfetto.dev:
+
+    python3 tools/trace_to_chrome.py --url http://192.168.1.42:9100/trace -o trace.json
+    python3 tools/trace_to_chrome.py serial.log -o trace.json
+    .pio/build/native/program --trace trace.txt && python3 tools/trace_to_chrome.py trace.txt -o trace.json
+
+The trace comes from a build with TRACE_ENABLED (env:d1_mini_trace, env:native): GET /trace on the
+metrics port, a serial capture after sending 't' (log lines around the dump are skipped) or the native
+runner's --trace file. Cycle counts are unwrapped from one event to the next and converted with the
+CPU clock from the dump. Every begin is paired with the next end of the same span; an end whose begin
+was already overwritten in the ring is dropped, a begin still open at the dump is kept as open.
+"""
+
+import argparse
+import json
+import sys
+import urllib.request
+
+# Row in the viewer for each span, spans on one row nest
+ROWS = {
+    "pm": "sensors",
+    "co2": "sensors",
+    "sht": "sensors",
+    "display": "display",
+    "write": "network",
+    "tls_connect": "network",
+    "fs_read": "littlefs",
+    "fs_write": "littlefs",
+}
+ROW_ORDER = ["sensors", "display", "network", "littlefs", "other"]
+
+
+def read_dump(lines):
+    """The last complete dump in `lines`: clock in MHz, span names by id and (phase, id, cycles) events."""
+    dump = None
+    current = None
+    for line in lines:
+        fields = line.split()
+        if not fields:
+            continue
+        if fields[0] == "trace" and len(fields) >= 3 and fields[2] == "MHz":
+            current = {"mhz": int(fields[1]), "names": {}, "events": []}
+        elif current is None:
+            continue
+        elif fields[0] == "name" and len(fields) == 3:
+            current["names"][int(fields[1])] = fields[2]
+        elif fields[0] in ("B", "E") and len(fields) == 3:
+            current["events"].append((fields[0], int(fields[1]), int(fields[2], 16)))
+        elif fields[0] == "end":
+            dump = current
+            current = None
+    if dump is None:
+        raise SystemExit("no complete trace dump found")
+    return dump
+
+
+def to_chrome(dump):
+    mhz = dump["mhz"]
+    names = dump["names"]
+    rows = {row: tid for tid, row in enumerate(ROW_ORDER, 1)}
+    events = []
+    open_spans = {}
+    dropped = 0
+
+    elapsed = 0
+    last = None
+    for phase, span, cycles in dump["events"]:
+        # 32-bit cycle counter, unwrapped on the assumption that no two events are a wrap apart
+        if last is not None:
+            elapsed += (cycles - last) & 0xFFFFFFFF
+        last = cycles
+        ts = elapsed / mhz
+
+        name = names.get(span, "span%u" % span)
+        if phase == "B":
+            open_spans.setdefault(span, []).append(ts)
+            continue
+        starts = open_spans.get(span)
+        if not starts:
+            dropped += 1
+            continue
+        start = starts.pop()
+        events.append({"name": name, "cat": ROWS.get(name, "other"), "ph": "X", "ts": start, "dur": ts - start,
+                       "pid": 1, "tid": rows[ROWS.get(name, "other")]})
+
+    for span, starts in open_spans.items():
+        name = names.get(span, "span%u" % span)
+        for start in starts:
+            events.append({"name": name, "cat": ROWS.get(name, "other"), "ph": "B", "ts": start, "pid": 1,
+                           "tid": rows[ROWS.get(name, "other")]})
+
+    events.sort(key=lambda event: event["ts"])
+    metadata = [{"name": "process_name", "ph": "M", "pid": 1, "args": {"name": "airgradient"}}]
+    metadata += [{"name": "thread_name", "ph": "M", "pid": 1, "tid": tid, "args": {"name": row}}
+                 for row, tid in rows.items()]
+    return {"traceEvents": metadata + events, "displayTimeUnit": "ms"}, dropped
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("input", nargs="?", default="-", help="dump or serial capture, - for stdin (default)")
+    parser.add_argument("--url", help="fetch the dump from the device's /trace instead")
+    parser.add_argument("-o", "--output", default="-", help="Chrome trace JSON, - for stdout (default)")
+    args = parser.parse_args()
+
+    if args.url:
+        with urllib.request.urlopen(args.url, timeout=10) as response:
+            text = response.read().decode("ascii", errors="replace")
+    elif args.input == "-":
+        text = sys.stdin.read()
+    else:
+        with open(args.input, encoding="ascii", errors="replace") as file:
+            text = file.read()
+
+    trace, dropped = to_chrome(read_dump(text.splitlines()))
+    if args.output == "-":
+        json.dump(trace, sys.stdout)
+    else:
+        with open(args.output, "w") as file:
+            json.dump(trace, file)
+
+    spans = sum(1 for event in trace["traceEvents"] if event["ph"] in ("X", "B"))
+    print("%u spans, %u ends without their begin dropped" % (spans, dropped), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()